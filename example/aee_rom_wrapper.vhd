@@ -6,8 +6,13 @@ library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
+use work.pp_constants.all;
 use work.pp_utilities.all;
 
+--! @brief Wishbone wrapper for the AEE ROM.
+--! @details
+--!	Incrementing bursts are supported with registered feedback, by reading the
+--!	next word of the burst while the current word is acknowledged.
 entity aee_rom_wrapper is
 	generic(
 		MEMORY_SIZE : natural := 4096 --! Memory size in bytes.
@@ -22,7 +27,9 @@ entity aee_rom_wrapper is
 		wb_cyc_in  : in  std_logic;
 		wb_stb_in  : in  std_logic;
 		wb_sel_in  : in  std_logic_vector(3 downto 0);
-		wb_ack_out : out std_logic
+		wb_ack_out : out std_logic;
+		wb_cti_in  : in  std_logic_vector(2 downto 0) := WB_CTI_CLASSIC;
+		wb_bte_in  : in  std_logic_vector(1 downto 0) := WB_BTE_LINEAR
 	);
 end entity aee_rom_wrapper;
 
@@ -32,12 +39,17 @@ architecture behaviour of aee_rom_wrapper is
 	signal read_data : std_logic_vector(31 downto 0);
 	signal data_mask : std_logic_vector(31 downto 0);
 
+	signal rom_address : std_logic_vector(log2(MEMORY_SIZE) - 1 downto 0);
+
 begin
 
+	rom_address <= wb_get_burst_next_address(wb_adr_in, wb_bte_in) when ack = '1' and wb_cti_in = WB_CTI_INCREMENT
+		else wb_adr_in;
+
 	rom: entity work.aee_rom
 		port map(
 			clka => clk,
-			addra => wb_adr_in(log2(MEMORY_SIZE) - 1 downto 2),
+			addra => rom_address(log2(MEMORY_SIZE) - 1 downto 2),
 			douta => read_data
 		);
 
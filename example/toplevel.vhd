@@ -5,9 +5,13 @@
 library ieee;
 use ieee.std_logic_1164.all;
 
+use work.pp_types.all;
+
 -- This is a SoC design for the Arty development board. It has the following memory layout:
 --
 -- 0x00000000: Main memory (128 kB)
+-- 0x10000000: Instruction tightly-coupled memory (8 kB), inside the processor
+-- 0x20000000: Data tightly-coupled memory (8 kB), inside the processor
 -- 0xc0000000: Timer0
 -- 0xc0001000: Timer1
 -- 0xc0002000: UART0 (for host communication)
@@ -16,6 +20,12 @@ use ieee.std_logic_1164.all;
 -- 0xc0005000: Interconnect control/error module
 -- 0xffff8000: Application execution environment ROM (16 kB)
 -- 0xffffc000: Application execution environment RAM (16 kB)
+--
+-- The data bus is connected to the peripherals using a crossbar. Instructions are fetched using a
+-- separate instruction bus, which is connected directly to the second port of the main memory and
+-- to the crossbar for other addresses, so that instructions can also be fetched from the AEE ROM.
+-- Accesses to addresses without a peripheral are registered by the interconnect error module and
+-- return zeros, so that fetching instructions from them causes illegal instruction exceptions.
 entity toplevel is
 	port(
 		clk     : in  std_logic;
@@ -68,6 +78,18 @@ architecture behaviour of toplevel is
 	signal processor_dat_out : std_logic_vector(31 downto 0);
 	signal processor_dat_in  : std_logic_vector(31 downto 0);
 	signal processor_ack_in  : std_logic;
+	signal processor_cti_out : std_logic_vector(2 downto 0);
+	signal processor_bte_out : std_logic_vector(1 downto 0);
+
+	-- Processor instruction bus signals:
+	signal processor_iadr_out : std_logic_vector(31 downto 0);
+	signal processor_isel_out : std_logic_vector(3 downto 0);
+	signal processor_icyc_out : std_logic;
+	signal processor_istb_out : std_logic;
+	signal processor_idat_in  : std_logic_vector(31 downto 0);
+	signal processor_iack_in  : std_logic;
+	signal processor_icti_out : std_logic_vector(2 downto 0);
+	signal processor_ibte_out : std_logic_vector(1 downto 0);
 
 	-- Timer0 signals:
 	signal timer0_adr_in : std_logic_vector(11 downto 0);
@@ -140,6 +162,8 @@ architecture behaviour of toplevel is
 	signal aee_rom_stb_in  : std_logic;
 	signal aee_rom_sel_in  : std_logic_vector(3 downto 0);
 	signal aee_rom_ack_out : std_logic;
+	signal aee_rom_cti_in  : std_logic_vector(2 downto 0);
+	signal aee_rom_bte_in  : std_logic_vector(1 downto 0);
 
 	-- AEE RAM signals:
 	signal aee_ram_adr_in  : std_logic_vector(13 downto 0);
@@ -161,16 +185,48 @@ architecture behaviour of toplevel is
 	signal main_memory_we_in   : std_logic;
 	signal main_memory_ack_out : std_logic;
 
-	-- Selected peripheral on the interconnect:
-	type intercon_peripheral_type is (
-		PERIPHERAL_TIMER0, PERIPHERAL_TIMER1,
-		PERIPHERAL_UART0, PERIPHERAL_UART1, PERIPHERAL_GPIO,
-		PERIPHERAL_AEE_ROM, PERIPHERAL_AEE_RAM, PERIPHERAL_INTERCON,
-		PERIPHERAL_MAIN_MEMORY, PERIPHERAL_ERROR, PERIPHERAL_NONE);
-	signal intercon_peripheral : intercon_peripheral_type := PERIPHERAL_NONE;
+	-- Main memory instruction port signals:
+	signal main_memory_adr2_in  : std_logic_vector(16 downto 0);
+	signal main_memory_dat2_out : std_logic_vector(31 downto 0);
+	signal main_memory_cyc2_in  : std_logic;
+	signal main_memory_stb2_in  : std_logic;
+	signal main_memory_ack2_out : std_logic;
+
+	-- Instruction bus signals for accesses through the crossbar:
+	signal ibus_cyc_out : std_logic;
+	signal ibus_stb_out : std_logic;
+
+	-- Slave indices on the crossbar:
+	constant SLAVE_MAIN_MEMORY : natural := 0;
+	constant SLAVE_TIMER0      : natural := 1;
+	constant SLAVE_TIMER1      : natural := 2;
+	constant SLAVE_UART0       : natural := 3;
+	constant SLAVE_UART1       : natural := 4;
+	constant SLAVE_GPIO        : natural := 5;
+	constant SLAVE_INTERCON    : natural := 6;
+	constant SLAVE_AEE_ROM     : natural := 7;
+	constant SLAVE_AEE_RAM     : natural := 8;
+	constant NUM_SLAVES        : natural := 9;
+
+	constant ADDRESS_MAP : wb_address_map(0 to NUM_SLAVES - 1) := (
+			SLAVE_MAIN_MEMORY => (base => x"00000000", mask => x"fffe0000"),
+			SLAVE_TIMER0      => (base => x"c0000000", mask => x"fffff000"),
+			SLAVE_TIMER1      => (base => x"c0001000", mask => x"fffff000"),
+			SLAVE_UART0       => (base => x"c0002000", mask => x"fffff000"),
+			SLAVE_UART1       => (base => x"c0003000", mask => x"fffff000"),
+			SLAVE_GPIO        => (base => x"c0004000", mask => x"fffff000"),
+			SLAVE_INTERCON    => (base => x"c0005000", mask => x"fffff000"),
+			SLAVE_AEE_ROM     => (base => x"ffff8000", mask => x"ffffc000"),
+			SLAVE_AEE_RAM     => (base => x"ffffc000", mask => x"ffffc000")
+		);
 
-	-- Interconnect address decoder state:
-	signal intercon_busy : boolean := false;
+	-- Crossbar signals, the data bus is master 0 and the instruction bus master 1:
+	signal master_inputs  : wishbone_master_inputs_array(0 to 1);
+	signal master_outputs : wishbone_master_outputs_array(0 to 1);
+	signal slave_inputs   : wishbone_master_inputs_array(0 to NUM_SLAVES - 1);
+	signal slave_outputs  : wishbone_master_outputs_array(0 to NUM_SLAVES - 1);
+	signal error_inputs   : wishbone_master_inputs;
+	signal error_outputs  : wishbone_master_outputs;
 
 begin
 
@@ -183,103 +239,66 @@ begin
 			others => '0'
 		);
 
-	address_decoder: process(system_clk)
+	interconnect: entity work.pp_soc_crossbar
+		generic map(
+			NUM_MASTERS => 2,
+			NUM_SLAVES => NUM_SLAVES,
+			ADDRESS_MAP => ADDRESS_MAP
+		) port map(
+			clk => system_clk,
+			reset => reset,
+			m_inputs => master_inputs,
+			m_outputs => master_outputs,
+			s_inputs => slave_inputs,
+			s_outputs => slave_outputs,
+			err_inputs => error_inputs,
+			err_outputs => error_outputs
+		);
+
+	master_outputs(0) <= (
+			adr => processor_adr_out,
+			sel => processor_sel_out,
+			cyc => processor_cyc_out,
+			stb => processor_stb_out,
+			we => processor_we_out,
+			dat => processor_dat_out,
+			cti => processor_cti_out,
+			bte => processor_bte_out
+		);
+	processor_dat_in <= master_inputs(0).dat;
+	processor_ack_in <= master_inputs(0).ack;
+
+	master_outputs(1) <= (
+			adr => processor_iadr_out,
+			sel => processor_isel_out,
+			cyc => ibus_cyc_out,
+			stb => ibus_stb_out,
+			we => '0',
+			dat => (others => '0'),
+			cti => processor_icti_out,
+			bte => processor_ibte_out
+		);
+
+	instruction_decoder: process(processor_iadr_out, processor_icyc_out, processor_istb_out,
+		main_memory_ack2_out, main_memory_dat2_out, master_inputs)
 	begin
-		if rising_edge(system_clk) then
-			if reset = '1' then
-				intercon_peripheral <= PERIPHERAL_NONE;
-				intercon_busy <= false;
-			else
-				if not intercon_busy then
-					if processor_cyc_out = '1' then
-						intercon_busy <= true;
-
-						if processor_adr_out(31 downto 16) = x"0000"
-							or processor_adr_out(31 downto 16) = x"0001" then -- Main memory space
-								intercon_peripheral <= PERIPHERAL_MAIN_MEMORY;
-						elsif processor_adr_out(31 downto 16) = x"c000" then -- Peripheral memory space
-							case processor_adr_out(15 downto 12) is
-								when x"0" =>
-									intercon_peripheral <= PERIPHERAL_TIMER0;
-								when x"1" =>
-									intercon_peripheral <= PERIPHERAL_TIMER1;
-								when x"2" =>
-									intercon_peripheral <= PERIPHERAL_UART0;
-								when x"3" =>
-									intercon_peripheral <= PERIPHERAL_UART1;
-								when x"4" =>
-									intercon_peripheral <= PERIPHERAL_GPIO;
-								when x"5" =>
-									intercon_peripheral <= PERIPHERAL_INTERCON;
-								when others => -- Invalid address - delegated to the error peripheral
-									intercon_peripheral <= PERIPHERAL_ERROR;
-							end case;
-						elsif processor_adr_out(31 downto 16) = x"ffff" then -- Firmware memory space
-							if processor_adr_out(15 downto 14) = b"10" then    -- AEE ROM
-								intercon_peripheral <= PERIPHERAL_AEE_ROM;
-							elsif processor_adr_out(15 downto 14) = b"11" then -- AEE RAM
-								intercon_peripheral <= PERIPHERAL_AEE_RAM;
-							end if;
-						else
-							intercon_peripheral <= PERIPHERAL_ERROR;
-						end if;
-					else
-						intercon_peripheral <= PERIPHERAL_NONE;
-					end if;
-				else
-					if processor_cyc_out = '0' then
-						intercon_busy <= false;
-						intercon_peripheral <= PERIPHERAL_NONE;
-					end if;
-				end if;
-			end if;
+		main_memory_cyc2_in <= '0';
+		main_memory_stb2_in <= '0';
+		ibus_cyc_out <= '0';
+		ibus_stb_out <= '0';
+
+		if processor_iadr_out(31 downto 16) = x"0000" or processor_iadr_out(31 downto 16) = x"0001" then
+			main_memory_cyc2_in <= processor_icyc_out;
+			main_memory_stb2_in <= processor_istb_out;
+			processor_iack_in <= main_memory_ack2_out;
+			processor_idat_in <= main_memory_dat2_out;
+		else
+			ibus_cyc_out <= processor_icyc_out;
+			ibus_stb_out <= processor_istb_out;
+			processor_iack_in <= master_inputs(1).ack;
+			processor_idat_in <= master_inputs(1).dat;
 		end if;
-	end process address_decoder;
-
-	processor_intercon: process(intercon_peripheral,
-		timer0_ack_out, timer0_dat_out, timer1_ack_out, timer1_dat_out,
-		uart0_ack_out, uart0_dat_out, uart1_ack_out, uart1_dat_out,
-		gpio_ack_out, gpio_dat_out,
-		intercon_ack_out, intercon_dat_out, error_ack_out,
-		aee_rom_ack_out, aee_rom_dat_out, aee_ram_ack_out, aee_ram_dat_out,
-		main_memory_ack_out, main_memory_dat_out)
-	begin
-		case intercon_peripheral is
-			when PERIPHERAL_TIMER0 =>
-				processor_ack_in <= timer0_ack_out;
-				processor_dat_in <= timer0_dat_out;
-			when PERIPHERAL_TIMER1 =>
-				processor_ack_in <= timer1_ack_out;
-				processor_dat_in <= timer1_dat_out;
-			when PERIPHERAL_UART0 =>
-				processor_ack_in <= uart0_ack_out;
-				processor_dat_in <= x"000000" & uart0_dat_out;
-			when PERIPHERAL_UART1 =>
-				processor_ack_in <= uart1_ack_out;
-				processor_dat_in <= x"000000" & uart1_dat_out;
-			when PERIPHERAL_GPIO =>
-				processor_ack_in <= gpio_ack_out;
-				processor_dat_in <= gpio_dat_out;
-			when PERIPHERAL_INTERCON =>
-				processor_ack_in <= intercon_ack_out;
-				processor_dat_in <= intercon_dat_out;
-			when PERIPHERAL_AEE_ROM =>
-				processor_ack_in <= aee_rom_ack_out;
-				processor_dat_in <= aee_rom_dat_out;
-			when PERIPHERAL_AEE_RAM =>
-				processor_ack_in <= aee_ram_ack_out;
-				processor_dat_in <= aee_ram_dat_out;
-			when PERIPHERAL_ERROR =>
-				processor_ack_in <= error_ack_out;
-				processor_dat_in <= (others => '0');
-			when PERIPHERAL_MAIN_MEMORY =>
-				processor_ack_in <= main_memory_ack_out;
-				processor_dat_in <= main_memory_dat_out;
-			when PERIPHERAL_NONE =>
-				processor_ack_in <= '0';
-				processor_dat_in <= (others => '0');
-		end case;
-	end process processor_intercon;
+	end process instruction_decoder;
 
 	reset_controller: entity work.pp_soc_reset
 		port map(
@@ -301,12 +320,26 @@ begin
 	processor: entity work.pp_potato
 		generic map(
 			RESET_ADDRESS => x"ffff8000",
-			ICACHE_ENABLE => false
+			ICACHE_ENABLE => false,
+			DCACHE_ENABLE => true,
+			DCACHE_UNCACHED_MASK => x"ffff0000",
+			DCACHE_UNCACHED_BASE => x"c0000000", -- Peripheral memory space
+			BURST_REFILLS => true,
+			HARVARD_BUS => true,
+			ITCM_BASE => x"10000000",
+			ITCM_SIZE => 8192,
+			DTCM_BASE => x"20000000",
+			DTCM_SIZE => 8192,
+			M_EXTENSION => true,
+			ZBB_EXTENSION => true,
+			ZKNH_EXTENSION => true,
+			C_EXTENSION => true
 		) port map(
 			clk => system_clk,
 			reset => reset,
 			irq => irq_array,
 			test_context_out => open,
+			cache_events_out => open,
 			wb_adr_out => processor_adr_out,
 			wb_dat_out => processor_dat_out,
 			wb_dat_in => processor_dat_in,
@@ -314,7 +347,17 @@ begin
 			wb_cyc_out => processor_cyc_out,
 			wb_stb_out => processor_stb_out,
 			wb_we_out => processor_we_out,
-			wb_ack_in => processor_ack_in
+			wb_ack_in => processor_ack_in,
+			wb_cti_out => processor_cti_out,
+			wb_bte_out => processor_bte_out,
+			iwb_adr_out => processor_iadr_out,
+			iwb_sel_out => processor_isel_out,
+			iwb_cyc_out => processor_icyc_out,
+			iwb_stb_out => processor_istb_out,
+			iwb_dat_in => processor_idat_in,
+			iwb_ack_in => processor_iack_in,
+			iwb_cti_out => processor_icti_out,
+			iwb_bte_out => processor_ibte_out
 		);
 
 	timer0: entity work.pp_soc_timer
@@ -330,11 +373,12 @@ begin
 			wb_we_in => timer0_we_in,
 			wb_ack_out => timer0_ack_out
 		);
-	timer0_adr_in <= processor_adr_out(timer0_adr_in'range);
-	timer0_dat_in <= processor_dat_out;
-	timer0_we_in <= processor_we_out;
-	timer0_cyc_in <= processor_cyc_out when intercon_peripheral = PERIPHERAL_TIMER0 else '0';
-	timer0_stb_in <= processor_stb_out when intercon_peripheral = PERIPHERAL_TIMER0 else '0';
+	timer0_adr_in <= slave_outputs(SLAVE_TIMER0).adr(timer0_adr_in'range);
+	timer0_dat_in <= slave_outputs(SLAVE_TIMER0).dat;
+	timer0_we_in  <= slave_outputs(SLAVE_TIMER0).we;
+	timer0_cyc_in <= slave_outputs(SLAVE_TIMER0).cyc;
+	timer0_stb_in <= slave_outputs(SLAVE_TIMER0).stb;
+	slave_inputs(SLAVE_TIMER0) <= (dat => timer0_dat_out, ack => timer0_ack_out, stall => '0');
 
 	timer1: entity work.pp_soc_timer
 		port map(
@@ -349,11 +393,12 @@ begin
 			wb_we_in => timer1_we_in,
 			wb_ack_out => timer1_ack_out
 		);
-	timer1_adr_in <= processor_adr_out(timer1_adr_in'range);
-	timer1_dat_in <= processor_dat_out;
-	timer1_we_in  <= processor_we_out;
-	timer1_cyc_in <= processor_cyc_out when intercon_peripheral = PERIPHERAL_TIMER1 else '0';
-	timer1_stb_in <= processor_stb_out when intercon_peripheral = PERIPHERAL_TIMER1 else '0';
+	timer1_adr_in <= slave_outputs(SLAVE_TIMER1).adr(timer1_adr_in'range);
+	timer1_dat_in <= slave_outputs(SLAVE_TIMER1).dat;
+	timer1_we_in  <= slave_outputs(SLAVE_TIMER1).we;
+	timer1_cyc_in <= slave_outputs(SLAVE_TIMER1).cyc;
+	timer1_stb_in <= slave_outputs(SLAVE_TIMER1).stb;
+	slave_inputs(SLAVE_TIMER1) <= (dat => timer1_dat_out, ack => timer1_ack_out, stall => '0');
 
 	gpio: entity work.pp_soc_gpio
 		generic map(
@@ -370,11 +415,12 @@ begin
 			wb_we_in => gpio_we_in,
 			wb_ack_out => gpio_ack_out
 		);
-	gpio_adr_in <= processor_adr_out(gpio_adr_in'range);
-	gpio_dat_in <= processor_dat_out;
-	gpio_we_in  <= processor_we_out;
-	gpio_cyc_in <= processor_cyc_out when intercon_peripheral = PERIPHERAL_GPIO else '0';
-	gpio_stb_in <= processor_stb_out when intercon_peripheral = PERIPHERAL_GPIO else '0';
+	gpio_adr_in <= slave_outputs(SLAVE_GPIO).adr(gpio_adr_in'range);
+	gpio_dat_in <= slave_outputs(SLAVE_GPIO).dat;
+	gpio_we_in  <= slave_outputs(SLAVE_GPIO).we;
+	gpio_cyc_in <= slave_outputs(SLAVE_GPIO).cyc;
+	gpio_stb_in <= slave_outputs(SLAVE_GPIO).stb;
+	slave_inputs(SLAVE_GPIO) <= (dat => gpio_dat_out, ack => gpio_ack_out, stall => '0');
 
 	uart0: entity work.pp_soc_uart
 		generic map(
@@ -393,11 +439,12 @@ begin
 			wb_we_in => uart0_we_in,
 			wb_ack_out => uart0_ack_out
 		);
-	uart0_adr_in <= processor_adr_out(uart0_adr_in'range);
-	uart0_dat_in <= processor_dat_out(7 downto 0);
-	uart0_we_in  <= processor_we_out;
-	uart0_cyc_in <= processor_cyc_out when intercon_peripheral = PERIPHERAL_UART0 else '0';
-	uart0_stb_in <= processor_stb_out when intercon_peripheral = PERIPHERAL_UART0 else '0';
+	uart0_adr_in <= slave_outputs(SLAVE_UART0).adr(uart0_adr_in'range);
+	uart0_dat_in <= slave_outputs(SLAVE_UART0).dat(7 downto 0);
+	uart0_we_in  <= slave_outputs(SLAVE_UART0).we;
+	uart0_cyc_in <= slave_outputs(SLAVE_UART0).cyc;
+	uart0_stb_in <= slave_outputs(SLAVE_UART0).stb;
+	slave_inputs(SLAVE_UART0) <= (dat => x"000000" & uart0_dat_out, ack => uart0_ack_out, stall => '0');
 
 	uart1: entity work.pp_soc_uart
 		generic map(
@@ -416,11 +463,12 @@ begin
 			wb_we_in => uart1_we_in,
 			wb_ack_out => uart1_ack_out
 		);
-	uart1_adr_in <= processor_adr_out(uart1_adr_in'range);
-	uart1_dat_in <= processor_dat_out(7 downto 0);
-	uart1_we_in  <= processor_we_out;
-	uart1_cyc_in <= processor_cyc_out when intercon_peripheral = PERIPHERAL_UART1 else '0';
-	uart1_stb_in <= processor_stb_out when intercon_peripheral = PERIPHERAL_UART1 else '0';
+	uart1_adr_in <= slave_outputs(SLAVE_UART1).adr(uart1_adr_in'range);
+	uart1_dat_in <= slave_outputs(SLAVE_UART1).dat(7 downto 0);
+	uart1_we_in  <= slave_outputs(SLAVE_UART1).we;
+	uart1_cyc_in <= slave_outputs(SLAVE_UART1).cyc;
+	uart1_stb_in <= slave_outputs(SLAVE_UART1).stb;
+	slave_inputs(SLAVE_UART1) <= (dat => x"000000" & uart1_dat_out, ack => uart1_ack_out, stall => '0');
 
 	intercon_error: entity work.pp_soc_intercon
 		port map(
@@ -442,17 +490,19 @@ begin
 			err_we_in => error_we_in,
 			err_ack_out => error_ack_out
 		);
-	intercon_adr_in <= processor_adr_out(intercon_adr_in'range);
-	intercon_dat_in <= processor_dat_out;
-	intercon_we_in  <= processor_we_out;
-	intercon_cyc_in <= processor_cyc_out when intercon_peripheral = PERIPHERAL_INTERCON else '0';
-	intercon_stb_in <= processor_stb_out when intercon_peripheral = PERIPHERAL_INTERCON else '0';
-	error_adr_in <= processor_adr_out;
-	error_dat_in <= processor_dat_out;
-	error_sel_in <= processor_sel_out;
-	error_we_in  <= processor_we_out;
-	error_cyc_in <= processor_cyc_out when intercon_peripheral = PERIPHERAL_ERROR else '0';
-	error_stb_in <= processor_stb_out when intercon_peripheral = PERIPHERAL_ERROR else '0';
+	intercon_adr_in <= slave_outputs(SLAVE_INTERCON).adr(intercon_adr_in'range);
+	intercon_dat_in <= slave_outputs(SLAVE_INTERCON).dat;
+	intercon_we_in  <= slave_outputs(SLAVE_INTERCON).we;
+	intercon_cyc_in <= slave_outputs(SLAVE_INTERCON).cyc;
+	intercon_stb_in <= slave_outputs(SLAVE_INTERCON).stb;
+	slave_inputs(SLAVE_INTERCON) <= (dat => intercon_dat_out, ack => intercon_ack_out, stall => '0');
+	error_adr_in <= error_outputs.adr;
+	error_dat_in <= error_outputs.dat;
+	error_sel_in <= error_outputs.sel;
+	error_we_in  <= error_outputs.we;
+	error_cyc_in <= error_outputs.cyc;
+	error_stb_in <= error_outputs.stb;
+	error_inputs <= (dat => (others => '0'), ack => error_ack_out, stall => '0');
 
 	aee_rom: entity work.aee_rom_wrapper
 		generic map(
@@ -465,12 +515,17 @@ begin
 			wb_cyc_in => aee_rom_cyc_in,
 			wb_stb_in => aee_rom_stb_in,
 			wb_sel_in => aee_rom_sel_in,
-			wb_ack_out => aee_rom_ack_out
+			wb_ack_out => aee_rom_ack_out,
+			wb_cti_in => aee_rom_cti_in,
+			wb_bte_in => aee_rom_bte_in
 		);
-	aee_rom_adr_in <= processor_adr_out(aee_rom_adr_in'range);
-	aee_rom_cyc_in <= processor_cyc_out when intercon_peripheral = PERIPHERAL_AEE_ROM else '0';
-	aee_rom_stb_in <= processor_stb_out when intercon_peripheral = PERIPHERAL_AEE_ROM else '0';
-	aee_rom_sel_in <= processor_sel_out;
+	aee_rom_adr_in <= slave_outputs(SLAVE_AEE_ROM).adr(aee_rom_adr_in'range);
+	aee_rom_sel_in <= slave_outputs(SLAVE_AEE_ROM).sel;
+	aee_rom_cyc_in <= slave_outputs(SLAVE_AEE_ROM).cyc;
+	aee_rom_stb_in <= slave_outputs(SLAVE_AEE_ROM).stb;
+	aee_rom_cti_in <= slave_outputs(SLAVE_AEE_ROM).cti;
+	aee_rom_bte_in <= slave_outputs(SLAVE_AEE_ROM).bte;
+	slave_inputs(SLAVE_AEE_ROM) <= (dat => aee_rom_dat_out, ack => aee_rom_ack_out, stall => '0');
 
 	aee_ram: entity work.pp_soc_memory
 		generic map(
@@ -485,14 +540,17 @@ begin
 			wb_stb_in => aee_ram_stb_in,
 			wb_sel_in => aee_ram_sel_in,
 			wb_we_in => aee_ram_we_in,
-			wb_ack_out => aee_ram_ack_out
+			wb_ack_out => aee_ram_ack_out,
+			wb_cti_in => slave_outputs(SLAVE_AEE_RAM).cti,
+			wb_bte_in => slave_outputs(SLAVE_AEE_RAM).bte
 		);
-	aee_ram_adr_in <= processor_adr_out(aee_ram_adr_in'range);
-	aee_ram_dat_in <= processor_dat_out;
-	aee_ram_we_in  <= processor_we_out;
-	aee_ram_sel_in <= processor_sel_out;
-	aee_ram_cyc_in <= processor_cyc_out when intercon_peripheral = PERIPHERAL_AEE_RAM else '0';
-	aee_ram_stb_in <= processor_stb_out when intercon_peripheral = PERIPHERAL_AEE_RAM else '0';
+	aee_ram_adr_in <= slave_outputs(SLAVE_AEE_RAM).adr(aee_ram_adr_in'range);
+	aee_ram_dat_in <= slave_outputs(SLAVE_AEE_RAM).dat;
+	aee_ram_we_in  <= slave_outputs(SLAVE_AEE_RAM).we;
+	aee_ram_sel_in <= slave_outputs(SLAVE_AEE_RAM).sel;
+	aee_ram_cyc_in <= slave_outputs(SLAVE_AEE_RAM).cyc;
+	aee_ram_stb_in <= slave_outputs(SLAVE_AEE_RAM).stb;
+	slave_inputs(SLAVE_AEE_RAM) <= (dat => aee_ram_dat_out, ack => aee_ram_ack_out, stall => '0');
 
 	main_memory: entity work.pp_soc_memory
 		generic map(
@@ -507,13 +565,24 @@ begin
 			wb_stb_in => main_memory_stb_in,
 			wb_sel_in => main_memory_sel_in,
 			wb_we_in => main_memory_we_in,
-			wb_ack_out => main_memory_ack_out
+			wb_ack_out => main_memory_ack_out,
+			wb_cti_in => slave_outputs(SLAVE_MAIN_MEMORY).cti,
+			wb_bte_in => slave_outputs(SLAVE_MAIN_MEMORY).bte,
+			wb2_adr_in => main_memory_adr2_in,
+			wb2_dat_out => main_memory_dat2_out,
+			wb2_cyc_in => main_memory_cyc2_in,
+			wb2_stb_in => main_memory_stb2_in,
+			wb2_ack_out => main_memory_ack2_out,
+			wb2_cti_in => processor_icti_out,
+			wb2_bte_in => processor_ibte_out
 		);
-	main_memory_adr_in <= processor_adr_out(main_memory_adr_in'range);
-	main_memory_dat_in <= processor_dat_out;
-	main_memory_we_in  <= processor_we_out;
-	main_memory_sel_in <= processor_sel_out;
-	main_memory_cyc_in <= processor_cyc_out when intercon_peripheral = PERIPHERAL_MAIN_MEMORY else '0';
-	main_memory_stb_in <= processor_stb_out when intercon_peripheral = PERIPHERAL_MAIN_MEMORY else '0';
+	main_memory_adr_in <= slave_outputs(SLAVE_MAIN_MEMORY).adr(main_memory_adr_in'range);
+	main_memory_dat_in <= slave_outputs(SLAVE_MAIN_MEMORY).dat;
+	main_memory_we_in  <= slave_outputs(SLAVE_MAIN_MEMORY).we;
+	main_memory_sel_in <= slave_outputs(SLAVE_MAIN_MEMORY).sel;
+	main_memory_cyc_in <= slave_outputs(SLAVE_MAIN_MEMORY).cyc;
+	main_memory_stb_in <= slave_outputs(SLAVE_MAIN_MEMORY).stb;
+	slave_inputs(SLAVE_MAIN_MEMORY) <= (dat => main_memory_dat_out, ack => main_memory_ack_out, stall => '0');
+	main_memory_adr2_in <= processor_iadr_out(main_memory_adr2_in'range);
 
 end architecture behaviour;
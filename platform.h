@@ -12,6 +12,10 @@
 // System clock frequency:
 #define PLATFORM_SYSCLK_FREQ	50000000U
 
+// Base addresses of the tightly-coupled memories:
+#define PLATFORM_ITCM_BASE	0x10000000
+#define PLATFORM_DTCM_BASE	0x20000000
+
 // Base addresses for peripherals:
 #define PLATFORM_TIMER0_BASE	0xc0000000
 #define PLATFORM_TIMER1_BASE	0xc0001000
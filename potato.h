@@ -33,6 +33,21 @@
 // IRQ bit in the cause register:
 #define POTATO_MCAUSE_IRQ_BIT		 4
 
+// Data cache control register and bit indices:
+#define POTATO_DCACHE_CSR		0xbf1
+#define POTATO_DCACHE_FLUSH		0	// Write modified cache lines to memory
+#define POTATO_DCACHE_INVALIDATE	1	// Discard all cache lines
+
+// Instruction cache invalidation range registers, writing the end address invalidates
+// the range from the start address up to, but not including, the end address:
+#define POTATO_ICACHE_INVALIDATE_START_CSR	0xbf2
+#define POTATO_ICACHE_INVALIDATE_END_CSR	0xbf3
+
+// Places a function or variable in the instruction or data tightly-coupled memory. The
+// sections are copied to the TCMs by the startup code when linking with potato.ld:
+#define POTATO_TCM_TEXT	__attribute__((section(".tcm_text")))
+#define POTATO_TCM_DATA	__attribute__((section(".tcm_data")))
+
 // Status register bit indices:
 #define STATUS_MIE	3		// Enable Interrupts
 #define STATUS_MPIE	7		// Previous value of Enable Interrupts
@@ -93,6 +108,71 @@ static inline void potato_disable_irq(uint8_t n)
 	);
 }
 
+/**
+ * Gets the lower 32 bits of the cycle counter.
+ */
+static inline uint32_t potato_get_cycles(void)
+{
+	register uint32_t retval = 0;
+	asm volatile(
+		"csrr %[retval], cycle\n"
+		: [retval] "=r" (retval)
+	);
+
+	return retval;
+}
+
+/**
+ * Writes all modified lines in the data cache to memory.
+ */
+static inline void potato_dcache_flush(void)
+{
+	asm volatile(
+		"csrwi %[regname], 1 << %[flush_bit]\n"
+		:: [regname] "i" (POTATO_DCACHE_CSR), [flush_bit] "i" (POTATO_DCACHE_FLUSH)
+		: "memory"
+	);
+}
+
+/**
+ * Discards all lines in the data cache without writing modified lines to memory.
+ * @note Use @ref potato_dcache_flush() first to keep data written by the processor.
+ */
+static inline void potato_dcache_invalidate(void)
+{
+	asm volatile(
+		"csrwi %[regname], 1 << %[invalidate_bit]\n"
+		:: [regname] "i" (POTATO_DCACHE_CSR), [invalidate_bit] "i" (POTATO_DCACHE_INVALIDATE)
+		: "memory"
+	);
+}
+
+/**
+ * Makes instructions written by the processor visible to instruction fetches by writing
+ * all modified lines in the data cache to memory and invalidating the instruction cache.
+ */
+static inline void potato_icache_invalidate(void)
+{
+	asm volatile("fence.i\n" ::: "memory");
+}
+
+/**
+ * Invalidates the instruction cache lines containing the addresses from start up to,
+ * but not including, end. Instructions following the call are fetched again.
+ * @note The data cache is not flushed, use @ref potato_dcache_flush() first if the
+ *       instructions were written through the data cache.
+ */
+static inline void potato_icache_invalidate_range(const void * start, const void * end)
+{
+	asm volatile(
+		"csrw %[start_reg], %[start]\n"
+		"csrw %[end_reg], %[end]\n"
+		:: [start_reg] "i" (POTATO_ICACHE_INVALIDATE_START_CSR), [start] "r" (start),
+			[end_reg] "i" (POTATO_ICACHE_INVALIDATE_END_CSR), [end] "r" (end)
+		: "memory"
+	);
+}
+
 #define potato_get_badaddr(n) \
 	do { \
 		register uint32_t temp = 0; \
@@ -0,0 +1,244 @@
+-- The Potato Processor - A simple processor for FPGAs
+-- (c) Kristian Klomsten Skordal 2014 - 2015 <kristian.skordal@wafflemail.net>
+-- Report bugs and issues on <https://github.com/skordal/potato/issues>
+
+library ieee;
+use ieee.std_logic_1164.all;
+
+use work.pp_types.all;
+use work.pp_constants.all;
+
+--! @brief Wishbone crossbar connecting several masters to several slaves.
+--! @details
+--!	The slave addressed by a master is found using a constant address map with
+--!	one address range for each slave; if ranges overlap, the first matching
+--!	range is used. Accesses to addresses that are not in the map are routed to
+--!	the error interface, which is intended to be connected to the error
+--!	interface of pp_soc_intercon. Masters accessing different slaves are
+--!	connected at the same time, so that their transfers run concurrently.
+--!
+--!	A master is granted a slave when it makes a request to it and keeps it until
+--!	it ends its bus cycle. When several masters request the same free slave, it
+--!	is granted to them in round-robin order. Masters that are waiting for a
+--!	slave see the stall signal set. A master using pipelined cycles can address
+--!	several slaves in one bus cycle and keeps all of them until the cycle ends;
+--!	the acknowledges from the slaves must then arrive in the order of the
+--!	requests, and only one of them may acknowledge in a cycle. If several
+--!	masters use pipelined cycles, they must not access more than one slave in a
+--!	bus cycle, as two masters that each keep a slave while waiting for the slave
+--!	of the other would never be granted it.
+--!
+--!	With combinational decoding, a request is passed on to the slave in the same
+--!	cycle as it is made. With registered decoding, the slave is decoded from the
+--!	address of the first request in a bus cycle and used for the rest of it. This
+--!	adds a cycle to the start of each bus cycle but removes the address decoder
+--!	from the paths between masters and slaves; a bus cycle can then only access
+--!	a single slave.
+entity pp_soc_crossbar is
+	generic(
+		NUM_MASTERS       : positive := 1;    --! Number of masters.
+		NUM_SLAVES        : positive := 1;    --! Number of slaves, must be equal to the length of the address map.
+		ADDRESS_MAP       : wb_address_map;   --! Address ranges of the slaves, in the order of the slave interfaces.
+		REGISTERED_DECODE : boolean := false  --! Whether to decode addresses in the cycle before passing on requests.
+	);
+	port(
+		clk   : in std_logic;
+		reset : in std_logic;
+
+		-- Master interfaces:
+		m_inputs  : out wishbone_master_inputs_array(0 to NUM_MASTERS - 1);
+		m_outputs : in  wishbone_master_outputs_array(0 to NUM_MASTERS - 1);
+
+		-- Slave interfaces:
+		s_inputs  : in  wishbone_master_inputs_array(0 to NUM_SLAVES - 1);
+		s_outputs : out wishbone_master_outputs_array(0 to NUM_SLAVES - 1);
+
+		-- Interface for registering bus errors:
+		err_inputs  : in  wishbone_master_inputs;
+		err_outputs : out wishbone_master_outputs
+	);
+end entity pp_soc_crossbar;
+
+architecture behaviour of pp_soc_crossbar is
+
+	-- The error interface is handled as the last slave:
+	constant ERROR_SLAVE : natural := NUM_SLAVES;
+	constant NO_SLAVE    : natural := NUM_SLAVES + 1;
+	constant NO_MASTER   : natural := NUM_MASTERS;
+
+	subtype slave_index is natural range 0 to NO_SLAVE;
+	subtype master_index is natural range 0 to NO_MASTER;
+
+	type slave_index_array is array(0 to NUM_MASTERS - 1) of slave_index;
+	type master_index_array is array(0 to ERROR_SLAVE) of master_index;
+
+	-- Slave addressed by each master:
+	signal target : slave_index_array := (others => NO_SLAVE);
+
+	-- Master granted each slave, in the current cycle and in the previous cycle:
+	signal owner, next_owner : master_index_array := (others => NO_MASTER);
+
+	-- Master that was last granted each slave, used for round-robin arbitration:
+	signal last_granted : master_index_array := (others => NUM_MASTERS - 1);
+
+	-- Signals to and from the slaves, including the error interface:
+	signal slave_inputs  : wishbone_master_inputs_array(0 to ERROR_SLAVE);
+	signal slave_outputs : wishbone_master_outputs_array(0 to ERROR_SLAVE);
+
+	--! Finds the slave an address belongs to.
+	function decode(address : in std_logic_vector(31 downto 0)) return slave_index is
+	begin
+		for i in 0 to NUM_SLAVES - 1 loop
+			if (address and ADDRESS_MAP(ADDRESS_MAP'low + i).mask) = ADDRESS_MAP(ADDRESS_MAP'low + i).base then
+				return i;
+			end if;
+		end loop;
+		return ERROR_SLAVE;
+	end function decode;
+
+begin
+
+	assert ADDRESS_MAP'length = NUM_SLAVES
+		report "The address map must contain one address range for each slave" severity FAILURE;
+
+	slave_inputs(0 to NUM_SLAVES - 1) <= s_inputs;
+	slave_inputs(ERROR_SLAVE) <= err_inputs;
+	s_outputs <= slave_outputs(0 to NUM_SLAVES - 1);
+	err_outputs <= slave_outputs(ERROR_SLAVE);
+
+	combinational_decode: if not REGISTERED_DECODE
+	generate
+		decode_targets: process(m_outputs)
+		begin
+			for m in 0 to NUM_MASTERS - 1 loop
+				if m_outputs(m).cyc = '1' and m_outputs(m).stb = '1' then
+					target(m) <= decode(m_outputs(m).adr);
+				else
+					target(m) <= NO_SLAVE;
+				end if;
+			end loop;
+		end process decode_targets;
+	end generate combinational_decode;
+
+	registered_decode: if REGISTERED_DECODE
+	generate
+		decode_targets: process(clk)
+		begin
+			if rising_edge(clk) then
+				if reset = '1' then
+					target <= (others => NO_SLAVE);
+				else
+					for m in 0 to NUM_MASTERS - 1 loop
+						if m_outputs(m).cyc = '0' then
+							target(m) <= NO_SLAVE;
+						elsif target(m) = NO_SLAVE and m_outputs(m).stb = '1' then
+							target(m) <= decode(m_outputs(m).adr);
+						end if;
+					end loop;
+				end if;
+			end if;
+		end process decode_targets;
+	end generate registered_decode;
+
+	arbitrate: process(owner, last_granted, target, m_outputs)
+		variable candidate : natural;
+	begin
+		for s in 0 to ERROR_SLAVE loop
+			next_owner(s) <= NO_MASTER;
+
+			if owner(s) /= NO_MASTER and m_outputs(owner(s)).cyc = '1' then
+				next_owner(s) <= owner(s);
+			else
+				for i in 1 to NUM_MASTERS loop
+					candidate := (last_granted(s) + i) mod NUM_MASTERS;
+					if target(candidate) = s then
+						next_owner(s) <= candidate;
+						exit;
+					end if;
+				end loop;
+			end if;
+		end loop;
+	end process arbitrate;
+
+	controller: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				owner <= (others => NO_MASTER);
+				last_granted <= (others => NUM_MASTERS - 1);
+			else
+				owner <= next_owner;
+
+				for s in 0 to ERROR_SLAVE loop
+					if next_owner(s) /= NO_MASTER then
+						last_granted(s) <= next_owner(s);
+					end if;
+				end loop;
+			end if;
+		end if;
+	end process controller;
+
+	-- Requests are only passed on to the slave a master addresses, also when it keeps other slaves:
+	slave_mux: process(next_owner, target, m_outputs)
+	begin
+		for s in 0 to ERROR_SLAVE loop
+			if next_owner(s) = NO_MASTER then
+				slave_outputs(s) <= (
+						adr => (others => '0'),
+						sel => (others => '0'),
+						cyc => '0',
+						stb => '0',
+						we => '0',
+						dat => (others => '0'),
+						cti => WB_CTI_CLASSIC,
+						bte => WB_BTE_LINEAR
+					);
+			else
+				slave_outputs(s) <= m_outputs(next_owner(s));
+				if target(next_owner(s)) /= s then
+					slave_outputs(s).stb <= '0';
+				end if;
+			end if;
+		end loop;
+	end process slave_mux;
+
+	master_mux: process(next_owner, target, slave_inputs)
+	begin
+		for m in 0 to NUM_MASTERS - 1 loop
+			m_inputs(m) <= (ack => '0', dat => (others => '0'), stall => '1');
+
+			for s in 0 to ERROR_SLAVE loop
+				if next_owner(s) = m then
+					if target(m) = s then
+						m_inputs(m).stall <= slave_inputs(s).stall;
+					end if;
+
+					if slave_inputs(s).ack = '1' then
+						m_inputs(m).ack <= '1';
+						m_inputs(m).dat <= slave_inputs(s).dat;
+					end if;
+				end if;
+			end loop;
+		end loop;
+	end process master_mux;
+
+	-- The acknowledges of the slaves owned by a master are combined, so they must not overlap:
+	check_acks: process(clk)
+		variable acks : natural;
+	begin
+		if rising_edge(clk) and reset = '0' then
+			for m in 0 to NUM_MASTERS - 1 loop
+				acks := 0;
+				for s in 0 to ERROR_SLAVE loop
+					if next_owner(s) = m and slave_inputs(s).ack = '1' then
+						acks := acks + 1;
+					end if;
+				end loop;
+
+				assert acks <= 1
+					report "Several slaves acknowledged a request from the same master in one cycle" severity FAILURE;
+			end loop;
+		end if;
+	end process check_acks;
+
+end architecture behaviour;
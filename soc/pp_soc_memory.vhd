@@ -6,12 +6,32 @@ library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
+use work.pp_constants.all;
 use work.pp_utilities.all;
 
 --! @brief Simple memory module for use in Wishbone-based systems.
+--! @details
+--!	Read cycles using incrementing bursts are supported with registered feedback,
+--!	so that a word is transferred in every cycle after the first. Write cycles
+--!	are always handled as classic cycles. A second interface allows instructions
+--!	to be fetched in parallel with data accesses in systems with separate
+--!	instruction and data buses. The second interface is read-only unless the
+--!	memory is configured as a true dual-port memory, in which case both
+--!	interfaces can read and write. Writing a word through one interface while
+--!	reading or writing it through the other in the same cycle gives undefined
+--!	results, as in the block RAM the memory is implemented in.
+--!
+--!	In pipelined mode, an interface uses Wishbone B4 pipelined cycles: a request
+--!	is accepted in every cycle and acknowledged in the next, so that one access
+--!	can be completed in every cycle. The stall outputs are never asserted, as
+--!	the memory is always ready to accept a request. Bursts are not used in this
+--!	mode.
 entity pp_soc_memory is
 	generic(
-		MEMORY_SIZE : natural := 4096 --! Memory size in bytes.
+		MEMORY_SIZE : natural := 4096;  --! Memory size in bytes.
+		PIPELINED   : boolean := false; --! Whether the first interface uses pipelined cycles.
+		PIPELINED2  : boolean := false; --! Whether the second interface uses pipelined cycles.
+		DUAL_PORT   : boolean := false  --! Whether the second interface can be used for writes.
 	);
 	port(
 		clk : in std_logic;
@@ -25,62 +45,211 @@ entity pp_soc_memory is
 		wb_stb_in  : in  std_logic;
 		wb_sel_in  : in  std_logic_vector( 3 downto 0);
 		wb_we_in   : in  std_logic;
-		wb_ack_out : out std_logic
+		wb_ack_out : out std_logic;
+		wb_cti_in  : in  std_logic_vector(2 downto 0) := WB_CTI_CLASSIC;
+		wb_bte_in  : in  std_logic_vector(1 downto 0) := WB_BTE_LINEAR;
+		wb_stall_out : out std_logic; -- Only used in pipelined mode
+
+		-- Second Wishbone interface, writable only if DUAL_PORT is set:
+		wb2_adr_in  : in  std_logic_vector(log2(MEMORY_SIZE) - 1 downto 0) := (others => '0');
+		wb2_dat_in  : in  std_logic_vector(31 downto 0) := (others => '0');
+		wb2_dat_out : out std_logic_vector(31 downto 0);
+		wb2_cyc_in  : in  std_logic := '0';
+		wb2_stb_in  : in  std_logic := '0';
+		wb2_sel_in  : in  std_logic_vector( 3 downto 0) := (others => '1');
+		wb2_we_in   : in  std_logic := '0';
+		wb2_ack_out : out std_logic;
+		wb2_cti_in  : in  std_logic_vector(2 downto 0) := WB_CTI_CLASSIC;
+		wb2_bte_in  : in  std_logic_vector(1 downto 0) := WB_BTE_LINEAR;
+		wb2_stall_out : out std_logic -- Only used in pipelined mode
 	);
 end entity pp_soc_memory;
 
 architecture behaviour of pp_soc_memory is
 	type memory_array is array(0 to (MEMORY_SIZE / 4) - 1) of std_logic_vector(31 downto 0);
-	signal memory : memory_array := (others => (others => '0'));
+
+	-- The memory is a shared variable so that both interfaces can write to it, which is required
+	-- for true dual-port block RAM to be inferred:
+	shared variable memory : memory_array := (others => (others => '0'));
 
 	attribute ram_style : string;
-	attribute ram_style of memory : signal is "block";
+	attribute ram_style of memory : variable is "block";
 
 	type state_type is (IDLE, ACK);
 	signal state : state_type;
 
 	signal read_ack : std_logic;
 
+	-- Address of the next transfer in a burst:
+	signal burst_address : std_logic_vector(log2(MEMORY_SIZE) - 1 downto 0);
+
+	-- Second interface signals:
+	signal state2 : state_type;
+	signal read_ack2 : std_logic;
+	signal burst_address2 : std_logic_vector(log2(MEMORY_SIZE) - 1 downto 0);
+
+	-- Writes to the second interface are ignored unless the memory is dual-ported:
+	signal write2 : std_logic;
+
 begin
 
-	wb_ack_out <= read_ack and wb_stb_in;
-
-	process(clk)
-	begin
-		if rising_edge(clk) then
-			if reset = '1' then
-				read_ack <= '0';
-				state <= IDLE;
-			else
-				if wb_cyc_in = '1' then
-					case state is
-						when IDLE =>
-							if wb_stb_in = '1' and wb_we_in = '1' then
-								 for i in 0 to 3 loop
-								 	if wb_sel_in(i) = '1' then
-								 		memory(to_integer(unsigned(wb_adr_in(wb_adr_in'left downto 2))))(((i + 1) * 8) - 1 downto i * 8)
-								 			<= wb_dat_in(((i + 1) * 8) - 1 downto i * 8);
-								 	end if;
-								 end loop;
-								 read_ack <= '1';
-								 state <= ACK;
-							elsif wb_stb_in = '1' then
-								wb_dat_out <= memory(to_integer(unsigned(wb_adr_in(wb_adr_in'left downto 2))));
-								read_ack <= '1';
-								state <= ACK;
-							end if;
-						when ACK =>
-							if wb_stb_in = '0' then
-								read_ack <= '0';
-								state <= IDLE;
-							end if;
-					end case;
-				else
+	burst_address <= wb_get_burst_next_address(wb_adr_in, wb_bte_in);
+	burst_address2 <= wb_get_burst_next_address(wb2_adr_in, wb2_bte_in);
+
+	-- The memory is always ready to accept a new request:
+	wb_stall_out <= '0';
+	wb2_stall_out <= '0';
+
+	write2 <= wb2_we_in when DUAL_PORT else '0';
+
+	classic_mode: if not PIPELINED
+	generate
+		wb_ack_out <= read_ack and wb_stb_in;
+
+		wishbone: process(clk)
+		begin
+			if rising_edge(clk) then
+				if reset = '1' then
+					read_ack <= '0';
 					state <= IDLE;
+				else
+					if wb_cyc_in = '1' then
+						case state is
+							when IDLE =>
+								if wb_stb_in = '1' and wb_we_in = '1' then
+									 for i in 0 to 3 loop
+									 	if wb_sel_in(i) = '1' then
+									 		memory(to_integer(unsigned(wb_adr_in(wb_adr_in'left downto 2))))(((i + 1) * 8) - 1 downto i * 8)
+									 			:= wb_dat_in(((i + 1) * 8) - 1 downto i * 8);
+									 	end if;
+									 end loop;
+									 read_ack <= '1';
+									 state <= ACK;
+								elsif wb_stb_in = '1' then
+									wb_dat_out <= memory(to_integer(unsigned(wb_adr_in(wb_adr_in'left downto 2))));
+									read_ack <= '1';
+									state <= ACK;
+								end if;
+							when ACK =>
+								if wb_stb_in = '1' and wb_we_in = '0' and wb_cti_in = WB_CTI_INCREMENT then
+									-- Continue the burst by reading the next word while the current one is acknowledged:
+									wb_dat_out <= memory(to_integer(unsigned(burst_address(burst_address'left downto 2))));
+								elsif wb_stb_in = '0' or wb_cti_in = WB_CTI_END then
+									read_ack <= '0';
+									state <= IDLE;
+								end if;
+						end case;
+					else
+						state <= IDLE;
+						read_ack <= '0';
+					end if;
+				end if;
+			end if;
+		end process wishbone;
+	end generate classic_mode;
+
+	pipelined_mode: if PIPELINED
+	generate
+		-- Requests are acknowledged in the cycle after they are made, regardless of the strobe signal:
+		wb_ack_out <= read_ack;
+
+		wishbone: process(clk)
+		begin
+			if rising_edge(clk) then
+				if reset = '1' then
 					read_ack <= '0';
+				else
+					read_ack <= wb_cyc_in and wb_stb_in;
+
+					if wb_cyc_in = '1' and wb_stb_in = '1' then
+						if wb_we_in = '1' then
+							for i in 0 to 3 loop
+								if wb_sel_in(i) = '1' then
+									memory(to_integer(unsigned(wb_adr_in(wb_adr_in'left downto 2))))(((i + 1) * 8) - 1 downto i * 8)
+										:= wb_dat_in(((i + 1) * 8) - 1 downto i * 8);
+								end if;
+							end loop;
+						else
+							wb_dat_out <= memory(to_integer(unsigned(wb_adr_in(wb_adr_in'left downto 2))));
+						end if;
+					end if;
+				end if;
+			end if;
+		end process wishbone;
+	end generate pipelined_mode;
+
+	classic_mode2: if not PIPELINED2
+	generate
+		wb2_ack_out <= read_ack2 and wb2_stb_in;
+
+		second_port: process(clk)
+		begin
+			if rising_edge(clk) then
+				if reset = '1' then
+					read_ack2 <= '0';
+					state2 <= IDLE;
+				else
+					if wb2_cyc_in = '1' then
+						case state2 is
+							when IDLE =>
+								if wb2_stb_in = '1' and write2 = '1' then
+									for i in 0 to 3 loop
+										if wb2_sel_in(i) = '1' then
+											memory(to_integer(unsigned(wb2_adr_in(wb2_adr_in'left downto 2))))(((i + 1) * 8) - 1 downto i * 8)
+												:= wb2_dat_in(((i + 1) * 8) - 1 downto i * 8);
+										end if;
+									end loop;
+									read_ack2 <= '1';
+									state2 <= ACK;
+								elsif wb2_stb_in = '1' then
+									wb2_dat_out <= memory(to_integer(unsigned(wb2_adr_in(wb2_adr_in'left downto 2))));
+									read_ack2 <= '1';
+									state2 <= ACK;
+								end if;
+							when ACK =>
+								if wb2_stb_in = '1' and write2 = '0' and wb2_cti_in = WB_CTI_INCREMENT then
+									wb2_dat_out <= memory(to_integer(unsigned(burst_address2(burst_address2'left downto 2))));
+								elsif wb2_stb_in = '0' or wb2_cti_in = WB_CTI_END then
+									read_ack2 <= '0';
+									state2 <= IDLE;
+								end if;
+						end case;
+					else
+						state2 <= IDLE;
+						read_ack2 <= '0';
+					end if;
+				end if;
+			end if;
+		end process second_port;
+	end generate classic_mode2;
+
+	pipelined_mode2: if PIPELINED2
+	generate
+		wb2_ack_out <= read_ack2;
+
+		second_port: process(clk)
+		begin
+			if rising_edge(clk) then
+				if reset = '1' then
+					read_ack2 <= '0';
+				else
+					read_ack2 <= wb2_cyc_in and wb2_stb_in;
+
+					if wb2_cyc_in = '1' and wb2_stb_in = '1' then
+						if write2 = '1' then
+							for i in 0 to 3 loop
+								if wb2_sel_in(i) = '1' then
+									memory(to_integer(unsigned(wb2_adr_in(wb2_adr_in'left downto 2))))(((i + 1) * 8) - 1 downto i * 8)
+										:= wb2_dat_in(((i + 1) * 8) - 1 downto i * 8);
+								end if;
+							end loop;
+						else
+							wb2_dat_out <= memory(to_integer(unsigned(wb2_adr_in(wb2_adr_in'left downto 2))));
+						end if;
+					end if;
 				end if;
 			end if;
-		end if;
-	end process;
+		end process second_port;
+	end generate pipelined_mode2;
 
 end architecture behaviour;
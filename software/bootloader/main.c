@@ -5,6 +5,7 @@
 #include <stdint.h>
 
 #include "platform.h"
+#include "potato.h"
 #include "uart.h"
 
 #define APP_START (0x00000000)
@@ -40,6 +41,9 @@ int main(void)
 	/* Print booting message */
 	uart_tx_string(&uart0, "\n\rBooting\n\r");
 
+	/* Write the application from the data cache to RAM and discard stale instructions so it can be fetched */
+	potato_icache_invalidate();
+
 	/* Jump in RAM */
 	goto *APP_ENTRY;
 
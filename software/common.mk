@@ -10,15 +10,36 @@ TARGET_SIZE := $(TARGET_PREFIX)-size
 TARGET_OBJCOPY := $(TARGET_PREFIX)-objcopy
 HEXDUMP ?= hexdump
 
-TARGET_CFLAGS +=  -march=rv32i_zicsr -Wall -Wextra -Os -fomit-frame-pointer \
+# ISA extensions enabled in the processor, set to n to build for a processor without them:
+M_EXTENSION ?= y
+ZBB_EXTENSION ?= y
+ZKNH_EXTENSION ?= y
+C_EXTENSION ?= y
+
+TARGET_ARCH := rv32i
+ifeq ($(M_EXTENSION),y)
+TARGET_ARCH := $(TARGET_ARCH)m
+endif
+ifeq ($(C_EXTENSION),y)
+TARGET_ARCH := $(TARGET_ARCH)c
+endif
+TARGET_ARCH := $(TARGET_ARCH)_zicsr_zifencei
+ifeq ($(ZBB_EXTENSION),y)
+TARGET_ARCH := $(TARGET_ARCH)_zbb_zbkb
+endif
+ifeq ($(ZKNH_EXTENSION),y)
+TARGET_ARCH := $(TARGET_ARCH)_zknh
+endif
+
+TARGET_CFLAGS +=  -march=$(TARGET_ARCH) -Wall -Wextra -Os -fomit-frame-pointer \
 	-ffreestanding -fno-builtin -fanalyzer -I../.. -I../../libsoc -std=gnu99 \
 	-Wall -Werror=implicit-function-declaration -ffunction-sections -fdata-sections
-TARGET_LDFLAGS += -march=rv32i_zicsr -nostartfiles -L../libsoc \
+TARGET_LDFLAGS += -march=$(TARGET_ARCH) -nostartfiles -L../libsoc \
 	-Wl,-m,elf32lriscv --specs=nosys.specs -Wl,--no-relax -Wl,--gc-sections
 
 # Rule for converting an ELF file to a binary file:
 %.bin: %.elf
-	$(TARGET_OBJCOPY) -j .text -j .data -j .rodata -O binary $< $@
+	$(TARGET_OBJCOPY) -j .text -j .data -j .rodata -j .tcm_text -j .tcm_data -O binary $< $@
 
 # Rule for generating coefficient files for initializing block RAM resources
 # from binary files:
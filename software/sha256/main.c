@@ -23,6 +23,7 @@ static struct icerror icerror0;
 
 static uint8_t led_status = 0x01;
 static volatile unsigned int hashes_per_second = 0;
+static volatile unsigned int cycles_per_block = 0;
 static volatile bool reset_counter = true;
 
 // Converts an integer to a string:
@@ -44,7 +45,13 @@ void exception_handler(uint32_t mcause, uint32_t mepc, uint32_t sp)
 				char hps_dec[11];
 				int2string(hashes_per_second, hps_dec);
 				uart_tx_string(&uart0, hps_dec);
-				uart_tx_string(&uart0, " H/s\n\r");
+				uart_tx_string(&uart0, " H/s, ");
+
+				// Print the number of cycles used to hash the last block:
+				char cpb_dec[11];
+				int2string(cycles_per_block, cpb_dec);
+				uart_tx_string(&uart0, cpb_dec);
+				uart_tx_string(&uart0, " cycles/block\n\r");
 				reset_counter = true;
 
 				timer_clear(&timer0);
@@ -163,7 +170,9 @@ int main(void)
 		uint8_t hash[32];
 
 		sha256_reset(&context);
+		uint32_t start_cycles = potato_get_cycles();
 		sha256_hash_block(&context, block);
+		cycles_per_block = potato_get_cycles() - start_cycles;
 		sha256_get_hash(&context, hash);
 
 		potato_disable_interrupts();
@@ -3,11 +3,18 @@
 // Report bugs and issues on <https://github.com/skordal/potato/issues>
 
 #include "platform.h"
+#include "potato.h"
 #include "gpio.h"
 
 #include "sha256.h"
 
+// Use rev8 to swap the byte order when the Zbb extension is available. Rotations are
+// also compiled to single instructions when building for Zbb:
+#ifdef __riscv_zbb
+#define htobe32(n)	__builtin_bswap32(n)
+#else
 #define htobe32(n)	((uint32_t) ((n << 24) | ((n << 8) & 0xff0000) | ((n >> 8) & 0xff00) | (n >> 24)))
+#endif
 
 // Software SHA256 module
 
@@ -29,11 +36,6 @@ static const uint32_t constants[64] =
 	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
 };
 
-static uint32_t rotate_right(uint32_t x, int n)
-{
-	return (x >> n) | (x << (32 - n));
-}
-
 static uint32_t Ch(uint32_t x, uint32_t y, uint32_t z)
 {
 	return (x & y) ^ ((~x) & z);
@@ -44,6 +46,29 @@ static uint32_t Maj(uint32_t x, uint32_t y, uint32_t z)
 	return (x & y) ^ (x & z) ^ (y & z);
 }
 
+#ifdef SHA256_USE_ZKNH
+
+// The sigma and sum functions are implemented by single instructions in the Zknh extension:
+#define SHA256_INSTRUCTION(name, instruction) \
+	static uint32_t name(uint32_t x) \
+	{ \
+		uint32_t retval; \
+		asm(instruction " %[retval], %[x]\n" : [retval] "=r" (retval) : [x] "r" (x)); \
+		return retval; \
+	}
+
+SHA256_INSTRUCTION(s0, "sha256sum0")
+SHA256_INSTRUCTION(s1, "sha256sum1")
+SHA256_INSTRUCTION(o0, "sha256sig0")
+SHA256_INSTRUCTION(o1, "sha256sig1")
+
+#else
+
+static uint32_t rotate_right(uint32_t x, int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
 static uint32_t s0(uint32_t x)
 {
 	return rotate_right(x, 2) ^ rotate_right(x, 13) ^ rotate_right(x, 22);
@@ -64,6 +89,8 @@ static uint32_t o1(uint32_t x)
 	return rotate_right(x, 17) ^ rotate_right(x, 19) ^ (x >> 10);
 }
 
+#endif
+
 static uint32_t schedule(uint32_t input, const uint32_t * W, int i)
 {
 	if(i < 16)
@@ -105,7 +132,8 @@ void sha256_reset(struct sha256_context * ctx)
 		ctx->intermediate[i] = initial[i];
 }
 
-void sha256_hash_block(struct sha256_context * ctx, const uint32_t * data)
+// The compression function is run from the instruction TCM:
+POTATO_TCM_TEXT void sha256_hash_block(struct sha256_context * ctx, const uint32_t * data)
 {
 	uint32_t W[64];
 	uint32_t temp[8];
@@ -15,6 +15,10 @@ use work.pp_types.all;
 --! 	Performs logic and arithmetic calculations. The operation to perform
 --!	is specified by the user of the module.
 entity pp_alu is
+	generic(
+		ZBB_EXTENSION  : boolean := false; --! Whether to implement the Zbb and Zbkb bit-manipulation operations.
+		ZKNH_EXTENSION : boolean := false  --! Whether to implement the SHA-256 operations from the Zknh extension.
+	);
 	port(
 		x, y      : in  std_logic_vector(31 downto 0); --! Input operand.
 		result    : out std_logic_vector(31 downto 0); --! Operation result.
@@ -24,10 +28,63 @@ end entity pp_alu;
 
 --! @brief Behavioural description of the ALU.
 architecture behaviour of pp_alu is
+
+	--! Result of the bit-manipulation operations.
+	signal bitmanip_result : std_logic_vector(31 downto 0);
+
+	--! Result of the SHA-256 operations.
+	signal sha256_result : std_logic_vector(31 downto 0);
+
+	--! Rotates a word to the right.
+	function rotr(input : in std_logic_vector(31 downto 0); n : in natural) return std_logic_vector is
+	begin
+		return std_logic_vector(rotate_right(unsigned(input), n));
+	end function rotr;
+
+	--! Shifts a word to the right.
+	function shr(input : in std_logic_vector(31 downto 0); n : in natural) return std_logic_vector is
+	begin
+		return std_logic_vector(shift_right(unsigned(input), n));
+	end function shr;
+
+	--! Counts the number of leading zero bits in a word.
+	function count_leading_zeroes(input : in std_logic_vector(31 downto 0)) return natural is
+	begin
+		for i in 31 downto 0 loop
+			if input(i) = '1' then
+				return 31 - i;
+			end if;
+		end loop;
+		return 32;
+	end function count_leading_zeroes;
+
+	--! Counts the number of trailing zero bits in a word.
+	function count_trailing_zeroes(input : in std_logic_vector(31 downto 0)) return natural is
+	begin
+		for i in 0 to 31 loop
+			if input(i) = '1' then
+				return i;
+			end if;
+		end loop;
+		return 32;
+	end function count_trailing_zeroes;
+
+	--! Counts the number of bits set in a word.
+	function count_ones(input : in std_logic_vector(31 downto 0)) return natural is
+		variable retval : natural range 0 to 32 := 0;
+	begin
+		for i in 0 to 31 loop
+			if input(i) = '1' then
+				retval := retval + 1;
+			end if;
+		end loop;
+		return retval;
+	end function count_ones;
+
 begin
 
 	--! Performs the ALU calculation.
-	calculate: process(operation, x, y)
+	calculate: process(operation, x, y, bitmanip_result, sha256_result)
 	begin
 		case operation is
 			when ALU_AND =>
@@ -58,9 +115,132 @@ begin
 				result <= std_logic_vector(shift_left(unsigned(x), to_integer(unsigned(y(4 downto 0)))));
 			when ALU_SRA =>
 				result <= std_logic_vector(shift_right(signed(x), to_integer(unsigned(y(4 downto 0)))));
+			when ALU_ANDN | ALU_ORN | ALU_XNOR | ALU_CLZ | ALU_CTZ | ALU_CPOP
+				| ALU_MIN | ALU_MINU | ALU_MAX | ALU_MAXU | ALU_SEXTB | ALU_SEXTH
+				| ALU_ROL | ALU_ROR | ALU_REV8 | ALU_ORCB | ALU_BREV8
+				| ALU_PACK | ALU_PACKH | ALU_ZIP | ALU_UNZIP =>
+				result <= bitmanip_result;
+			when ALU_SHA256SUM0 | ALU_SHA256SUM1 | ALU_SHA256SIG0 | ALU_SHA256SIG1 =>
+				result <= sha256_result;
 			when others =>
 				result <= (others => '0');
 		end case;
 	end process calculate;
 
+	bitmanip_enabled: if ZBB_EXTENSION
+	generate
+		--! Performs the bit-manipulation operations from the Zbb and Zbkb extensions.
+		calculate_bitmanip: process(operation, x, y)
+		begin
+			case operation is
+				when ALU_ANDN =>
+					bitmanip_result <= x and not y;
+				when ALU_ORN =>
+					bitmanip_result <= x or not y;
+				when ALU_XNOR =>
+					bitmanip_result <= not (x xor y);
+				when ALU_CLZ =>
+					bitmanip_result <= std_logic_vector(to_unsigned(count_leading_zeroes(x), bitmanip_result'length));
+				when ALU_CTZ =>
+					bitmanip_result <= std_logic_vector(to_unsigned(count_trailing_zeroes(x), bitmanip_result'length));
+				when ALU_CPOP =>
+					bitmanip_result <= std_logic_vector(to_unsigned(count_ones(x), bitmanip_result'length));
+				when ALU_MIN =>
+					if signed(x) < signed(y) then
+						bitmanip_result <= x;
+					else
+						bitmanip_result <= y;
+					end if;
+				when ALU_MINU =>
+					if unsigned(x) < unsigned(y) then
+						bitmanip_result <= x;
+					else
+						bitmanip_result <= y;
+					end if;
+				when ALU_MAX =>
+					if signed(x) < signed(y) then
+						bitmanip_result <= y;
+					else
+						bitmanip_result <= x;
+					end if;
+				when ALU_MAXU =>
+					if unsigned(x) < unsigned(y) then
+						bitmanip_result <= y;
+					else
+						bitmanip_result <= x;
+					end if;
+				when ALU_SEXTB =>
+					bitmanip_result <= std_logic_vector(resize(signed(x(7 downto 0)), bitmanip_result'length));
+				when ALU_SEXTH =>
+					bitmanip_result <= std_logic_vector(resize(signed(x(15 downto 0)), bitmanip_result'length));
+				when ALU_ROL =>
+					bitmanip_result <= std_logic_vector(rotate_left(unsigned(x), to_integer(unsigned(y(4 downto 0)))));
+				when ALU_ROR =>
+					bitmanip_result <= std_logic_vector(rotate_right(unsigned(x), to_integer(unsigned(y(4 downto 0)))));
+				when ALU_REV8 =>
+					bitmanip_result <= x(7 downto 0) & x(15 downto 8) & x(23 downto 16) & x(31 downto 24);
+				when ALU_ORCB =>
+					for i in 0 to 3 loop
+						if x(i * 8 + 7 downto i * 8) = x"00" then
+							bitmanip_result(i * 8 + 7 downto i * 8) <= x"00";
+						else
+							bitmanip_result(i * 8 + 7 downto i * 8) <= x"ff";
+						end if;
+					end loop;
+				when ALU_BREV8 =>
+					for i in 0 to 3 loop
+						for j in 0 to 7 loop
+							bitmanip_result(i * 8 + j) <= x(i * 8 + 7 - j);
+						end loop;
+					end loop;
+				when ALU_PACK =>
+					bitmanip_result <= y(15 downto 0) & x(15 downto 0);
+				when ALU_PACKH =>
+					bitmanip_result <= x"0000" & y(7 downto 0) & x(7 downto 0);
+				when ALU_ZIP =>
+					for i in 0 to 15 loop
+						bitmanip_result(i * 2) <= x(i);
+						bitmanip_result(i * 2 + 1) <= x(i + 16);
+					end loop;
+				when ALU_UNZIP =>
+					for i in 0 to 15 loop
+						bitmanip_result(i) <= x(i * 2);
+						bitmanip_result(i + 16) <= x(i * 2 + 1);
+					end loop;
+				when others =>
+					bitmanip_result <= (others => '0');
+			end case;
+		end process calculate_bitmanip;
+	end generate bitmanip_enabled;
+
+	bitmanip_disabled: if not ZBB_EXTENSION
+	generate
+		bitmanip_result <= (others => '0');
+	end generate bitmanip_disabled;
+
+	sha256_enabled: if ZKNH_EXTENSION
+	generate
+		--! Performs the SHA-256 sigma and sum functions from the Zknh extension.
+		calculate_sha256: process(operation, x)
+		begin
+			case operation is
+				when ALU_SHA256SUM0 =>
+					sha256_result <= rotr(x, 2) xor rotr(x, 13) xor rotr(x, 22);
+				when ALU_SHA256SUM1 =>
+					sha256_result <= rotr(x, 6) xor rotr(x, 11) xor rotr(x, 25);
+				when ALU_SHA256SIG0 =>
+					sha256_result <= rotr(x, 7) xor rotr(x, 18) xor shr(x, 3);
+				when ALU_SHA256SIG1 =>
+					sha256_result <= rotr(x, 17) xor rotr(x, 19) xor shr(x, 10);
+				when others =>
+					sha256_result <= (others => '0');
+			end case;
+		end process calculate_sha256;
+	end generate sha256_enabled;
+
+	sha256_disabled: if not ZKNH_EXTENSION
+	generate
+		sha256_result <= (others => '0');
+	end generate sha256_disabled;
+
 end architecture behaviour;
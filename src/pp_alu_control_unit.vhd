@@ -9,10 +9,16 @@ use work.pp_types.all;
 use work.pp_constants.all;
 
 entity pp_alu_control_unit is
+	generic(
+		M_EXTENSION    : boolean := false; -- Whether to decode the M extension instructions.
+		ZBB_EXTENSION  : boolean := false; -- Whether to decode the Zbb and Zbkb extension instructions.
+		ZKNH_EXTENSION : boolean := false  -- Whether to decode the SHA-256 instructions from the Zknh extension.
+	);
 	port(
 		opcode  : in std_logic_vector( 4 downto 0);
 		funct3  : in std_logic_vector( 2 downto 0);
 		funct7  : in std_logic_vector( 6 downto 0);
+		funct12 : in std_logic_vector(11 downto 0);
 		
 		-- Sources of ALU operands:
 		alu_x_src, alu_y_src : out alu_operand_source;
@@ -25,7 +31,7 @@ end entity pp_alu_control_unit;
 architecture behaviour of pp_alu_control_unit is
 begin
 
-	decode_alu: process(opcode, funct3, funct7)
+	decode_alu: process(opcode, funct3, funct7, funct12)
 	begin
 		case opcode is
 			when b"01101" => -- Load upper immediate
@@ -71,7 +77,34 @@ begin
 					when b"000" =>
 						alu_op <= ALU_ADD;
 					when b"001" =>
-						alu_op <= ALU_SLL;
+						if ZBB_EXTENSION and funct7 = b"0110000" then -- Unary bit-manipulation operations
+							case funct12(4 downto 0) is
+								when b"00000" =>
+									alu_op <= ALU_CLZ;
+								when b"00001" =>
+									alu_op <= ALU_CTZ;
+								when b"00010" =>
+									alu_op <= ALU_CPOP;
+								when b"00100" =>
+									alu_op <= ALU_SEXTB;
+								when b"00101" =>
+									alu_op <= ALU_SEXTH;
+								when others =>
+									alu_op <= ALU_INVALID;
+							end case;
+						elsif ZBB_EXTENSION and funct12 = x"08f" then
+							alu_op <= ALU_ZIP;
+						elsif ZKNH_EXTENSION and funct12 = x"100" then
+							alu_op <= ALU_SHA256SUM0;
+						elsif ZKNH_EXTENSION and funct12 = x"101" then
+							alu_op <= ALU_SHA256SUM1;
+						elsif ZKNH_EXTENSION and funct12 = x"102" then
+							alu_op <= ALU_SHA256SIG0;
+						elsif ZKNH_EXTENSION and funct12 = x"103" then
+							alu_op <= ALU_SHA256SIG1;
+						else
+							alu_op <= ALU_SLL;
+						end if;
 					when b"010" =>
 						alu_op <= ALU_SLT;
 					when b"011" =>
@@ -79,7 +112,17 @@ begin
 					when b"100" =>
 						alu_op <= ALU_XOR;
 					when b"101" =>
-						if funct7 = b"0000000" then
+						if ZBB_EXTENSION and funct7 = b"0110000" then
+							alu_op <= ALU_ROR;
+						elsif ZBB_EXTENSION and funct12 = x"287" then
+							alu_op <= ALU_ORCB;
+						elsif ZBB_EXTENSION and funct12 = x"698" then
+							alu_op <= ALU_REV8;
+						elsif ZBB_EXTENSION and funct12 = x"687" then
+							alu_op <= ALU_BREV8;
+						elsif ZBB_EXTENSION and funct12 = x"08f" then
+							alu_op <= ALU_UNZIP;
+						elsif funct7 = b"0000000" then
 							alu_op <= ALU_SRL;
 						else
 							alu_op <= ALU_SRA;
@@ -95,34 +138,91 @@ begin
 				alu_x_src <= ALU_SRC_REG;
 				alu_y_src <= ALU_SRC_REG;
 
-				case funct3 is
-					when b"000" =>
-						if funct7 = b"0000000" then
-							alu_op <= ALU_ADD;
-						else
-							alu_op <= ALU_SUB;
-						end if;
-					when b"001" =>
-						alu_op <= ALU_SLL;
-					when b"010" =>
-						alu_op <= ALU_SLT;
-					when b"011" =>
-						alu_op <= ALU_SLTU;
-					when b"100" =>
-						alu_op <= ALU_XOR;
-					when b"101" =>
-						if funct7 = b"0000000" then
-							alu_op <= ALU_SRL;
-						else
-							alu_op <= ALU_SRA;
-						end if;
-					when b"110" =>
-						alu_op <= ALU_OR;
-					when b"111" =>
-						alu_op <= ALU_AND;
-					when others =>
+				if funct7 = b"0000001" then -- Multiplication and division operations
+					if M_EXTENSION then
+						case funct3 is
+							when b"000" =>
+								alu_op <= ALU_MUL;
+							when b"001" =>
+								alu_op <= ALU_MULH;
+							when b"010" =>
+								alu_op <= ALU_MULHSU;
+							when b"011" =>
+								alu_op <= ALU_MULHU;
+							when b"100" =>
+								alu_op <= ALU_DIV;
+							when b"101" =>
+								alu_op <= ALU_DIVU;
+							when b"110" =>
+								alu_op <= ALU_REM;
+							when b"111" =>
+								alu_op <= ALU_REMU;
+							when others =>
+								alu_op <= ALU_INVALID;
+						end case;
+					else
 						alu_op <= ALU_INVALID;
-				end case;
+					end if;
+				else
+					case funct3 is
+						when b"000" =>
+							if funct7 = b"0000000" then
+								alu_op <= ALU_ADD;
+							else
+								alu_op <= ALU_SUB;
+							end if;
+						when b"001" =>
+							if ZBB_EXTENSION and funct7 = b"0110000" then
+								alu_op <= ALU_ROL;
+							else
+								alu_op <= ALU_SLL;
+							end if;
+						when b"010" =>
+							alu_op <= ALU_SLT;
+						when b"011" =>
+							alu_op <= ALU_SLTU;
+						when b"100" =>
+							if ZBB_EXTENSION and funct7 = b"0100000" then
+								alu_op <= ALU_XNOR;
+							elsif ZBB_EXTENSION and funct7 = b"0000101" then
+								alu_op <= ALU_MIN;
+							elsif ZBB_EXTENSION and funct7 = b"0000100" then -- Also used for zext.h
+								alu_op <= ALU_PACK;
+							else
+								alu_op <= ALU_XOR;
+							end if;
+						when b"101" =>
+							if ZBB_EXTENSION and funct7 = b"0110000" then
+								alu_op <= ALU_ROR;
+							elsif ZBB_EXTENSION and funct7 = b"0000101" then
+								alu_op <= ALU_MINU;
+							elsif funct7 = b"0000000" then
+								alu_op <= ALU_SRL;
+							else
+								alu_op <= ALU_SRA;
+							end if;
+						when b"110" =>
+							if ZBB_EXTENSION and funct7 = b"0100000" then
+								alu_op <= ALU_ORN;
+							elsif ZBB_EXTENSION and funct7 = b"0000101" then
+								alu_op <= ALU_MAX;
+							else
+								alu_op <= ALU_OR;
+							end if;
+						when b"111" =>
+							if ZBB_EXTENSION and funct7 = b"0100000" then
+								alu_op <= ALU_ANDN;
+							elsif ZBB_EXTENSION and funct7 = b"0000101" then
+								alu_op <= ALU_MAXU;
+							elsif ZBB_EXTENSION and funct7 = b"0000100" then
+								alu_op <= ALU_PACKH;
+							else
+								alu_op <= ALU_AND;
+							end if;
+						when others =>
+							alu_op <= ALU_INVALID;
+					end case;
+				end if;
 			when b"00011" => -- Fence instructions, ignored
 				alu_x_src <= ALU_SRC_REG;
 				alu_y_src <= ALU_SRC_REG;
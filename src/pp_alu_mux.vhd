@@ -17,6 +17,7 @@ entity pp_alu_mux is
 		immediate_value : in std_logic_vector(31 downto 0);
 		shamt_value     : in std_logic_vector( 4 downto 0);
 		pc_value        : in std_logic_vector(31 downto 0);
+		pc_next_value   : in std_logic_vector(31 downto 0);
 		csr_value       : in std_logic_vector(31 downto 0);
 
 		output : out std_logic_vector(31 downto 0)
@@ -26,7 +27,7 @@ end entity pp_alu_mux;
 architecture behaviour of pp_alu_mux is
 begin
 
-	mux: process(source, register_value, immediate_value, shamt_value, pc_value, csr_value)
+	mux: process(source, register_value, immediate_value, shamt_value, pc_value, pc_next_value, csr_value)
 	begin
 		case source is
 			when ALU_SRC_REG =>
@@ -36,7 +37,7 @@ begin
 			when ALU_SRC_PC =>
 				output <= pc_value;
 			when ALU_SRC_PC_NEXT =>
-				output <= std_logic_vector(unsigned(pc_value) + 4);
+				output <= pc_next_value;
 			when ALU_SRC_CSR =>
 				output <= csr_value;
 			when ALU_SRC_SHAMT =>
@@ -0,0 +1,142 @@
+-- The Potato Processor - A simple processor for FPGAs
+-- (c) Kristian Klomsten Skordal 2014 - 2015 <kristian.skordal@wafflemail.net>
+-- Report bugs and issues on <https://github.com/skordal/potato/issues>
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.pp_types.all;
+use work.pp_utilities.all;
+
+--! @brief Dynamic branch predictor.
+--! @details
+--!	Predicts the outcome of branches and jumps in the fetch stage using a
+--!	direct-mapped branch target buffer (BTB) and a bimodal branch history
+--!	table (BHT) of 2-bit saturating counters. Conditional branches are
+--!	predicted taken when they hit in the BTB and their counter is in one
+--!	of the two taken states; unconditional jumps are always predicted taken
+--!	when they hit in the BTB. The tables are updated with the outcome of
+--!	branches resolved in the execute stage.
+--!
+--!	With the C extension, instructions can start on halfword boundaries, and
+--!	the tables are indexed from bit 1 of the address so that instructions in
+--!	the same memory word do not share entries.
+entity pp_branch_predictor is
+	generic(
+		BTB_NUM_ENTRIES : natural := 32; --! Number of entries in the branch target buffer.
+		BHT_NUM_ENTRIES : natural := 128;  --! Number of counters in the branch history table.
+		C_EXTENSION     : boolean := false --! Whether instructions can start on halfword boundaries.
+	);
+	port(
+		clk   : in std_logic;
+		reset : in std_logic;
+
+		-- Prediction interface:
+		lookup_address    : in  std_logic_vector(31 downto 0); --! Address of the instruction being fetched.
+		prediction_taken  : out std_logic;                     --! Set if the instruction is predicted to be a taken branch.
+		prediction_target : out std_logic_vector(31 downto 0); --! Predicted target of the branch.
+
+		-- Update interface:
+		update         : in std_logic;                     --! Updates the predictor with the outcome of an instruction.
+		update_address : in std_logic_vector(31 downto 0); --! Address of the resolved instruction.
+		update_branch  : in branch_type;                   --! Branch type of the resolved instruction.
+		update_taken   : in std_logic;                     --! Set if the resolved branch was taken.
+		update_target  : in std_logic_vector(31 downto 0)  --! Target address of the resolved branch.
+	);
+end entity pp_branch_predictor;
+
+architecture behaviour of pp_branch_predictor is
+
+	constant BTB_INDEX_BITS : natural := log2(BTB_NUM_ENTRIES);
+	constant BHT_INDEX_BITS : natural := log2(BHT_NUM_ENTRIES);
+
+	--! Returns the lowest address bit used to index the tables.
+	function get_index_low return natural is
+	begin
+		if C_EXTENSION then
+			return 1;
+		else
+			return 2;
+		end if;
+	end function get_index_low;
+
+	constant INDEX_LOW : natural := get_index_low;
+
+	-- Branch target buffer types:
+	subtype btb_tag_type is std_logic_vector(31 downto BTB_INDEX_BITS + INDEX_LOW);
+	type btb_tag_array is array(0 to BTB_NUM_ENTRIES - 1) of btb_tag_type;
+	type btb_target_array is array(0 to BTB_NUM_ENTRIES - 1) of std_logic_vector(31 downto 0);
+
+	-- Branch history table types:
+	subtype bht_counter_type is unsigned(1 downto 0);
+	type bht_counter_array is array(0 to BHT_NUM_ENTRIES - 1) of bht_counter_type;
+
+	-- Branch target buffer memories:
+	signal btb_tags          : btb_tag_array;
+	signal btb_targets       : btb_target_array;
+	signal btb_valid         : std_logic_vector(BTB_NUM_ENTRIES - 1 downto 0) := (others => '0');
+	signal btb_unconditional : std_logic_vector(BTB_NUM_ENTRIES - 1 downto 0);
+
+	-- Branch history table, counters are initialized to weakly not taken:
+	signal bht_counters : bht_counter_array := (others => b"01");
+
+	-- Table indices:
+	signal lookup_btb_index, update_btb_index : natural range 0 to BTB_NUM_ENTRIES - 1;
+	signal lookup_bht_index, update_bht_index : natural range 0 to BHT_NUM_ENTRIES - 1;
+
+	signal btb_hit : std_logic;
+
+begin
+
+	assert is_pow2(BTB_NUM_ENTRIES) report "Number of BTB entries must be a power of 2!" severity FAILURE;
+	assert is_pow2(BHT_NUM_ENTRIES) report "Number of BHT entries must be a power of 2!" severity FAILURE;
+
+	lookup_btb_index <= to_integer(unsigned(lookup_address(BTB_INDEX_BITS + INDEX_LOW - 1 downto INDEX_LOW)));
+	lookup_bht_index <= to_integer(unsigned(lookup_address(BHT_INDEX_BITS + INDEX_LOW - 1 downto INDEX_LOW)));
+	update_btb_index <= to_integer(unsigned(update_address(BTB_INDEX_BITS + INDEX_LOW - 1 downto INDEX_LOW)));
+	update_bht_index <= to_integer(unsigned(update_address(BHT_INDEX_BITS + INDEX_LOW - 1 downto INDEX_LOW)));
+
+	btb_hit <= btb_valid(lookup_btb_index) and to_std_logic(btb_tags(lookup_btb_index) = lookup_address(31 downto BTB_INDEX_BITS + INDEX_LOW));
+
+	prediction_taken <= btb_hit and (btb_unconditional(lookup_btb_index) or bht_counters(lookup_bht_index)(1));
+	prediction_target <= btb_targets(lookup_btb_index);
+
+	update_btb: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				btb_valid <= (others => '0');
+			elsif update = '1' then
+				case update_branch is
+					when BRANCH_JUMP | BRANCH_JUMP_INDIRECT | BRANCH_CONDITIONAL =>
+						if update_taken = '1' then
+							btb_valid(update_btb_index) <= '1';
+							btb_tags(update_btb_index) <= update_address(31 downto BTB_INDEX_BITS + INDEX_LOW);
+							btb_targets(update_btb_index) <= update_target;
+							btb_unconditional(update_btb_index) <= to_std_logic(update_branch /= BRANCH_CONDITIONAL);
+						end if;
+					when others =>
+						-- Remove stale entries for instructions that are not predictable branches:
+						if btb_tags(update_btb_index) = update_address(31 downto BTB_INDEX_BITS + INDEX_LOW) then
+							btb_valid(update_btb_index) <= '0';
+						end if;
+				end case;
+			end if;
+		end if;
+	end process update_btb;
+
+	update_bht: process(clk)
+	begin
+		if rising_edge(clk) then
+			if update = '1' and update_branch = BRANCH_CONDITIONAL then
+				if update_taken = '1' and bht_counters(update_bht_index) /= b"11" then
+					bht_counters(update_bht_index) <= bht_counters(update_bht_index) + 1;
+				elsif update_taken = '0' and bht_counters(update_bht_index) /= b"00" then
+					bht_counters(update_bht_index) <= bht_counters(update_bht_index) - 1;
+				end if;
+			end if;
+		end if;
+	end process update_bht;
+
+end architecture behaviour;
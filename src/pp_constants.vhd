@@ -12,4 +12,15 @@ package pp_constants is
 	--! No-operation instruction, addi x0, x0, 0.
 	constant RISCV_NOP : std_logic_vector(31 downto 0) := (31 downto 5 => '0') & b"10011"; --! ADDI x0, x0, 0.
 
+	--! Wishbone cycle type identifiers:
+	constant WB_CTI_CLASSIC   : std_logic_vector(2 downto 0) := b"000"; --! Classic cycle.
+	constant WB_CTI_INCREMENT : std_logic_vector(2 downto 0) := b"010"; --! Incrementing burst cycle.
+	constant WB_CTI_END       : std_logic_vector(2 downto 0) := b"111"; --! Last transfer of a burst.
+
+	--! Wishbone burst type extensions:
+	constant WB_BTE_LINEAR : std_logic_vector(1 downto 0) := b"00"; --! Linear burst.
+	constant WB_BTE_WRAP4  : std_logic_vector(1 downto 0) := b"01"; --! 4-beat wrap burst.
+	constant WB_BTE_WRAP8  : std_logic_vector(1 downto 0) := b"10"; --! 8-beat wrap burst.
+	constant WB_BTE_WRAP16 : std_logic_vector(1 downto 0) := b"11"; --! 16-beat wrap burst.
+
 end package pp_constants;
@@ -17,6 +17,11 @@ use work.pp_utilities.all;
 --!	Unknown or otherwise invalid instructions will cause an exception to
 --!	be signaled.
 entity pp_control_unit is
+	generic(
+		M_EXTENSION    : boolean := false; --! Whether to decode the M extension instructions.
+		ZBB_EXTENSION  : boolean := false; --! Whether to decode the Zbb and Zbkb extension instructions.
+		ZKNH_EXTENSION : boolean := false  --! Whether to decode the SHA-256 instructions from the Zknh extension.
+	);
 	port(
 		-- Inputs, indices correspond to instruction word indices:
 		opcode  : in std_logic_vector( 4 downto 0); --! Instruction opcode field.
@@ -44,7 +49,10 @@ entity pp_control_unit is
 
 		-- Memory transaction parameters:
 		mem_op   : out memory_operation_type; --! Memory operation to perform for the instruction.
-		mem_size : out memory_operation_size  --! Size of the memory operation to perform.
+		mem_size : out memory_operation_size; --! Size of the memory operation to perform.
+
+		-- Memory ordering:
+		fence : out std_logic --! Signals that the instruction is a fence instruction.
 	);
 end entity pp_control_unit;
 
@@ -57,6 +65,7 @@ begin
 
 	csr_imm <= funct3(2);
 	alu_op <= alu_op_temp;
+	fence <= to_std_logic(opcode = b"00011");
 
 	decode_exception <= exception or to_std_logic(alu_op_temp = ALU_INVALID);
 	decode_exception_cause <= exception_cause when alu_op_temp /= ALU_INVALID
@@ -66,10 +75,15 @@ begin
 	--! @details Decodes arithmetic and logic instructions and sets the
 	--!          control signals relating to the ALU.
 	alu_control: entity work.pp_alu_control_unit
-		port map(
+		generic map(
+			M_EXTENSION => M_EXTENSION,
+			ZBB_EXTENSION => ZBB_EXTENSION,
+			ZKNH_EXTENSION => ZKNH_EXTENSION
+		) port map(
 			opcode => opcode,
 			funct3 => funct3,
 			funct7 => funct7,
+			funct12 => funct12,
 			alu_x_src => alu_x_src,
 			alu_y_src => alu_y_src,
 			alu_op => alu_op_temp
@@ -124,7 +138,7 @@ begin
 				exception <= '0';
 				exception_cause <= CSR_CAUSE_NONE;
 				branch <= BRANCH_NONE;
-			when b"00011" => -- Fence instructions, ignored
+			when b"00011" => -- Fence instructions
 				rd_write <= '0';
 				exception <= '0';
 				exception_cause <= CSR_CAUSE_NONE;
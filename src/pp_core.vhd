@@ -17,7 +17,21 @@ entity pp_core is
 		PROCESSOR_ID           : std_logic_vector(31 downto 0) := x"00000000"; --! Processor ID.
 		RESET_ADDRESS          : std_logic_vector(31 downto 0) := x"00000000"; --! Address of the first instruction to execute.
 		MTIME_DIVIDER          : positive := 5;                                --! Divider for the clock driving the MTIME counter
-		TIME_DIVIDER           : positive := 5                                 --! Divider for the clock dirivng the TIME counter
+		TIME_DIVIDER           : positive := 5;                                --! Divider for the clock dirivng the TIME counter
+		BRANCH_PREDICTION      : boolean  := false;                            --! Whether to enable dynamic branch prediction.
+		BTB_NUM_ENTRIES        : natural  := 32;                               --! Number of entries in the branch target buffer.
+		BHT_NUM_ENTRIES        : natural  := 128;                              --! Number of counters in the branch history table.
+		RAS_DEPTH              : natural  := 0;                                --! Number of entries in the return address stack, 0 disables it.
+		EARLY_JUMPS            : boolean  := true;                             --! Whether to resolve direct jumps in the decode stage.
+		STATIC_BRANCH_PREDICTION : boolean := false;                           --! Whether to predict backwards branches as taken in the decode stage.
+		LOAD_USE_BYPASS        : boolean  := false;                            --! Whether to forward load data to dependent instructions without stalling.
+		M_EXTENSION            : boolean  := false;                            --! Whether to implement the M extension for multiplication and division.
+		ZBB_EXTENSION          : boolean  := false;                            --! Whether to implement the Zbb and Zbkb bit-manipulation extensions.
+		ZKNH_EXTENSION         : boolean  := false;                            --! Whether to implement the SHA-256 instructions from the Zknh extension.
+		C_EXTENSION            : boolean  := false;                            --! Whether to implement the C extension for compressed instructions.
+		FETCH_QUEUE_DEPTH      : natural  := 0;                                --! Number of entries in the queue between the fetch and decode stages, 0 disables it.
+		MISALIGNED_ACCESS      : boolean  := false;                            --! Whether misaligned loads and stores are handled by the data memory interface instead of causing exceptions.
+		LOAD_QUEUE_DEPTH       : natural  := 0                                 --! Number of outstanding loads allowed while execution continues, 0 makes loads stall the pipeline.
 	);
 	port(
 		-- Control inputs:
@@ -39,10 +53,24 @@ entity pp_core is
 		dmem_read_ack  : in  std_logic;                      --! Data memory read acknowledge
 		dmem_write_req : out std_logic;                      --! Data memory write request
 		dmem_write_ack : in  std_logic;                      --! Data memory write acknowledge
+		dmem_drained   : in  std_logic;                      --! Set when all stores have been written to memory
+
+		-- Data cache control:
+		dcache_flush      : out std_logic;                   --! Requests writing all modified data cache lines to memory
+		dcache_invalidate : out std_logic;                   --! Requests invalidating all data cache lines
+
+		-- Instruction cache control:
+		icache_invalidate       : out std_logic;                     --! Requests invalidating all instruction cache lines
+		icache_invalidate_range : out std_logic;                     --! Requests invalidating the lines in a range of addresses
+		icache_invalidate_start : out std_logic_vector(31 downto 0); --! Start address of the range to invalidate
+		icache_invalidate_end   : out std_logic_vector(31 downto 0); --! End address of the range, not included
 
 		-- Test interface:
 		test_context_out : out test_context;                 --! Test context output.
 
+		-- Performance monitoring interface:
+		perf_events_out : out performance_events;            --! Performance event outputs.
+
 		-- External interrupt input:
 		irq : in std_logic_vector(7 downto 0) --! IRQ inputs.
 	);
@@ -80,12 +108,31 @@ architecture behaviour of pp_core is
 	-- Branch targets:
 	signal exception_target, branch_target : std_logic_vector(31 downto 0);
 	signal branch_taken, exception_taken   : std_logic;
+	signal branch_mispredicted             : std_logic;
+
+	-- Branches taken in the decode stage:
+	signal decode_branch        : std_logic;
+	signal decode_branch_target : std_logic_vector(31 downto 0);
+
+	-- Branch predictor update signals:
+	signal predictor_update        : std_logic;
+	signal predictor_update_branch : branch_type;
+	signal predictor_update_taken  : std_logic;
+	signal predictor_update_target : std_logic_vector(31 downto 0);
+	signal predictor_update_call   : std_logic;
+	signal predictor_update_return : std_logic;
+	signal predictor_update_compressed : std_logic;
 
 	-- Register file read ports:
 	signal rs1_address_p, rs2_address_p : register_address;
 	signal rs1_address, rs2_address     : register_address;
 	signal rs1_data, rs2_data           : std_logic_vector(31 downto 0);
 
+	-- Register file write port:
+	signal regfile_rd_address : register_address;
+	signal regfile_rd_data    : std_logic_vector(31 downto 0);
+	signal regfile_rd_write   : std_logic;
+
 	-- Data memory signals:
 	signal dmem_address_p   : std_logic_vector(31 downto 0);
 	signal dmem_data_size_p : std_logic_vector(1 downto 0);
@@ -93,9 +140,40 @@ architecture behaviour of pp_core is
 	signal dmem_read_req_p  : std_logic;
 	signal dmem_write_req_p : std_logic;
 
+	-- Data memory status seen by the pipeline:
+	signal mem_dmem_read_ack, mem_dmem_write_ack : std_logic;
+	signal ex_dmem_drained, ex_dmem_ready : std_logic;
+
+	-- Data cache flush requests from the CSR unit and from FENCE.I:
+	signal csr_dcache_flush, ex_dcache_flush : std_logic;
+	signal pending_loads : std_logic_vector(31 downto 0);
+
+	-- Load queue signals:
+	signal lq_full, lq_empty, lq_write_ack : std_logic;
+	signal lq_rd_port_free : std_logic;
+	signal lq_rd_address : register_address;
+	signal lq_rd_data    : std_logic_vector(31 downto 0);
+	signal lq_rd_write   : std_logic;
+
 	-- Fetch stage signals:
 	signal if_instruction, if_pc : std_logic_vector(31 downto 0);
 	signal if_instruction_ready  : std_logic;
+	signal if_compressed         : std_logic;
+	signal if_predicted_taken    : std_logic;
+	signal if_predicted_target   : std_logic_vector(31 downto 0);
+	signal if_stall              : std_logic;
+	signal if_ras_checkpoint     : ras_checkpoint;
+
+	-- Instructions passed to the decode stage from the fetch queue:
+	signal fq_instruction, fq_pc : std_logic_vector(31 downto 0);
+	signal fq_instruction_ready  : std_logic;
+	signal fq_compressed         : std_logic;
+	signal fq_predicted_taken    : std_logic;
+	signal fq_predicted_target   : std_logic_vector(31 downto 0);
+
+	-- Return address stack state to restore when instructions are flushed from the fetch queue:
+	signal fq_ras_restore       : std_logic;
+	signal fq_ras_restore_state : ras_checkpoint;
 
 	-- Decode stage signals:
 	signal id_funct3          : std_logic_vector(2 downto 0);
@@ -113,7 +191,11 @@ architecture behaviour of pp_core is
 	signal id_alu_op          : alu_operation;
 	signal id_mem_op          : memory_operation_type;
 	signal id_mem_size        : memory_operation_size;
+	signal id_fence           : std_logic;
 	signal id_pc              : std_logic_vector(31 downto 0);
+	signal id_compressed      : std_logic;
+	signal id_predicted_taken : std_logic;
+	signal id_predicted_target : std_logic_vector(31 downto 0);
 	signal id_exception       : std_logic;
 	signal id_exception_cause : csr_exception_cause;
 
@@ -136,6 +218,8 @@ architecture behaviour of pp_core is
 	signal ex_exception_context : csr_exception_context;
 
 	-- Memory stage signals:
+	signal mem_rd_write_in : std_logic;
+	signal mem_mem_op_in   : memory_operation_type;
 	signal mem_rd_write    : std_logic;
 	signal mem_rd_address  : register_address;
 	signal mem_rd_data     : std_logic_vector(31 downto 0);
@@ -163,19 +247,32 @@ begin
 	stall_if <= stall_id;
 	stall_id <= stall_ex;
 	stall_ex <= hazard_detected or stall_mem;
-	stall_mem <= to_std_logic(memop_is_load(mem_mem_op) and dmem_read_ack = '0')
-		or to_std_logic(mem_mem_op = MEMOP_TYPE_STORE and dmem_write_ack = '0');
+	stall_mem <= to_std_logic(memop_is_load(mem_mem_op) and mem_dmem_read_ack = '0')
+		or to_std_logic(mem_mem_op = MEMOP_TYPE_STORE and mem_dmem_write_ack = '0');
 
-	flush_if <= (branch_taken or exception_taken) and not stall_if;
-	flush_id <= (branch_taken or exception_taken) and not stall_id;
+	-- Branches taken in the decode stage only flush the instruction in the fetch stage:
+	flush_if <= (branch_taken or exception_taken or decode_branch) and not stall_if;
+	flush_id <= (branch_taken or exception_taken or decode_branch) and not stall_id;
 	flush_ex <= (branch_taken or exception_taken) and not stall_ex;
 
+	perf_events_out <= (
+			instruction_retired => wb_count_instruction,
+			branch_resolved => predictor_update and to_std_logic(predictor_update_branch /= BRANCH_NONE),
+			branch_taken => predictor_update and predictor_update_taken,
+			branch_predicted_taken => predictor_update and predictor_update_taken and not branch_mispredicted,
+			branch_mispredicted => branch_mispredicted and not exception_taken,
+			frontend_stall => not stall_id and not fq_instruction_ready,
+			backend_stall => stall_id
+		);
+
 	------- Control and status module -------
 	csr_unit: entity work.pp_csr_unit
 			generic map(
 				PROCESSOR_ID  => PROCESSOR_ID,
 				MTIME_DIVIDER => MTIME_DIVIDER,
-				TIME_DIVIDER  => TIME_DIVIDER
+				TIME_DIVIDER  => TIME_DIVIDER,
+				M_EXTENSION   => M_EXTENSION,
+				C_EXTENSION   => C_EXTENSION
 			) port map(
 				clk => clk,
 				reset => reset,
@@ -193,10 +290,15 @@ begin
 				mtvec_out => mtvec,
 				ie_out => ie,
 				ie1_out => ie1,
+				dcache_flush_out => csr_dcache_flush,
+				dcache_invalidate_out => dcache_invalidate,
+				icache_invalidate_start_out => icache_invalidate_start,
 				software_interrupt_out => software_interrupt,
 				timer_interrupt_out => timer_interrupt
 			);
 
+	dcache_flush <= csr_dcache_flush or ex_dcache_flush;
+
 	csr_read_address <= id_csr_address when stall_ex = '0' else csr_read_address_p;
 	store_previous_csr_addr: process(clk, stall_ex)
 	begin
@@ -213,9 +315,9 @@ begin
 				rs2_addr => rs2_address,
 				rs1_data => rs1_data,
 				rs2_data => rs2_data,
-				rd_addr => wb_rd_address,
-				rd_data => wb_rd_data,
-				rd_write => wb_rd_write
+				rd_addr => regfile_rd_address,
+				rd_data => regfile_rd_data,
+				rd_write => regfile_rd_write
 			);
 
 	rs1_address <= id_rs1_address when stall_ex = '0' else rs1_address_p;
@@ -232,7 +334,12 @@ begin
 	------- Instruction Fetch (IF) Stage -------
 	fetch: entity work.pp_fetch
 		generic map(
-			RESET_ADDRESS => RESET_ADDRESS
+			RESET_ADDRESS => RESET_ADDRESS,
+			BRANCH_PREDICTION => BRANCH_PREDICTION,
+			BTB_NUM_ENTRIES => BTB_NUM_ENTRIES,
+			BHT_NUM_ENTRIES => BHT_NUM_ENTRIES,
+			RAS_DEPTH => RAS_DEPTH,
+			C_EXTENSION => C_EXTENSION
 		) port map(
 			clk => clk,
 			reset => reset,
@@ -240,32 +347,100 @@ begin
 			imem_data_in => imem_data_in,
 			imem_req => imem_req,
 			imem_ack => imem_ack,
-			stall => stall_if,
+			stall => if_stall,
 			flush => flush_if,
 			branch => branch_taken,
 			exception => exception_taken,
 			branch_target => branch_target,
 			evec => exception_target,
+			decode_branch => decode_branch,
+			decode_branch_target => decode_branch_target,
+			ras_restore_checkpoint => fq_ras_restore,
+			ras_restore_state => fq_ras_restore_state,
+			predictor_update => predictor_update,
+			predictor_update_address => ex_pc,
+			predictor_update_branch => predictor_update_branch,
+			predictor_update_taken => predictor_update_taken,
+			predictor_update_target => predictor_update_target,
+			predictor_update_call => predictor_update_call,
+			predictor_update_return => predictor_update_return,
+			predictor_update_compressed => predictor_update_compressed,
 			instruction_data => if_instruction,
 			instruction_address => if_pc,
-			instruction_ready => if_instruction_ready
+			instruction_ready => if_instruction_ready,
+			instruction_compressed => if_compressed,
+			instruction_predicted_taken => if_predicted_taken,
+			instruction_predicted_target => if_predicted_target,
+			instruction_ras_checkpoint => if_ras_checkpoint
 		);
-	if_count_instruction <= if_instruction_ready;
+
+	fetch_queue_enabled: if FETCH_QUEUE_DEPTH > 0
+	generate
+		fetch_queue: entity work.pp_fetch_queue
+			generic map(
+				DEPTH => FETCH_QUEUE_DEPTH
+			) port map(
+				clk => clk,
+				reset => reset,
+				flush => flush_if,
+				fetch_data => if_instruction,
+				fetch_address => if_pc,
+				fetch_compressed => if_compressed,
+				fetch_predicted_taken => if_predicted_taken,
+				fetch_predicted_target => if_predicted_target,
+				fetch_ras_checkpoint => if_ras_checkpoint,
+				fetch_ready => if_instruction_ready,
+				full => if_stall,
+				ras_restore => fq_ras_restore,
+				ras_restore_state => fq_ras_restore_state,
+				decode_data => fq_instruction,
+				decode_address => fq_pc,
+				decode_compressed => fq_compressed,
+				decode_predicted_taken => fq_predicted_taken,
+				decode_predicted_target => fq_predicted_target,
+				decode_ready => fq_instruction_ready,
+				decode_stall => stall_id
+			);
+	end generate fetch_queue_enabled;
+
+	fetch_queue_disabled: if FETCH_QUEUE_DEPTH = 0
+	generate
+		if_stall <= stall_if;
+
+		fq_instruction <= if_instruction;
+		fq_pc <= if_pc;
+		fq_compressed <= if_compressed;
+		fq_predicted_taken <= if_predicted_taken;
+		fq_predicted_target <= if_predicted_target;
+		fq_instruction_ready <= if_instruction_ready;
+		fq_ras_restore <= '0';
+		fq_ras_restore_state <= if_ras_checkpoint;
+	end generate fetch_queue_disabled;
+
+	if_count_instruction <= fq_instruction_ready;
 
 	------- Instruction Decode (ID) Stage -------
 	decode: entity work.pp_decode
 		generic map(
 			RESET_ADDRESS => RESET_ADDRESS,
-			PROCESSOR_ID => PROCESSOR_ID
+			PROCESSOR_ID => PROCESSOR_ID,
+			EARLY_JUMPS => EARLY_JUMPS,
+			STATIC_BRANCH_PREDICTION => STATIC_BRANCH_PREDICTION and not BRANCH_PREDICTION,
+			M_EXTENSION => M_EXTENSION,
+			ZBB_EXTENSION => ZBB_EXTENSION,
+			ZKNH_EXTENSION => ZKNH_EXTENSION
 		) port map(
 			clk => clk,
 			reset => reset,
 			flush => flush_id,
 			stall => stall_id,
-			instruction_data => if_instruction,
-			instruction_address => if_pc,
-			instruction_ready => if_instruction_ready,
+			instruction_data => fq_instruction,
+			instruction_address => fq_pc,
+			instruction_ready => fq_instruction_ready,
 			instruction_count => if_count_instruction,
+			instruction_compressed => fq_compressed,
+			instruction_predicted_taken => fq_predicted_taken,
+			instruction_predicted_target => fq_predicted_target,
 			funct3 => id_funct3,
 			rs1_addr => id_rs1_address,
 			rs2_addr => id_rs2_address,
@@ -280,8 +455,14 @@ begin
 			alu_op => id_alu_op,
 			mem_op => id_mem_op,
 			mem_size => id_mem_size,
+			fence => id_fence,
 			count_instruction => id_count_instruction,
 			pc => id_pc,
+			compressed => id_compressed,
+			predicted_taken => id_predicted_taken,
+			predicted_target => id_predicted_target,
+			early_branch => decode_branch,
+			early_branch_target => decode_branch_target,
 			csr_write => id_csr_write,
 			csr_use_imm => id_csr_use_immediate,
 			decode_exception => id_exception,
@@ -290,7 +471,14 @@ begin
 
 	------- Execute (EX) Stage -------
 	execute: entity work.pp_execute
-		port map(
+		generic map(
+			LOAD_USE_BYPASS => LOAD_USE_BYPASS,
+			M_EXTENSION => M_EXTENSION,
+			ZBB_EXTENSION => ZBB_EXTENSION,
+			ZKNH_EXTENSION => ZKNH_EXTENSION,
+			C_EXTENSION => C_EXTENSION,
+			MISALIGNED_ACCESS => MISALIGNED_ACCESS
+		) port map(
 			clk => clk,
 			reset => reset,
 			stall => stall_ex,
@@ -303,6 +491,12 @@ begin
 			dmem_data_out => ex_dmem_data_out,
 			dmem_read_req => ex_dmem_read_req,
 			dmem_write_req => ex_dmem_write_req,
+			dmem_drained => ex_dmem_drained,
+			dmem_ready => ex_dmem_ready,
+			dcache_flush_out => ex_dcache_flush,
+			icache_invalidate_out => icache_invalidate,
+			icache_invalidate_range_out => icache_invalidate_range,
+			icache_invalidate_end_out => icache_invalidate_end,
 			rs1_addr_in => rs1_address,
 			rs2_addr_in => rs2_address,
 			rd_addr_in => id_rd_address,
@@ -314,6 +508,9 @@ begin
 			funct3_in => id_funct3,
 			pc_in => id_pc,
 			pc_out => ex_pc,
+			compressed_in => id_compressed,
+			predicted_taken_in => id_predicted_taken,
+			predicted_target_in => id_predicted_target,
 			csr_addr_in => csr_read_address,
 			csr_addr_out => ex_csr_address,
 			csr_write_in => id_csr_write,
@@ -333,6 +530,7 @@ begin
 			mem_op_out => ex_mem_op,
 			mem_size_in => id_mem_size,
 			mem_size_out => ex_mem_size,
+			fence_in => id_fence,
 			count_instruction_in => id_count_instruction,
 			count_instruction_out => ex_count_instruction,
 			ie_in => ie,
@@ -346,38 +544,116 @@ begin
 			exception_context_out => ex_exception_context,
 			jump_out => branch_taken,
 			jump_target_out => branch_target,
+			mispredicted_out => branch_mispredicted,
+			predictor_update_out => predictor_update,
+			predictor_update_branch_out => predictor_update_branch,
+			predictor_update_taken_out => predictor_update_taken,
+			predictor_update_target_out => predictor_update_target,
+			predictor_update_call_out => predictor_update_call,
+			predictor_update_return_out => predictor_update_return,
+			predictor_update_compressed_out => predictor_update_compressed,
 			mem_rd_write => mem_rd_write,
 			mem_rd_addr => mem_rd_address,
 			mem_rd_value => mem_rd_data,
 			mem_csr_addr => mem_csr_address,
 			mem_csr_write => mem_csr_write,
+			mem_csr_value => mem_csr_data,
 			mem_exception => mem_exception,
 			wb_rd_write => wb_rd_write,
 			wb_rd_addr => wb_rd_address,
 			wb_rd_value => wb_rd_data,
 			wb_csr_addr => wb_csr_address,
 			wb_csr_write => wb_csr_write,
+			wb_csr_value => wb_csr_data,
 			wb_exception => wb_exception,
 			mem_mem_op => mem_mem_op,
+			dmem_read_ack => mem_dmem_read_ack,
+			pending_loads => pending_loads,
 			hazard_detected => hazard_detected
 		);
 
-	dmem_address <= ex_dmem_address when stall_mem = '0' else dmem_address_p;
-	dmem_data_size <= ex_dmem_data_size when stall_mem = '0' else dmem_data_size_p;
-	dmem_data_out <= ex_dmem_data_out when stall_mem = '0' else dmem_data_out_p;
-	dmem_read_req <= ex_dmem_read_req when stall_mem = '0' else dmem_read_req_p;
-	dmem_write_req <= ex_dmem_write_req when stall_mem = '0' else dmem_write_req_p;
+	load_queue_enabled: if LOAD_QUEUE_DEPTH > 0
+	generate
+		load_queue: entity work.pp_load_queue
+			generic map(
+				DEPTH => LOAD_QUEUE_DEPTH
+			) port map(
+				clk => clk,
+				reset => reset,
+				req_address => ex_dmem_address,
+				req_data => ex_dmem_data_out,
+				req_data_size => ex_dmem_data_size,
+				req_read => ex_dmem_read_req,
+				req_write => ex_dmem_write_req,
+				req_rd_addr => ex_rd_address,
+				req_mem_op => ex_mem_op,
+				req_mem_size => ex_mem_size,
+				write_ack => lq_write_ack,
+				full => lq_full,
+				empty => lq_empty,
+				pending => pending_loads,
+				rd_port_free => lq_rd_port_free,
+				rd_addr => lq_rd_address,
+				rd_data => lq_rd_data,
+				rd_write => lq_rd_write,
+				dmem_address => dmem_address,
+				dmem_data_in => dmem_data_in,
+				dmem_data_out => dmem_data_out,
+				dmem_data_size => dmem_data_size,
+				dmem_read_req => dmem_read_req,
+				dmem_read_ack => dmem_read_ack,
+				dmem_write_req => dmem_write_req,
+				dmem_write_ack => dmem_write_ack
+			);
 
-	store_previous_dmem_address: process(clk, stall_mem)
-	begin
-		if rising_edge(clk) and stall_mem = '0' then
-			dmem_address_p <= ex_dmem_address;
-			dmem_data_size_p <= ex_dmem_data_size;
-			dmem_data_out_p <= ex_dmem_data_out;
-			dmem_read_req_p <= ex_dmem_read_req;
-			dmem_write_req_p <= ex_dmem_write_req;
-		end if;
-	end process store_previous_dmem_address;
+		-- Loads leave the pipeline when they are placed in the queue, and their results are
+		-- written to the register file when the writeback stage does not use the write port:
+		mem_rd_write_in <= ex_rd_write when not memop_is_load(ex_mem_op) else '0';
+		mem_mem_op_in <= ex_mem_op when not memop_is_load(ex_mem_op) else MEMOP_TYPE_NONE;
+		mem_dmem_read_ack <= '0';
+		mem_dmem_write_ack <= lq_write_ack;
+
+		ex_dmem_drained <= dmem_drained and lq_empty;
+		ex_dmem_ready <= not lq_full;
+
+		lq_rd_port_free <= not wb_rd_write or to_std_logic(wb_rd_address = b"00000");
+		regfile_rd_address <= lq_rd_address when lq_rd_write = '1' else wb_rd_address;
+		regfile_rd_data <= lq_rd_data when lq_rd_write = '1' else wb_rd_data;
+		regfile_rd_write <= wb_rd_write or lq_rd_write;
+	end generate load_queue_enabled;
+
+	load_queue_disabled: if LOAD_QUEUE_DEPTH = 0
+	generate
+		mem_rd_write_in <= ex_rd_write;
+		mem_mem_op_in <= ex_mem_op;
+		mem_dmem_read_ack <= dmem_read_ack;
+		mem_dmem_write_ack <= dmem_write_ack;
+
+		ex_dmem_drained <= dmem_drained;
+		ex_dmem_ready <= '1';
+		pending_loads <= (others => '0');
+
+		regfile_rd_address <= wb_rd_address;
+		regfile_rd_data <= wb_rd_data;
+		regfile_rd_write <= wb_rd_write;
+
+		dmem_address <= ex_dmem_address when stall_mem = '0' else dmem_address_p;
+		dmem_data_size <= ex_dmem_data_size when stall_mem = '0' else dmem_data_size_p;
+		dmem_data_out <= ex_dmem_data_out when stall_mem = '0' else dmem_data_out_p;
+		dmem_read_req <= ex_dmem_read_req when stall_mem = '0' else dmem_read_req_p;
+		dmem_write_req <= ex_dmem_write_req when stall_mem = '0' else dmem_write_req_p;
+
+		store_previous_dmem_address: process(clk, stall_mem)
+		begin
+			if rising_edge(clk) and stall_mem = '0' then
+				dmem_address_p <= ex_dmem_address;
+				dmem_data_size_p <= ex_dmem_data_size;
+				dmem_data_out_p <= ex_dmem_data_out;
+				dmem_read_req_p <= ex_dmem_read_req;
+				dmem_write_req_p <= ex_dmem_write_req;
+			end if;
+		end process store_previous_dmem_address;
+	end generate load_queue_disabled;
 
 	------- Memory (MEM) Stage -------
 	memory: entity work.pp_memory
@@ -386,17 +662,17 @@ begin
 			reset => reset,
 			stall => stall_mem,
 			dmem_data_in => dmem_data_in,
-			dmem_read_ack => dmem_read_ack,
-			dmem_write_ack => dmem_write_ack,
+			dmem_read_ack => mem_dmem_read_ack,
+			dmem_write_ack => mem_dmem_write_ack,
 			pc => ex_pc,
-			rd_write_in => ex_rd_write,
+			rd_write_in => mem_rd_write_in,
 			rd_write_out => mem_rd_write,
 			rd_data_in => ex_rd_data,
 			rd_data_out => mem_rd_data,
 			rd_addr_in => ex_rd_address,
 			rd_addr_out => mem_rd_address,
 			branch => ex_branch,
-			mem_op_in => ex_mem_op,
+			mem_op_in => mem_mem_op_in,
 			mem_op_out => mem_mem_op,
 			mem_size_in => ex_mem_size,
 			count_instr_in => ex_count_instruction,
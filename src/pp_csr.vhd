@@ -66,7 +66,10 @@ package pp_csr is
 	constant CSR_MBADADDR : csr_address := x"343";
 	constant CSR_MIP      : csr_address := x"344";
 
-	constant CSR_TEST : csr_address := x"bf0";
+	constant CSR_TEST   : csr_address := x"bf0";
+	constant CSR_DCACHE : csr_address := x"bf1";
+	constant CSR_ICACHE_INVALIDATE_START : csr_address := x"bf2";
+	constant CSR_ICACHE_INVALIDATE_END   : csr_address := x"bf3";
 
 	-- Values used as control register IDs in ERET:
 	constant CSR_EPC_MRET   : csr_address := x"302";
@@ -81,6 +84,10 @@ package pp_csr is
 	constant CSR_MIP_MSIP : natural := CSR_MIE_MSIE;
 	constant CSR_MIP_MTIP : natural := CSR_MIE_MTIE;
 
+	-- Data cache control register bit indices:
+	constant CSR_DCACHE_FLUSH      : natural := 0;
+	constant CSR_DCACHE_INVALIDATE : natural := 1;
+
 	-- Exception context; this record contains all state that can be manipulated
 	-- when an exception is taken.
 	type csr_exception_context is
@@ -93,6 +100,9 @@ package pp_csr is
 	--! Creates the value of the mstatus registe from the EI and EI1 bits.
 	function csr_make_mstatus(mie, mpie : in std_logic) return std_logic_vector;
 
+	--! Checks if writing to a CSR affects interrupt and exception handling or memory accesses in the execute stage.
+	function csr_has_side_effects(address : in csr_address) return boolean;
+
 end package pp_csr;
 
 package body pp_csr is
@@ -113,4 +123,10 @@ package body pp_csr is
 		return retval;
 	end function csr_make_mstatus;
 
+	function csr_has_side_effects(address : in csr_address) return boolean is
+	begin
+		return address = CSR_MSTATUS or address = CSR_MIE or address = CSR_MTVEC or address = CSR_MIP
+			or address = CSR_DCACHE or address = CSR_ICACHE_INVALIDATE_START;
+	end function csr_has_side_effects;
+
 end package body pp_csr;
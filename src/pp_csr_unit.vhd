@@ -15,7 +15,9 @@ entity pp_csr_unit is
 	generic(
 		PROCESSOR_ID  : std_logic_vector(31 downto 0);
 		MTIME_DIVIDER : positive := 5; --! Divider for the clock driving the MTIME counter.
-		TIME_DIVIDER  : positive := 5  --! Divider for the clock driving the TIME counter.
+		TIME_DIVIDER  : positive := 5; --! Divider for the clock driving the TIME counter.
+		M_EXTENSION   : boolean := false; --! Whether the M extension is implemented.
+		C_EXTENSION   : boolean := false  --! Whether the C extension is implemented.
 	);
 	port(
 		clk       : in std_logic;
@@ -47,6 +49,14 @@ entity pp_csr_unit is
 		software_interrupt_out : out std_logic;
 		timer_interrupt_out    : out std_logic;
 
+		-- Data cache control, asserted for one cycle when requested by software:
+		dcache_flush_out      : out std_logic;
+		dcache_invalidate_out : out std_logic;
+
+		-- Start address of the instruction cache invalidation range, the invalidation itself is
+		-- performed by the execute stage when the end address is written:
+		icache_invalidate_start_out : out std_logic_vector(31 downto 0);
+
 		-- Registers needed for exception handling, always read:
 		mie_out         : out std_logic_vector(31 downto 0);
 		mtvec_out       : out std_logic_vector(31 downto 0);
@@ -84,6 +94,10 @@ architecture behaviour of pp_csr_unit is
 	-- Test and debug register:
 	signal test_register : test_context;
 
+	-- Instruction cache invalidation range:
+	signal icache_invalidate_start : std_logic_vector(31 downto 0);
+	signal icache_invalidate_end   : std_logic_vector(31 downto 0);
+
 	-- Interrupt signals:
 	signal timer_interrupt    : std_logic;
 	signal software_interrupt : std_logic;
@@ -100,6 +114,8 @@ begin
 	--! Output the current test state:
 	test_context_out <= test_register;
 
+	icache_invalidate_start_out <= icache_invalidate_start;
+
 	time_clk_gen: process(clk)
 	begin
 		if rising_edge(clk) then
@@ -160,7 +176,14 @@ begin
 				ie <= '0';
 				ie1 <= '0';
 				test_register <= (TEST_IDLE, (others => '0'));
+				dcache_flush_out <= '0';
+				dcache_invalidate_out <= '0';
+				icache_invalidate_start <= (others => '0');
+				icache_invalidate_end <= (others => '0');
 			else
+				dcache_flush_out <= '0';
+				dcache_invalidate_out <= '0';
+
 				if exception_context_write = '1' then
 					ie <= exception_context.ie;
 					ie1 <= exception_context.ie1;
@@ -189,6 +212,13 @@ begin
 							software_interrupt <= write_data_in(CSR_MIP_MSIP);
 						when CSR_TEST => -- Test and debug register:
 							test_register <= std_logic_to_test_context(write_data_in);
+						when CSR_DCACHE => -- Data cache control register:
+							dcache_flush_out <= write_data_in(CSR_DCACHE_FLUSH);
+							dcache_invalidate_out <= write_data_in(CSR_DCACHE_INVALIDATE);
+						when CSR_ICACHE_INVALIDATE_START => -- Start of instruction cache invalidation range:
+							icache_invalidate_start <= write_data_in;
+						when CSR_ICACHE_INVALIDATE_END => -- End of instruction cache invalidation range:
+							icache_invalidate_end <= write_data_in;
 						when others =>
 							-- Ignore writes to invalid or read-only registers
 					end case;
@@ -238,6 +268,8 @@ begin
 						read_data_out <= (
 								30 => '1', -- Set the MXL0 bit, indicating XLEN = 32
 								 8 => '1', -- Set the bit corresponding to I (RV32I)
+								 2 => to_std_logic(C_EXTENSION), -- Set the bit corresponding to C if it is implemented
+								12 => to_std_logic(M_EXTENSION), -- Set the bit corresponding to M if it is implemented
 								others => '0');
 					when CSR_MVENDORID => -- Vendor ID
 						read_data_out <= (others => '0'); -- Use 0 to indicate a non-commercial implementation
@@ -270,6 +302,10 @@ begin
 					-- Potato extensions:
 					when CSR_TEST =>
 						read_data_out <= test_context_to_std_logic(test_register);
+					when CSR_ICACHE_INVALIDATE_START =>
+						read_data_out <= icache_invalidate_start;
+					when CSR_ICACHE_INVALIDATE_END =>
+						read_data_out <= icache_invalidate_end;
 
 					-- Return zero from write-only registers and invalid register addresses:
 					when others =>
@@ -0,0 +1,457 @@
+-- The Potato Processor - A simple processor for FPGAs
+-- (c) Kristian Klomsten Skordal 2014 - 2015 <kristian.skordal@wafflemail.net>
+-- Report bugs and issues on <https://github.com/skordal/potato/issues>
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.pp_types.all;
+use work.pp_constants.all;
+use work.pp_utilities.all;
+
+--! @brief Simple write-back, write-allocate direct-mapped data cache.
+--! @details
+--!	Stores only update the cache; modified lines are written to memory when
+--!	they are replaced or when software requests a flush. Accesses to addresses
+--!	where (address and UNCACHED_MASK) = UNCACHED_BASE, such as peripherals,
+--!	bypass the cache and are performed as single Wishbone transactions.
+--!	Accesses crossing a word boundary are performed as two accesses, one for
+--!	each word. A flush writes all modified lines to memory, and an invalidation
+--!	discards all lines; if both are requested, lines are written back before
+--!	they are discarded. If bursts are enabled, lines are loaded from memory
+--!	using Wishbone incrementing bursts.
+entity pp_dcache is
+	generic(
+		LINE_SIZE     : natural := 4;   --! Number of words per cache line
+		NUM_LINES     : natural := 128; --! Number of lines in the cache
+		UNCACHED_MASK : std_logic_vector(31 downto 0) := x"ffff0000"; --! Address bits compared to UNCACHED_BASE
+		UNCACHED_BASE : std_logic_vector(31 downto 0) := x"c0000000"; --! Base address of the uncached address space
+		BURSTS        : boolean := false --! Whether to load cache lines using incrementing bursts
+	);
+	port(
+		clk   : in std_logic;
+		reset : in std_logic;
+
+		-- Processor data memory signals:
+		mem_address   : in  std_logic_vector(31 downto 0);
+		mem_data_in   : in  std_logic_vector(31 downto 0); -- Data in from the processor
+		mem_data_out  : out std_logic_vector(31 downto 0); -- Data out to the processor
+		mem_data_size : in  std_logic_vector( 1 downto 0);
+		mem_read_req  : in  std_logic;
+		mem_read_ack  : out std_logic;
+		mem_write_req : in  std_logic;
+		mem_write_ack : out std_logic;
+
+		-- Cache control, pulsed for one cycle to request an operation:
+		flush      : in std_logic; --! Writes all modified cache lines to memory.
+		invalidate : in std_logic; --! Discards all cache lines.
+		busy       : out std_logic; --! Set while a requested operation has not been completed.
+
+		-- Wishbone interface:
+		wb_inputs  : in wishbone_master_inputs;
+		wb_outputs : out wishbone_master_outputs
+	);
+end entity pp_dcache;
+
+architecture behaviour of pp_dcache is
+
+	-- Address components:
+	constant WORD_BITS : natural := log2(LINE_SIZE);
+	constant LINE_BITS : natural := log2(NUM_LINES);
+	constant TAG_LOW   : natural := log2(LINE_SIZE * 4) + LINE_BITS;
+
+	-- Counter types:
+	subtype line_counter_type is natural range 0 to NUM_LINES - 1;
+	subtype word_counter_type is natural range 0 to LINE_SIZE - 1;
+
+	-- Cache memory types, the data memory is word-addressed to allow writing single bytes:
+	type cache_word_array is array(0 to (NUM_LINES * LINE_SIZE) - 1) of std_logic_vector(31 downto 0);
+	subtype cache_tag_type is std_logic_vector(31 downto TAG_LOW);
+	type cache_tag_array is array(0 to NUM_LINES - 1) of cache_tag_type;
+
+	-- Cache memories:
+	signal cache_memory : cache_word_array;
+	signal tag_memory   : cache_tag_array;
+	signal valid        : std_logic_vector(NUM_LINES - 1 downto 0) := (others => '0');
+	signal dirty        : std_logic_vector(NUM_LINES - 1 downto 0) := (others => '0');
+
+	attribute ram_style : string;
+	attribute ram_style of cache_memory: signal is "block";
+
+	-- Cache controller signals:
+	type state_type is (IDLE, LOOKUP_READ, LOOKUP,
+		WRITEBACK_READ, WRITEBACK_START, WRITEBACK_WAIT_ACK,
+		REFILL_START, REFILL_WAIT_ACK,
+		UNCACHED_WAIT_ACK, UNCACHED_NEXT_WORD,
+		MAINTENANCE_READ, MAINTENANCE_CHECK, MAINTENANCE_NEXT);
+	signal state : state_type := IDLE;
+
+	signal mem_r_ack, mem_w_ack : std_logic;
+
+	-- Word currently being accessed:
+	signal access_address  : std_logic_vector(31 downto 2);
+	signal access_sel      : std_logic_vector( 3 downto 0);
+	signal access_data     : std_logic_vector(31 downto 0); -- Store data, placed on the correct byte lanes
+	signal access_write    : std_logic;
+	signal access_line     : line_counter_type;
+	signal access_tag      : cache_tag_type;
+
+	-- Size and offset of the access requested by the processor:
+	signal request_size   : std_logic_vector(1 downto 0);
+	signal request_offset : std_logic_vector(1 downto 0);
+
+	-- Signals used when splitting accesses crossing word boundaries:
+	signal split_pending : std_logic; -- Set while the first of two words is accessed
+	signal split_active  : std_logic; -- Set while the second of two words is accessed
+	signal split_sel     : std_logic_vector( 3 downto 0);
+	signal split_data    : std_logic_vector(31 downto 0);
+	signal first_word    : std_logic_vector(31 downto 0);
+
+	-- Line being written back to memory:
+	signal victim_line : line_counter_type;
+	signal victim_tag  : cache_tag_type;
+
+	-- Current word being written back or loaded:
+	signal cl_current_word : word_counter_type;
+
+	-- Cache maintenance signals:
+	signal flush_pending, invalidate_pending : std_logic; -- Set when an operation has been requested
+	signal maintenance_flush, maintenance_invalidate : std_logic; -- Operations performed by the current pass
+	signal maintenance_active : std_logic;
+
+	-- Cache memory ports:
+	signal read_address : std_logic_vector(TAG_LOW - 1 downto 2);
+	signal read_data    : std_logic_vector(31 downto 0);
+	signal read_tag     : cache_tag_type;
+
+	signal cache_write       : std_logic;
+	signal cache_write_index : natural range 0 to (NUM_LINES * LINE_SIZE) - 1;
+	signal cache_write_sel   : std_logic_vector( 3 downto 0);
+	signal cache_write_data  : std_logic_vector(31 downto 0);
+	signal tag_write         : std_logic;
+
+	-- Set when the current word is present in the cache:
+	signal cache_hit : std_logic;
+
+	-- Set when a word, and when the last word of a line, is acknowledged during a refill:
+	signal refill_ack, refill_done : std_logic;
+
+begin
+
+	assert is_pow2(LINE_SIZE) report "Cache line size must be a power of 2!" severity FAILURE;
+	assert is_pow2(NUM_LINES) report "Number of cache lines must be a power of 2!" severity FAILURE;
+
+	mem_read_ack <= mem_r_ack;
+	mem_write_ack <= mem_w_ack;
+
+	busy <= flush or invalidate or flush_pending or invalidate_pending or maintenance_active;
+
+	access_line <= to_integer(unsigned(access_address(TAG_LOW - 1 downto log2(LINE_SIZE * 4))));
+	access_tag <= access_address(31 downto TAG_LOW);
+
+	cache_hit <= valid(access_line) and to_std_logic(read_tag = access_tag);
+
+	refill_ack <= wb_inputs.ack when state = REFILL_WAIT_ACK else '0';
+	refill_done <= refill_ack and to_std_logic(cl_current_word = LINE_SIZE - 1);
+
+	-- Words are written to the cache when loading lines from memory and when stores hit:
+	cache_write <= refill_ack or (cache_hit and access_write and to_std_logic(state = LOOKUP));
+	cache_write_index <= access_line * LINE_SIZE + cl_current_word when state = REFILL_WAIT_ACK
+		else to_integer(unsigned(access_address(TAG_LOW - 1 downto 2)));
+	cache_write_sel <= b"1111" when state = REFILL_WAIT_ACK else access_sel;
+	cache_write_data <= wb_inputs.dat when state = REFILL_WAIT_ACK else access_data;
+	tag_write <= refill_done;
+
+	select_read_address: process(state, mem_address, access_address, victim_line, cl_current_word)
+	begin
+		case state is
+			when IDLE =>
+				read_address <= mem_address(TAG_LOW - 1 downto 2);
+			when WRITEBACK_READ | MAINTENANCE_READ =>
+				read_address <= std_logic_vector(to_unsigned(victim_line, LINE_BITS))
+					& std_logic_vector(to_unsigned(cl_current_word, WORD_BITS));
+			when others =>
+				read_address <= access_address(TAG_LOW - 1 downto 2);
+		end case;
+	end process select_read_address;
+
+	cache_memory_port: process(clk)
+	begin
+		if rising_edge(clk) then
+			if cache_write = '1' then
+				for i in 0 to 3 loop
+					if cache_write_sel(i) = '1' then
+						cache_memory(cache_write_index)(i * 8 + 7 downto i * 8) <= cache_write_data(i * 8 + 7 downto i * 8);
+					end if;
+				end loop;
+			end if;
+
+			read_data <= cache_memory(to_integer(unsigned(read_address)));
+		end if;
+	end process cache_memory_port;
+
+	tag_memory_port: process(clk)
+	begin
+		if rising_edge(clk) then
+			if tag_write = '1' then
+				tag_memory(access_line) <= access_tag;
+			end if;
+
+			read_tag <= tag_memory(to_integer(unsigned(read_address(TAG_LOW - 1 downto log2(LINE_SIZE * 4)))));
+		end if;
+	end process tag_memory_port;
+
+	controller: process(clk)
+		variable split : boolean;
+		variable sel : std_logic_vector(7 downto 0);
+		variable data : std_logic_vector(31 downto 0);
+		variable combined_data : std_logic_vector(63 downto 0);
+
+		--! Returns loaded data to the processor and acknowledges the access.
+		procedure complete_access(word : in std_logic_vector(31 downto 0)) is
+		begin
+			if split_active = '1' then
+				combined_data := word & first_word;
+				combined_data := std_logic_vector(shift_right(unsigned(combined_data),
+					8 * to_integer(unsigned(request_offset))));
+				mem_data_out <= combined_data(31 downto 0);
+			else
+				mem_data_out <= std_logic_vector(shift_right(unsigned(word),
+					wb_get_data_shift(request_size, request_offset)));
+			end if;
+
+			mem_r_ack <= not access_write;
+			mem_w_ack <= access_write;
+			split_active <= '0';
+			state <= IDLE;
+		end procedure complete_access;
+
+		--! Moves on to the second word of an access crossing a word boundary.
+		procedure start_next_word(word : in std_logic_vector(31 downto 0)) is
+		begin
+			first_word <= word;
+			access_address <= std_logic_vector(unsigned(access_address) + 1);
+			access_sel <= split_sel;
+			access_data <= split_data;
+			split_pending <= '0';
+			split_active <= '1';
+		end procedure start_next_word;
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				state <= IDLE;
+				wb_outputs.cyc <= '0';
+				wb_outputs.stb <= '0';
+				wb_outputs.cti <= WB_CTI_CLASSIC;
+				wb_outputs.bte <= WB_BTE_LINEAR;
+				mem_r_ack <= '0';
+				mem_w_ack <= '0';
+				valid <= (others => '0');
+				dirty <= (others => '0');
+				split_pending <= '0';
+				split_active <= '0';
+				flush_pending <= '0';
+				invalidate_pending <= '0';
+				maintenance_active <= '0';
+			else
+				mem_r_ack <= '0';
+				mem_w_ack <= '0';
+
+				if flush = '1' then
+					flush_pending <= '1';
+				end if;
+
+				if invalidate = '1' then
+					invalidate_pending <= '1';
+				end if;
+
+				case state is
+					when IDLE =>
+						-- Maintenance operations are started before any accesses requested at the same time,
+						-- requests arriving during the pass are handled by another pass:
+						if flush_pending = '1' or invalidate_pending = '1' or flush = '1' or invalidate = '1' then
+							flush_pending <= '0';
+							invalidate_pending <= '0';
+							maintenance_flush <= flush_pending or flush;
+							maintenance_invalidate <= invalidate_pending or invalidate;
+							maintenance_active <= '1';
+							victim_line <= 0;
+							cl_current_word <= 0;
+							state <= MAINTENANCE_READ;
+						elsif mem_write_req = '1' or mem_read_req = '1' then
+							split := wb_access_crosses_word(mem_data_size, mem_address);
+							sel := wb_get_split_sel(mem_data_size, mem_address);
+
+							access_address <= mem_address(31 downto 2);
+							access_write <= mem_write_req;
+							request_size <= mem_data_size;
+							request_offset <= mem_address(1 downto 0);
+
+							split_sel <= sel(7 downto 4);
+							split_data <= std_logic_vector(shift_right(unsigned(mem_data_in),
+								32 - 8 * to_integer(unsigned(mem_address(1 downto 0)))));
+							split_pending <= to_std_logic(split);
+							split_active <= '0';
+
+							if split then
+								data := std_logic_vector(shift_left(unsigned(mem_data_in),
+									8 * to_integer(unsigned(mem_address(1 downto 0)))));
+							else
+								sel(3 downto 0) := wb_get_data_sel(mem_data_size, mem_address);
+								data := std_logic_vector(shift_left(unsigned(mem_data_in),
+									wb_get_data_shift(mem_data_size, mem_address)));
+							end if;
+							access_sel <= sel(3 downto 0);
+							access_data <= data;
+
+							if (mem_address and UNCACHED_MASK) = UNCACHED_BASE then
+								wb_outputs.adr <= mem_address(31 downto 2) & b"00";
+								wb_outputs.sel <= sel(3 downto 0);
+								wb_outputs.dat <= data;
+								wb_outputs.we <= mem_write_req;
+								wb_outputs.cyc <= '1';
+								wb_outputs.stb <= '1';
+								state <= UNCACHED_WAIT_ACK;
+							else
+								state <= LOOKUP;
+							end if;
+						end if;
+					when LOOKUP_READ =>
+						state <= LOOKUP;
+					when LOOKUP =>
+						if cache_hit = '1' then
+							if access_write = '1' then
+								dirty(access_line) <= '1';
+							end if;
+
+							if split_pending = '1' then
+								start_next_word(read_data);
+								state <= LOOKUP_READ;
+							else
+								complete_access(read_data);
+							end if;
+						else
+							cl_current_word <= 0;
+							if valid(access_line) = '1' and dirty(access_line) = '1' then
+								victim_line <= access_line;
+								victim_tag <= read_tag;
+								state <= WRITEBACK_READ;
+							else
+								state <= REFILL_START;
+							end if;
+						end if;
+					when WRITEBACK_READ =>
+						state <= WRITEBACK_START;
+					when WRITEBACK_START =>
+						wb_outputs.adr <= victim_tag & std_logic_vector(to_unsigned(victim_line, LINE_BITS))
+							& std_logic_vector(to_unsigned(cl_current_word, WORD_BITS)) & b"00";
+						wb_outputs.dat <= read_data;
+						wb_outputs.sel <= (others => '1');
+						wb_outputs.we <= '1';
+						wb_outputs.cyc <= '1';
+						wb_outputs.stb <= '1';
+						state <= WRITEBACK_WAIT_ACK;
+					when WRITEBACK_WAIT_ACK =>
+						if wb_inputs.ack = '1' then
+							wb_outputs.stb <= '0';
+							if natural(cl_current_word) = LINE_SIZE - 1 then
+								wb_outputs.cyc <= '0';
+								dirty(victim_line) <= '0';
+								cl_current_word <= 0;
+								if maintenance_active = '1' then
+									state <= MAINTENANCE_NEXT;
+								else
+									state <= REFILL_START;
+								end if;
+							else
+								cl_current_word <= cl_current_word + 1;
+								state <= WRITEBACK_READ;
+							end if;
+						end if;
+					when REFILL_START =>
+						wb_outputs.adr <= access_address(31 downto log2(LINE_SIZE * 4))
+							& std_logic_vector(to_unsigned(cl_current_word, WORD_BITS)) & b"00";
+						wb_outputs.sel <= (others => '1');
+						wb_outputs.we <= '0';
+						wb_outputs.cyc <= '1';
+						wb_outputs.stb <= '1';
+						if BURSTS then
+							if LINE_SIZE = 1 then
+								wb_outputs.cti <= WB_CTI_END;
+							else
+								wb_outputs.cti <= WB_CTI_INCREMENT;
+							end if;
+						end if;
+						state <= REFILL_WAIT_ACK;
+					when REFILL_WAIT_ACK =>
+						if wb_inputs.ack = '1' then
+							wb_outputs.stb <= '0';
+							if natural(cl_current_word) = LINE_SIZE - 1 then
+								wb_outputs.cyc <= '0';
+								wb_outputs.cti <= WB_CTI_CLASSIC;
+								valid(access_line) <= '1';
+								dirty(access_line) <= '0';
+								state <= LOOKUP_READ;
+							else
+								cl_current_word <= cl_current_word + 1;
+
+								-- During a burst, the next address is presented together with the acknowledged data:
+								if BURSTS then
+									wb_outputs.stb <= '1';
+									wb_outputs.adr <= access_address(31 downto log2(LINE_SIZE * 4))
+										& std_logic_vector(to_unsigned(cl_current_word + 1, WORD_BITS)) & b"00";
+									if natural(cl_current_word) + 1 = LINE_SIZE - 1 then
+										wb_outputs.cti <= WB_CTI_END;
+									end if;
+								else
+									state <= REFILL_START;
+								end if;
+							end if;
+						end if;
+					when UNCACHED_WAIT_ACK =>
+						if wb_inputs.ack = '1' then
+							wb_outputs.stb <= '0';
+							if split_pending = '1' then
+								start_next_word(wb_inputs.dat);
+								wb_outputs.adr <= std_logic_vector(unsigned(access_address) + 1) & b"00";
+								wb_outputs.sel <= split_sel;
+								wb_outputs.dat <= split_data;
+								state <= UNCACHED_NEXT_WORD;
+							else
+								wb_outputs.cyc <= '0';
+								complete_access(wb_inputs.dat);
+							end if;
+						end if;
+					when UNCACHED_NEXT_WORD =>
+						-- The bus cycle is kept while the second word is requested:
+						wb_outputs.stb <= '1';
+						state <= UNCACHED_WAIT_ACK;
+					when MAINTENANCE_READ =>
+						state <= MAINTENANCE_CHECK;
+					when MAINTENANCE_CHECK =>
+						if maintenance_flush = '1' and valid(victim_line) = '1' and dirty(victim_line) = '1' then
+							victim_tag <= read_tag;
+							state <= WRITEBACK_READ;
+						else
+							state <= MAINTENANCE_NEXT;
+						end if;
+					when MAINTENANCE_NEXT =>
+						if maintenance_invalidate = '1' then
+							valid(victim_line) <= '0';
+							dirty(victim_line) <= '0';
+						end if;
+
+						if victim_line = NUM_LINES - 1 then
+							maintenance_active <= '0';
+							state <= IDLE;
+						else
+							victim_line <= victim_line + 1;
+							state <= MAINTENANCE_READ;
+						end if;
+				end case;
+			end if;
+		end if;
+	end process controller;
+
+end architecture behaviour;
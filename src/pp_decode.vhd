@@ -9,12 +9,18 @@ use ieee.numeric_std.all;
 use work.pp_types.all;
 use work.pp_constants.all;
 use work.pp_csr.all;
+use work.pp_utilities.all;
 
 --! @brief Instruction decode unit.
 entity pp_decode is
 	generic(
-		RESET_ADDRESS : std_logic_vector(31 downto 0);
-		PROCESSOR_ID  : std_logic_vector(31 downto 0)
+		RESET_ADDRESS            : std_logic_vector(31 downto 0);
+		PROCESSOR_ID             : std_logic_vector(31 downto 0);
+		EARLY_JUMPS              : boolean := true; --! Whether to redirect the fetch stage for direct jumps in the decode stage.
+		STATIC_BRANCH_PREDICTION : boolean := false; --! Whether to predict backwards branches as taken in the decode stage.
+		M_EXTENSION              : boolean := false; --! Whether to decode the M extension instructions.
+		ZBB_EXTENSION            : boolean := false; --! Whether to decode the Zbb and Zbkb extension instructions.
+		ZKNH_EXTENSION           : boolean := false  --! Whether to decode the SHA-256 instructions from the Zknh extension.
 	);
 	port(
 		clk    : in std_logic;
@@ -28,6 +34,11 @@ entity pp_decode is
 		instruction_address : in std_logic_vector(31 downto 0);
 		instruction_ready   : in std_logic;
 		instruction_count   : in std_logic;
+		instruction_compressed : in std_logic;
+
+		-- Branch prediction for the instruction:
+		instruction_predicted_taken  : in std_logic;
+		instruction_predicted_target : in std_logic_vector(31 downto 0);
 
 		-- Register addresses:
 		rs1_addr, rs2_addr, rd_addr : out register_address;
@@ -48,10 +59,20 @@ entity pp_decode is
 		alu_op            : out alu_operation;
 		mem_op            : out memory_operation_type;
 		mem_size          : out memory_operation_size;
+		fence             : out std_logic;
 		count_instruction : out std_logic;
 
 		-- Instruction address:
 		pc : out std_logic_vector(31 downto 0);
+		compressed : out std_logic;
+
+		-- Branch prediction:
+		predicted_taken  : out std_logic;
+		predicted_target : out std_logic_vector(31 downto 0);
+
+		-- Early redirection of the fetch stage:
+		early_branch        : out std_logic;
+		early_branch_target : out std_logic_vector(31 downto 0);
 
 		-- CSR control signals:
 		csr_write   : out csr_write_mode;
@@ -66,27 +87,44 @@ end entity pp_decode;
 
 architecture behaviour of pp_decode is
 	signal instruction     : std_logic_vector(31 downto 0);
+	signal instruction_pc  : std_logic_vector(31 downto 0);
 	signal immediate_value : std_logic_vector(31 downto 0);
+
+	-- Branch prediction from the fetch stage:
+	signal fetch_predicted_taken  : std_logic;
+	signal fetch_predicted_target : std_logic_vector(31 downto 0);
+
+	-- Branches and jumps resolved in the decode stage:
+	signal early_taken  : std_logic;
+	signal early_target : std_logic_vector(31 downto 0);
 begin
 
 	immediate <= immediate_value;
+	pc <= instruction_pc;
 
 	get_instruction: process(clk)
 	begin
 		if rising_edge(clk) then
 			if reset = '1' then
 				instruction <= RISCV_NOP;
-				pc <= RESET_ADDRESS;
+				instruction_pc <= RESET_ADDRESS;
 				count_instruction <= '0';
+				compressed <= '0';
+				fetch_predicted_taken <= '0';
 			elsif stall = '1' then
-				count_instruction <= '0';
+				-- Keep the current instruction until the pipeline is ready.
 			elsif flush = '1' or instruction_ready = '0' then
 				instruction <= RISCV_NOP;
 				count_instruction <= '0';
+				compressed <= '0';
+				fetch_predicted_taken <= '0';
 			else
 				instruction <= instruction_data;
 				count_instruction <= instruction_count;
-				pc <= instruction_address;
+				instruction_pc <= instruction_address;
+				compressed <= instruction_compressed;
+				fetch_predicted_taken <= instruction_predicted_taken;
+				fetch_predicted_target <= instruction_predicted_target;
 			end if;
 		end if;
 	end process get_instruction;
@@ -109,6 +147,20 @@ begin
 			immediate => immediate_value
 		);
 
+	-- Direct jumps, and backwards branches if static prediction is enabled, are
+	-- taken in the decode stage. The fetch stage is redirected unless it already
+	-- predicted the same target:
+	early_target <= std_logic_vector(unsigned(instruction_pc) + unsigned(immediate_value));
+	early_taken <= to_std_logic((EARLY_JUMPS and instruction(6 downto 0) = b"1101111")
+		or (STATIC_BRANCH_PREDICTION and instruction(6 downto 0) = b"1100011" and immediate_value(31) = '1'));
+
+	early_branch <= early_taken and not stall
+		and not (fetch_predicted_taken and to_std_logic(fetch_predicted_target = early_target));
+	early_branch_target <= early_target;
+
+	predicted_taken <= early_taken or fetch_predicted_taken;
+	predicted_target <= early_target when early_taken = '1' else fetch_predicted_target;
+
 	decode_csr_addr: process(immediate_value)
 	begin
 		if immediate_value(11 downto 0) = CSR_EPC_MRET then
@@ -119,7 +171,11 @@ begin
 	end process decode_csr_addr;
 
 	control_unit: entity work.pp_control_unit
-		port map(
+		generic map(
+			M_EXTENSION => M_EXTENSION,
+			ZBB_EXTENSION => ZBB_EXTENSION,
+			ZKNH_EXTENSION => ZKNH_EXTENSION
+		) port map(
 			opcode => instruction(6 downto 2),
 			funct3 => instruction(14 downto 12),
 			funct7 => instruction(31 downto 25),
@@ -131,6 +187,7 @@ begin
 			alu_op => alu_op,
 			mem_op => mem_op,
 			mem_size => mem_size,
+			fence => fence,
 			decode_exception => decode_exception,
 			decode_exception_cause => decode_exception_cause,
 			csr_write => csr_write,
@@ -0,0 +1,119 @@
+-- The Potato Processor - A simple processor for FPGAs
+-- (c) Kristian Klomsten Skordal 2014 - 2015 <kristian.skordal@wafflemail.net>
+-- Report bugs and issues on <https://github.com/skordal/potato/issues>
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.pp_types.all;
+
+--! @brief Iterative divider for the M extension.
+--! @details
+--!	Divides two 32-bit operands using a restoring division algorithm which
+--!	produces one bit of the quotient per cycle. Signed divisions are done
+--!	by dividing the absolute values of the operands and correcting the
+--!	signs of the results afterwards. Division by zero and overflow give
+--!	the results required by the specification. The result is available
+--!	32 cycles after the operation is started and is kept until the next
+--!	operation is started.
+entity pp_divider is
+	port(
+		clk   : in std_logic;
+		reset : in std_logic;
+
+		start     : in  std_logic;                     --! Starts a new division.
+		x, y      : in  std_logic_vector(31 downto 0); --! Dividend and divisor.
+		operation : in  alu_operation;                 --! Division to perform.
+		result    : out std_logic_vector(31 downto 0); --! Quotient or remainder.
+		ready     : out std_logic                      --! Pulsed when the result is available.
+	);
+end entity pp_divider;
+
+architecture behaviour of pp_divider is
+
+	signal busy    : std_logic;
+	signal counter : natural range 0 to 31;
+
+	signal divisor   : unsigned(31 downto 0);
+	signal quotient  : unsigned(31 downto 0);
+	signal remainder : unsigned(32 downto 0);
+
+	-- Result selection and sign correction:
+	signal return_remainder : std_logic;
+	signal negate_quotient, negate_remainder : std_logic;
+
+begin
+
+	result <= std_logic_vector(unsigned(-signed(remainder(31 downto 0)))) when return_remainder = '1' and negate_remainder = '1'
+		else std_logic_vector(remainder(31 downto 0)) when return_remainder = '1'
+		else std_logic_vector(unsigned(-signed(quotient))) when negate_quotient = '1'
+		else std_logic_vector(quotient);
+
+	divide: process(clk)
+		variable partial : unsigned(32 downto 0);
+		variable signed_op : boolean;
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				busy <= '0';
+				ready <= '0';
+			else
+				ready <= '0';
+
+				if start = '1' then
+					signed_op := operation = ALU_DIV or operation = ALU_REM;
+
+					if signed_op and x(31) = '1' then
+						quotient <= unsigned(-signed(x));
+					else
+						quotient <= unsigned(x);
+					end if;
+
+					if signed_op and y(31) = '1' then
+						divisor <= unsigned(-signed(y));
+					else
+						divisor <= unsigned(y);
+					end if;
+
+					remainder <= (others => '0');
+					counter <= 31;
+					busy <= '1';
+
+					return_remainder <= '0';
+					if operation = ALU_REM or operation = ALU_REMU then
+						return_remainder <= '1';
+					end if;
+
+					-- A division by zero returns -1 regardless of the sign of the dividend:
+					negate_quotient <= '0';
+					negate_remainder <= '0';
+					if signed_op then
+						if y /= x"00000000" then
+							negate_quotient <= x(31) xor y(31);
+						end if;
+						negate_remainder <= x(31);
+					end if;
+				elsif busy = '1' then
+					partial := remainder(31 downto 0) & quotient(31);
+
+					if partial >= ('0' & divisor) then
+						remainder <= partial - ('0' & divisor);
+						quotient <= quotient(30 downto 0) & '1';
+					else
+						remainder <= partial;
+						quotient <= quotient(30 downto 0) & '0';
+					end if;
+
+					if counter = 0 then
+						busy <= '0';
+						ready <= '1';
+					else
+						counter <= counter - 1;
+					end if;
+				end if;
+			end if;
+		end if;
+	end process divide;
+
+end architecture behaviour;
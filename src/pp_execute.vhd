@@ -11,6 +11,14 @@ use work.pp_csr.all;
 use work.pp_utilities.all;
 
 entity pp_execute is
+	generic(
+		LOAD_USE_BYPASS : boolean := false; --! Whether to forward load data directly from the data memory to dependent instructions.
+		M_EXTENSION     : boolean := false; --! Whether to include the multiplier and divider for the M extension.
+		ZBB_EXTENSION   : boolean := false; --! Whether to include the Zbb and Zbkb bit-manipulation operations in the ALU.
+		ZKNH_EXTENSION  : boolean := false; --! Whether to include the SHA-256 operations from the Zknh extension in the ALU.
+		C_EXTENSION     : boolean := false; --! Whether compressed instructions are supported, allowing halfword-aligned jump targets.
+		MISALIGNED_ACCESS : boolean := false --! Whether misaligned loads and stores are handled by the memory interface.
+	);
 	port(
 		clk    : in std_logic;
 		reset  : in std_logic;
@@ -27,6 +35,15 @@ entity pp_execute is
 		dmem_data_size : out std_logic_vector( 1 downto 0);
 		dmem_read_req  : out std_logic;
 		dmem_write_req : out std_logic;
+		dmem_drained   : in  std_logic;
+		dmem_ready     : in  std_logic;
+
+		-- Instruction cache invalidation by FENCE.I and by writes to the invalidation end address register,
+		-- FENCE.I also writes all modified data cache lines to memory:
+		dcache_flush_out            : out std_logic; --! Requests writing all modified data cache lines to memory.
+		icache_invalidate_out       : out std_logic; --! Requests invalidating all instruction cache lines.
+		icache_invalidate_range_out : out std_logic; --! Requests invalidating the lines in a range of addresses.
+		icache_invalidate_end_out   : out std_logic_vector(31 downto 0); --! End address of the range.
 
 		-- Register addresses:
 		rs1_addr_in, rs2_addr_in, rd_addr_in : in  register_address;
@@ -44,6 +61,13 @@ entity pp_execute is
 		pc_in     : in  std_logic_vector(31 downto 0);
 		pc_out    : out std_logic_vector(31 downto 0);
 
+		-- Set if the instruction is a compressed instruction:
+		compressed_in : in std_logic;
+
+		-- Branch prediction for the instruction:
+		predicted_taken_in  : in std_logic;
+		predicted_target_in : in std_logic_vector(31 downto 0);
+
 		-- Funct3 value from the instruction, used to choose which comparison
 		-- is used when branching:
 		funct3_in : in std_logic_vector(2 downto 0);
@@ -71,6 +95,7 @@ entity pp_execute is
 		mem_op_out   : out memory_operation_type;
 		mem_size_in  : in  memory_operation_size;
 		mem_size_out : out memory_operation_size;
+		fence_in     : in  std_logic;
 
 		-- Whether the instruction should be counted:
 		count_instruction_in  : in  std_logic;
@@ -94,6 +119,16 @@ entity pp_execute is
 		-- Control outputs:
 		jump_out        : out std_logic;
 		jump_target_out : out std_logic_vector(31 downto 0);
+		mispredicted_out : out std_logic; --! Set when the jump is caused by a mispredicted branch.
+
+		-- Branch predictor update outputs:
+		predictor_update_out        : out std_logic;
+		predictor_update_branch_out : out branch_type;
+		predictor_update_taken_out  : out std_logic;
+		predictor_update_target_out : out std_logic_vector(31 downto 0);
+		predictor_update_call_out   : out std_logic;
+		predictor_update_return_out : out std_logic;
+		predictor_update_compressed_out : out std_logic;
 
 		-- Inputs to the forwarding logic from the MEM stage:
 		mem_rd_write          : in std_logic;
@@ -101,6 +136,7 @@ entity pp_execute is
 		mem_rd_value          : in std_logic_vector(31 downto 0);
 		mem_csr_addr          : in csr_address;
 		mem_csr_write         : in csr_write_mode;
+		mem_csr_value         : in std_logic_vector(31 downto 0);
 		mem_exception         : in std_logic;
 
 		-- Inputs to the forwarding logic from the WB stage:
@@ -109,10 +145,13 @@ entity pp_execute is
 		wb_rd_value          : in std_logic_vector(31 downto 0);
 		wb_csr_addr          : in csr_address;
 		wb_csr_write         : in csr_write_mode;
+		wb_csr_value         : in std_logic_vector(31 downto 0);
 		wb_exception         : in std_logic;
 
 		-- Hazard detection unit signals:
 		mem_mem_op      : in  memory_operation_type;
+		dmem_read_ack   : in  std_logic;
+		pending_loads   : in  std_logic_vector(31 downto 0); --! Registers waiting for the results of outstanding loads.
 		hazard_detected : out std_logic
 	);
 end entity pp_execute;
@@ -123,13 +162,23 @@ architecture behaviour of pp_execute is
 
 	signal alu_x, alu_y, alu_result : std_logic_vector(31 downto 0);
 
-	signal rs1_addr, rs2_addr : register_address;
+	signal rs1_addr, rs2_addr, rd_addr : register_address;
+	signal rd_write : std_logic;
+	signal count_instruction : std_logic;
 	signal rs1_data, rs2_data : std_logic_vector(31 downto 0);
 
 	signal mem_op : memory_operation_type;
 	signal mem_size : memory_operation_size;
+	signal fence : std_logic;
+
+	-- FENCE.I signals, set when the instruction is a FENCE.I and when the data cache flush has been requested:
+	signal fence_i, fence_i_flushed : std_logic;
+
+	-- Set when the instruction writes the instruction cache invalidation end address register:
+	signal icache_range_write : std_logic;
 
 	signal pc        : std_logic_vector(31 downto 0);
+	signal compressed : std_logic;
 	signal immediate : std_logic_vector(31 downto 0);
 	signal shamt     : std_logic_vector( 4 downto 0);
 	signal funct3    : std_logic_vector( 2 downto 0);
@@ -138,8 +187,14 @@ architecture behaviour of pp_execute is
 
 	signal branch : branch_type;
 	signal branch_condition : std_logic;
-	signal do_jump : std_logic;
+	signal jump_condition, do_jump : std_logic;
 	signal jump_target : std_logic_vector(31 downto 0);
+	signal next_pc : std_logic_vector(31 downto 0);
+
+	signal predicted_taken : std_logic;
+	signal predicted_target : std_logic_vector(31 downto 0);
+	signal mispredicted : std_logic;
+	signal refetch : std_logic;
 
 	signal mie, mtvec : std_logic_vector(31 downto 0);
 
@@ -148,6 +203,7 @@ architecture behaviour of pp_execute is
 	signal csr_use_immediate : std_logic;
 
 	signal csr_value : std_logic_vector(31 downto 0);
+	signal csr_write_value : std_logic_vector(31 downto 0);
 	
 	signal decode_exception : std_logic;
 	signal decode_exception_cause : csr_exception_cause;
@@ -162,23 +218,42 @@ architecture behaviour of pp_execute is
 	signal irq_asserted_num : std_logic_vector(3 downto 0);
 
 	signal load_hazard_detected, csr_hazard_detected : std_logic;
+
+	-- Draining of stores buffered in the memory system:
+	signal drain_required, drain_hazard_detected : std_logic;
+
+	-- Outstanding loads:
+	signal scoreboard_hazard_detected, memory_hazard_detected : std_logic;
+
+	-- Multiplication and division signals:
+	signal mul_op, div_op : std_logic;
+	signal mul_start, div_start : std_logic;
+	signal mul_ready, div_ready : std_logic;
+	signal mul_result, div_result : std_logic_vector(31 downto 0);
+	signal muldiv_op, muldiv_pending, muldiv_finished : std_logic;
+	signal muldiv_hazard_detected : std_logic;
 begin
 
 	-- Register values should not be latched in by a clocked process,
 	-- this is already done in the register files.
-	csr_value <= csr_value_in;
-	rd_data_out <= alu_result;
+	rd_data_out <= mul_result when mul_op = '1' else div_result when div_op = '1' else alu_result;
 
-	branch_out <= branch;
+	-- A bubble is passed on to the memory stage while the instruction is stalled:
+	rd_write_out <= rd_write and not stall;
+	count_instruction_out <= count_instruction and not stall;
+	branch_out <= branch when stall = '0' else BRANCH_NONE;
 
-	mem_op_out <= mem_op;
+	mem_op_out <= mem_op when stall = '0' else MEMOP_TYPE_NONE;
 	mem_size_out <= mem_size;
 
-	csr_write_out <= csr_write;
+	csr_write_out <= csr_write when stall = '0' else CSR_WRITE_NONE;
 	csr_addr_out  <= csr_addr;
+	csr_value_out <= csr_write_value;
 
 	pc_out <= pc;
-	hazard_detected <= load_hazard_detected or csr_hazard_detected;
+	rd_addr_out <= rd_addr;
+	hazard_detected <= load_hazard_detected or csr_hazard_detected or muldiv_hazard_detected or drain_hazard_detected
+		or scoreboard_hazard_detected or memory_hazard_detected or (fence_i and not fence_i_flushed);
 	exception_out <= exception_taken;
 	exception_context_out <= (
 				ie => ie_in,
@@ -186,11 +261,39 @@ begin
 				cause => exception_cause,
 				badaddr => exception_addr);
 
-	do_jump <= (to_std_logic(branch = BRANCH_JUMP or branch = BRANCH_JUMP_INDIRECT)
+	jump_condition <= to_std_logic(branch = BRANCH_JUMP or branch = BRANCH_JUMP_INDIRECT)
 		or (to_std_logic(branch = BRANCH_CONDITIONAL) and branch_condition)
-		or to_std_logic(branch = BRANCH_SRET)) and not stall;
-	jump_out <= do_jump;
-	jump_target_out <= jump_target;
+		or to_std_logic(branch = BRANCH_SRET);
+	do_jump <= jump_condition and not stall;
+
+	-- The fetch stage is only redirected if the branch prediction was wrong, or to fetch the following
+	-- instructions again after the instruction cache has been invalidated:
+	next_pc <= std_logic_vector(unsigned(pc) + 2) when compressed = '1' else std_logic_vector(unsigned(pc) + 4);
+	mispredicted <= (do_jump and (not predicted_taken or to_std_logic(predicted_target /= jump_target)))
+		or (predicted_taken and not do_jump and not stall);
+	refetch <= (fence_i or icache_range_write) and not stall;
+
+	jump_out <= mispredicted or refetch;
+	mispredicted_out <= mispredicted;
+	jump_target_out <= jump_target when do_jump = '1' else next_pc;
+
+	predictor_update_out <= to_std_logic(branch /= BRANCH_NONE or predicted_taken = '1')
+		and not stall and not exception_taken;
+	predictor_update_branch_out <= branch;
+	predictor_update_taken_out <= do_jump;
+	predictor_update_target_out <= jump_target;
+
+	-- Calls and returns are detected using the link register hints in the specification:
+	predictor_update_call_out <= to_std_logic((branch = BRANCH_JUMP or branch = BRANCH_JUMP_INDIRECT)
+		and is_link_register(rd_addr));
+	predictor_update_return_out <= to_std_logic(branch = BRANCH_JUMP_INDIRECT and is_link_register(rs1_addr)
+		and (not is_link_register(rd_addr) or rd_addr /= rs1_addr));
+	predictor_update_compressed_out <= compressed;
+
+	-- The exception vector and interrupt enable registers are read directly from the CSR unit,
+	-- so that writes to them take effect as soon as the CSR hazard is resolved:
+	mtvec <= mtvec_in;
+	mie <= mie_in;
 
 	mtvec_out <= std_logic_vector(unsigned(mtvec));
 	exception_taken <= not stall and (decode_exception or to_std_logic(exception_cause /= CSR_CAUSE_NONE)); 
@@ -203,28 +306,71 @@ begin
 	dmem_address <= alu_result when (mem_op /= MEMOP_TYPE_NONE and mem_op /= MEMOP_TYPE_INVALID) and exception_taken = '0'
 		else (others => '0');
 	dmem_data_out <= rs2_forwarded;
-	dmem_write_req <= '1' when mem_op = MEMOP_TYPE_STORE and exception_taken = '0' else '0';
-	dmem_read_req <= '1' when memop_is_load(mem_op) and exception_taken = '0' else '0';
+	dmem_write_req <= '1' when mem_op = MEMOP_TYPE_STORE and exception_taken = '0' and stall = '0' else '0';
+	dmem_read_req <= '1' when memop_is_load(mem_op) and exception_taken = '0' and stall = '0' else '0';
+
+	-- Stores buffered in the memory system are written to memory before fences, writes to the
+	-- test register, which reports test results, writes to the cache control registers and
+	-- exceptions are allowed to complete:
+	drain_required <= fence or to_std_logic(csr_write /= CSR_WRITE_NONE and (csr_addr = CSR_TEST or csr_addr = CSR_DCACHE
+			or csr_addr = CSR_ICACHE_INVALIDATE_END))
+		or to_std_logic(exception_cause /= CSR_CAUSE_NONE);
+	drain_hazard_detected <= drain_required and not dmem_drained;
+
+	-- FENCE.I writes all modified data cache lines to memory once the buffered stores have been drained,
+	-- and waits for this to finish before invalidating the instruction cache. Writes to the invalidation
+	-- end address register invalidate the range starting at the address in the start address register.
+	-- The instructions following either are then fetched again by redirecting the fetch stage to the
+	-- next instruction:
+	fence_i <= fence and to_std_logic(funct3 = b"001");
+	icache_range_write <= to_std_logic(csr_write /= CSR_WRITE_NONE and csr_addr = CSR_ICACHE_INVALIDATE_END);
+	icache_invalidate_out <= fence_i and not stall;
+	icache_invalidate_range_out <= icache_range_write and not stall;
+	icache_invalidate_end_out <= csr_write_value;
+
+	fence_i_flush: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' or flush = '1' then
+				fence_i_flushed <= '0';
+				dcache_flush_out <= '0';
+			else
+				dcache_flush_out <= '0';
+
+				if stall = '0' then
+					fence_i_flushed <= '0';
+				elsif fence_i = '1' and fence_i_flushed = '0' and dmem_drained = '1' then
+					fence_i_flushed <= '1';
+					dcache_flush_out <= '1';
+				end if;
+			end if;
+		end if;
+	end process fence_i_flush;
+
+	-- Memory accesses wait until the data memory interface can accept them:
+	memory_hazard_detected <= to_std_logic(mem_op = MEMOP_TYPE_STORE or memop_is_load(mem_op)) and not dmem_ready;
 
 	pipeline_register: process(clk)
 	begin
 		if rising_edge(clk) then
 			if reset = '1' or flush = '1' then
-				rd_write_out <= '0';
+				rd_write <= '0';
+				alu_op <= ALU_NOP;
 				branch <= BRANCH_NONE;
+				predicted_taken <= '0';
 				csr_write <= CSR_WRITE_NONE;
 				mem_op <= MEMOP_TYPE_NONE;
+				fence <= '0';
 				decode_exception <= '0';
-				count_instruction_out <= '0';
-			elsif stall = '1' then
-				csr_write <= CSR_WRITE_NONE;
+				count_instruction <= '0';
 			elsif stall = '0' then
 				pc <= pc_in;
-				count_instruction_out <= count_instruction_in;
+				compressed <= compressed_in;
+				count_instruction <= count_instruction_in;
 
 				-- Register signals:
-				rd_write_out <= rd_write_in;
-				rd_addr_out <= rd_addr_in;
+				rd_write <= rd_write_in;
+				rd_addr <= rd_addr_in;
 				rs1_addr <= rs1_addr_in;
 				rs2_addr <= rs2_addr_in;
 
@@ -235,8 +381,11 @@ begin
 
 				-- Control signals:
 				branch <= branch_in;
+				predicted_taken <= predicted_taken_in;
+				predicted_target <= predicted_target_in;
 				mem_op <= mem_op_in;
 				mem_size <= mem_size_in;
+				fence <= fence_in;
 
 				-- Constant values:
 				immediate <= immediate_in;
@@ -248,10 +397,6 @@ begin
 				csr_addr <= csr_addr_in;
 				csr_use_immediate <= csr_use_immediate_in;
 
-				-- Exception vector base:
-				mtvec <= mtvec_in;
-				mie <= mie_in;
-
 				-- Instruction decoder exceptions:
 				decode_exception <= decode_exception_in;
 				decode_exception_cause <= decode_exception_cause_in;
@@ -288,29 +433,37 @@ begin
 		irq_asserted_num <= temp;
 	end process get_irq_num;
 
+	-- Misaligned loads and stores only cause exceptions if the memory interface cannot handle them:
 	data_misalign_check: process(mem_size, alu_result)
 	begin
-		case mem_size is
-			when MEMOP_SIZE_HALFWORD =>
-				if alu_result(0) /= '0' then
-					data_misaligned <= '1';
-				else
-					data_misaligned <= '0';
-				end if;
-			when MEMOP_SIZE_WORD =>
-				if alu_result(1 downto 0) /= b"00" then
-					data_misaligned <= '1';
-				else
+		if MISALIGNED_ACCESS then
+			data_misaligned <= '0';
+		else
+			case mem_size is
+				when MEMOP_SIZE_HALFWORD =>
+					if alu_result(0) /= '0' then
+						data_misaligned <= '1';
+					else
+						data_misaligned <= '0';
+					end if;
+				when MEMOP_SIZE_WORD =>
+					if alu_result(1 downto 0) /= b"00" then
+						data_misaligned <= '1';
+					else
+						data_misaligned <= '0';
+					end if;
+				when others =>
 					data_misaligned <= '0';
-				end if;
-			when others =>
-				data_misaligned <= '0';
-		end case;
+			end case;
+		end if;
 	end process data_misalign_check;
 
-	instr_misalign_check: process(jump_target, branch, branch_condition, do_jump)
+	-- Jump targets only need to be halfword-aligned when compressed instructions are supported:
+	instr_misalign_check: process(jump_target, jump_condition)
 	begin
-		if jump_target(1 downto 0) /= b"00" and do_jump = '1' then
+		if ((C_EXTENSION and jump_target(0) /= '0') or (not C_EXTENSION and jump_target(1 downto 0) /= b"00"))
+			and jump_condition = '1'
+		then
 			instr_misaligned <= '1';
 		else
 			instr_misaligned <= '0';
@@ -374,6 +527,7 @@ begin
 			immediate_value => immediate,
 			shamt_value => shamt,
 			pc_value => pc,
+			pc_next_value => next_pc,
 			csr_value => csr_value,
 			output => alu_x
 		);
@@ -385,6 +539,7 @@ begin
 			immediate_value => immediate,
 			shamt_value => shamt,
 			pc_value => pc,
+			pc_next_value => next_pc,
 			csr_value => csr_value,
 			output => alu_y
 		);
@@ -413,9 +568,24 @@ begin
 		end if;
 	end process alu_y_forward;
 
-	detect_csr_hazard: process(mem_csr_write, wb_csr_write, mem_exception, wb_exception)
+	csr_forward: process(csr_addr, csr_value_in, mem_csr_write, mem_csr_addr, mem_csr_value,
+		wb_csr_write, wb_csr_addr, wb_csr_value)
 	begin
-		if mem_csr_write /= CSR_WRITE_NONE or wb_csr_write /= CSR_WRITE_NONE
+		if mem_csr_write /= CSR_WRITE_NONE and mem_csr_addr = csr_addr then
+			csr_value <= mem_csr_value;
+		elsif wb_csr_write /= CSR_WRITE_NONE and wb_csr_addr = csr_addr then
+			csr_value <= wb_csr_value;
+		else
+			csr_value <= csr_value_in;
+		end if;
+	end process csr_forward;
+
+	-- CSR values are forwarded from the MEM and WB stages, but writes to registers that
+	-- control interrupts and exceptions must complete before the next instruction executes:
+	detect_csr_hazard: process(mem_csr_write, mem_csr_addr, wb_csr_write, wb_csr_addr, mem_exception, wb_exception)
+	begin
+		if (mem_csr_write /= CSR_WRITE_NONE and csr_has_side_effects(mem_csr_addr))
+			or (wb_csr_write /= CSR_WRITE_NONE and csr_has_side_effects(wb_csr_addr))
 			or mem_exception = '1' or wb_exception = '1' then
 			csr_hazard_detected <= '1';
 		else
@@ -423,10 +593,13 @@ begin
 		end if;
 	end process detect_csr_hazard;
 
+	-- When the load-use bypass is enabled, the loaded value is forwarded from the memory
+	-- stage in the same cycle as it arrives, and the hazard only lasts until then:
 	detect_load_hazard: process(mem_mem_op, mem_rd_addr, rs1_addr, rs2_addr,
-		alu_x_src, alu_y_src)
+		alu_x_src, alu_y_src, dmem_read_ack)
 	begin
 		if (mem_mem_op = MEMOP_TYPE_LOAD or mem_mem_op = MEMOP_TYPE_LOAD_UNSIGNED) and
+				(not LOAD_USE_BYPASS or dmem_read_ack = '0') and
 				((alu_x_src = ALU_SRC_REG and mem_rd_addr = rs1_addr and rs1_addr /= b"00000")
 			or
 				(alu_y_src = ALU_SRC_REG and mem_rd_addr = rs2_addr and rs2_addr /= b"00000"))
@@ -437,6 +610,96 @@ begin
 		end if;
 	end process detect_load_hazard;
 
+	-- Instructions using or overwriting registers waiting for the results of outstanding loads
+	-- wait until the results have been written to the register file:
+	detect_scoreboard_hazard: process(pending_loads, rs1_addr, rs2_addr, rd_addr, rd_write,
+		alu_x_src, alu_y_src, branch, mem_op, csr_write)
+		variable rs1_used, rs2_used : boolean;
+	begin
+		rs1_used := alu_x_src = ALU_SRC_REG or branch = BRANCH_JUMP_INDIRECT or branch = BRANCH_CONDITIONAL
+			or csr_write /= CSR_WRITE_NONE;
+		rs2_used := alu_y_src = ALU_SRC_REG or branch = BRANCH_CONDITIONAL or mem_op = MEMOP_TYPE_STORE;
+
+		if (rs1_used and pending_loads(to_integer(unsigned(rs1_addr))) = '1')
+			or (rs2_used and pending_loads(to_integer(unsigned(rs2_addr))) = '1')
+			or (rd_write = '1' and pending_loads(to_integer(unsigned(rd_addr))) = '1')
+		then
+			scoreboard_hazard_detected <= '1';
+		else
+			scoreboard_hazard_detected <= '0';
+		end if;
+	end process detect_scoreboard_hazard;
+
+	mul_op <= to_std_logic(alu_op = ALU_MUL or alu_op = ALU_MULH or alu_op = ALU_MULHSU or alu_op = ALU_MULHU);
+	div_op <= to_std_logic(alu_op = ALU_DIV or alu_op = ALU_DIVU or alu_op = ALU_REM or alu_op = ALU_REMU);
+	muldiv_op <= mul_op or div_op;
+
+	-- Multiplications and divisions stall the pipeline until their results are ready. The
+	-- operation is not started until the operands are available from the forwarding logic:
+	muldiv_hazard_detected <= muldiv_op and not (mul_ready or div_ready or muldiv_finished);
+	mul_start <= mul_op and not muldiv_pending and not muldiv_finished and not load_hazard_detected
+		and not scoreboard_hazard_detected;
+	div_start <= div_op and not muldiv_pending and not muldiv_finished and not load_hazard_detected
+		and not scoreboard_hazard_detected;
+
+	muldiv_control: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				muldiv_pending <= '0';
+				muldiv_finished <= '0';
+			else
+				if mul_start = '1' or div_start = '1' then
+					muldiv_pending <= '1';
+				elsif mul_ready = '1' or div_ready = '1' then
+					muldiv_pending <= '0';
+				end if;
+
+				-- Keep the result if the instruction is stalled for other reasons:
+				if stall = '0' then
+					muldiv_finished <= '0';
+				elsif mul_ready = '1' or div_ready = '1' then
+					muldiv_finished <= '1';
+				end if;
+			end if;
+		end if;
+	end process muldiv_control;
+
+	muldiv_enabled: if M_EXTENSION
+	generate
+		multiplier: entity work.pp_multiplier
+			port map(
+				clk => clk,
+				reset => reset,
+				start => mul_start,
+				x => rs1_forwarded,
+				y => rs2_forwarded,
+				operation => alu_op,
+				result => mul_result,
+				ready => mul_ready
+			);
+
+		divider: entity work.pp_divider
+			port map(
+				clk => clk,
+				reset => reset,
+				start => div_start,
+				x => rs1_forwarded,
+				y => rs2_forwarded,
+				operation => alu_op,
+				result => div_result,
+				ready => div_ready
+			);
+	end generate muldiv_enabled;
+
+	muldiv_disabled: if not M_EXTENSION
+	generate
+		mul_result <= (others => '0');
+		mul_ready <= '0';
+		div_result <= (others => '0');
+		div_ready <= '0';
+	end generate muldiv_disabled;
+
 	branch_comparator: entity work.pp_comparator
 		port map(
 			funct3 => funct3,
@@ -446,7 +709,10 @@ begin
 		);
 
 	alu_instance: entity work.pp_alu
-		port map(
+		generic map(
+			ZBB_EXTENSION => ZBB_EXTENSION,
+			ZKNH_EXTENSION => ZKNH_EXTENSION
+		) port map(
 			result => alu_result,
 			x => alu_x,
 			y => alu_y,
@@ -457,7 +723,7 @@ begin
 		port map(
 			x => csr_value,
 			y => rs1_forwarded,
-			result => csr_value_out,
+			result => csr_write_value,
 			immediate => rs1_addr,
 			use_immediate => csr_use_immediate,
 			write_mode => csr_write
@@ -0,0 +1,151 @@
+-- The Potato Processor - A simple processor for FPGAs
+-- (c) Kristian Klomsten Skordal 2014 - 2015 <kristian.skordal@wafflemail.net>
+-- Report bugs and issues on <https://github.com/skordal/potato/issues>
+
+library ieee;
+use ieee.std_logic_1164.all;
+
+--! @brief Module expanding compressed instructions into their 32-bit equivalents.
+--! @details
+--!	Compressed instructions from the RV32C extension are expanded into the
+--!	corresponding 32-bit instructions, so that the rest of the pipeline only
+--!	has to deal with one instruction format. Reserved and illegal compressed
+--!	instructions, including those for the F and D extensions, are expanded
+--!	into an invalid instruction, causing an illegal instruction exception
+--!	when they reach the decode stage.
+entity pp_expander is
+	port(
+		instruction_in  : in  std_logic_vector(15 downto 0); --! Compressed instruction.
+		instruction_out : out std_logic_vector(31 downto 0)  --! Expanded instruction.
+	);
+end entity pp_expander;
+
+architecture behaviour of pp_expander is
+	constant INVALID_INSTRUCTION : std_logic_vector(31 downto 0) := (others => '1');
+begin
+
+	expand: process(instruction_in)
+		variable c : std_logic_vector(15 downto 0);
+		variable rd, rs2 : std_logic_vector(4 downto 0);
+		variable rd_c, rs1_c, rs2_c : std_logic_vector(4 downto 0);
+		variable imm6 : std_logic_vector(11 downto 0);
+	begin
+		c := instruction_in;
+
+		-- Full register addresses:
+		rd := c(11 downto 7);
+		rs2 := c(6 downto 2);
+
+		-- Register addresses for the compressed register fields, x8 - x15:
+		rd_c := b"01" & c(4 downto 2);
+		rs1_c := b"01" & c(9 downto 7);
+		rs2_c := b"01" & c(4 downto 2);
+
+		-- Sign-extended 6-bit immediate used by several instructions:
+		imm6 := (11 downto 5 => c(12)) & c(6 downto 2);
+
+		instruction_out <= INVALID_INSTRUCTION;
+
+		case c(1 downto 0) is
+			when b"00" =>
+				case c(15 downto 13) is
+					when b"000" => -- c.addi4spn
+						if c(12 downto 5) /= x"00" then
+							instruction_out <= b"00" & c(10 downto 7) & c(12 downto 11) & c(5) & c(6) & b"00"
+								& b"00010" & b"000" & rd_c & b"0010011";
+						end if;
+					when b"010" => -- c.lw
+						instruction_out <= b"00000" & c(5) & c(12 downto 10) & c(6) & b"00"
+							& rs1_c & b"010" & rd_c & b"0000011";
+					when b"110" => -- c.sw
+						instruction_out <= b"00000" & c(5) & c(12) & rs2_c & rs1_c & b"010"
+							& c(11 downto 10) & c(6) & b"00" & b"0100011";
+					when others =>
+				end case;
+			when b"01" =>
+				case c(15 downto 13) is
+					when b"000" => -- c.addi, c.nop
+						instruction_out <= imm6 & rd & b"000" & rd & b"0010011";
+					when b"001" | b"101" => -- c.jal, c.j
+						instruction_out <= c(12) & c(8) & c(10 downto 9) & c(6) & c(7) & c(2) & c(11) & c(5 downto 3)
+							& c(12) & (7 downto 0 => c(12)) & b"0000" & not c(15) & b"1101111";
+					when b"010" => -- c.li
+						instruction_out <= imm6 & b"00000" & b"000" & rd & b"0010011";
+					when b"011" =>
+						if c(12) = '0' and c(6 downto 2) = b"00000" then
+							-- Reserved, the immediate must be non-zero.
+						elsif rd = b"00010" then -- c.addi16sp
+							instruction_out <= (11 downto 9 => c(12)) & c(4 downto 3) & c(5) & c(2) & c(6) & b"0000"
+								& b"00010" & b"000" & b"00010" & b"0010011";
+						else -- c.lui
+							instruction_out <= (19 downto 5 => c(12)) & c(6 downto 2) & rd & b"0110111";
+						end if;
+					when b"100" =>
+						case c(11 downto 10) is
+							when b"00" => -- c.srli
+								if c(12) = '0' then
+									instruction_out <= b"0000000" & c(6 downto 2) & rs1_c & b"101" & rs1_c & b"0010011";
+								end if;
+							when b"01" => -- c.srai
+								if c(12) = '0' then
+									instruction_out <= b"0100000" & c(6 downto 2) & rs1_c & b"101" & rs1_c & b"0010011";
+								end if;
+							when b"10" => -- c.andi
+								instruction_out <= imm6 & rs1_c & b"111" & rs1_c & b"0010011";
+							when b"11" =>
+								if c(12) = '0' then
+									case c(6 downto 5) is
+										when b"00" => -- c.sub
+											instruction_out <= b"0100000" & rs2_c & rs1_c & b"000" & rs1_c & b"0110011";
+										when b"01" => -- c.xor
+											instruction_out <= b"0000000" & rs2_c & rs1_c & b"100" & rs1_c & b"0110011";
+										when b"10" => -- c.or
+											instruction_out <= b"0000000" & rs2_c & rs1_c & b"110" & rs1_c & b"0110011";
+										when b"11" => -- c.and
+											instruction_out <= b"0000000" & rs2_c & rs1_c & b"111" & rs1_c & b"0110011";
+										when others =>
+									end case;
+								end if;
+							when others =>
+						end case;
+					when b"110" | b"111" => -- c.beqz, c.bnez
+						instruction_out <= c(12) & (2 downto 0 => c(12)) & c(6 downto 5) & c(2) & b"00000" & rs1_c
+							& b"00" & c(13) & c(11 downto 10) & c(4 downto 3) & c(12) & b"1100011";
+					when others =>
+				end case;
+			when b"10" =>
+				case c(15 downto 13) is
+					when b"000" => -- c.slli
+						if c(12) = '0' then
+							instruction_out <= b"0000000" & c(6 downto 2) & rd & b"001" & rd & b"0010011";
+						end if;
+					when b"010" => -- c.lwsp
+						if rd /= b"00000" then
+							instruction_out <= b"0000" & c(3 downto 2) & c(12) & c(6 downto 4) & b"00"
+								& b"00010" & b"010" & rd & b"0000011";
+						end if;
+					when b"100" =>
+						if c(12) = '0' and rs2 = b"00000" then -- c.jr
+							if rd /= b"00000" then
+								instruction_out <= x"000" & rd & b"000" & b"00000" & b"1100111";
+							end if;
+						elsif c(12) = '0' then -- c.mv
+							instruction_out <= b"0000000" & rs2 & b"00000" & b"000" & rd & b"0110011";
+						elsif rs2 = b"00000" and rd = b"00000" then -- c.ebreak
+							instruction_out <= x"00100073";
+						elsif rs2 = b"00000" then -- c.jalr
+							instruction_out <= x"000" & rd & b"000" & b"00001" & b"1100111";
+						else -- c.add
+							instruction_out <= b"0000000" & rs2 & rd & b"000" & rd & b"0110011";
+						end if;
+					when b"110" => -- c.swsp
+						instruction_out <= b"0000" & c(8 downto 7) & c(12) & rs2 & b"00010" & b"010"
+							& c(11 downto 9) & b"00" & b"0100011";
+					when others =>
+				end case;
+			when others =>
+				-- Not a compressed instruction.
+		end case;
+	end process expand;
+
+end architecture behaviour;
@@ -6,12 +6,19 @@ library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
+use work.pp_types.all;
 use work.pp_constants.all;
+use work.pp_utilities.all;
 
 --! @brief Instruction fetch unit.
 entity pp_fetch is
 	generic(
-		RESET_ADDRESS : std_logic_vector(31 downto 0)
+		RESET_ADDRESS     : std_logic_vector(31 downto 0);
+		BRANCH_PREDICTION : boolean := false; --! Whether to enable dynamic branch prediction.
+		BTB_NUM_ENTRIES   : natural := 32;    --! Number of entries in the branch target buffer.
+		BHT_NUM_ENTRIES   : natural := 128;   --! Number of counters in the branch history table.
+		RAS_DEPTH         : natural := 0;     --! Number of entries in the return address stack, 0 disables it.
+		C_EXTENSION       : boolean := false  --! Whether to support compressed instructions.
 	);
 	port(
 		clk    : in std_logic;
@@ -32,10 +39,36 @@ entity pp_fetch is
 		branch_target : in std_logic_vector(31 downto 0);
 		evec          : in std_logic_vector(31 downto 0);
 
+		-- Branches taken in the decode stage:
+		decode_branch        : in std_logic;
+		decode_branch_target : in std_logic_vector(31 downto 0);
+
+		-- Return address stack restore signals from the fetch queue:
+		ras_restore_checkpoint : in std_logic;
+		ras_restore_state      : in ras_checkpoint;
+
+		-- Branch predictor update inputs from the execute stage:
+		predictor_update         : in std_logic;
+		predictor_update_address : in std_logic_vector(31 downto 0);
+		predictor_update_branch  : in branch_type;
+		predictor_update_taken   : in std_logic;
+		predictor_update_target  : in std_logic_vector(31 downto 0);
+		predictor_update_call    : in std_logic;
+		predictor_update_return  : in std_logic;
+		predictor_update_compressed : in std_logic;
+
 		-- Outputs to the instruction decode unit:
 		instruction_data    : out std_logic_vector(31 downto 0);
 		instruction_address : out std_logic_vector(31 downto 0);
-		instruction_ready   : out std_logic
+		instruction_ready   : out std_logic;
+		instruction_compressed : out std_logic;
+
+		-- Branch prediction for the current instruction:
+		instruction_predicted_taken  : out std_logic;
+		instruction_predicted_target : out std_logic_vector(31 downto 0);
+
+		-- Return address stack state before the current instruction:
+		instruction_ras_checkpoint : out ras_checkpoint
 	);
 end entity pp_fetch;
 
@@ -43,46 +76,336 @@ architecture behaviour of pp_fetch is
 	signal pc           : std_logic_vector(31 downto 0);
 	signal pc_next      : std_logic_vector(31 downto 0);
 	signal cancel_fetch : std_logic;
-begin
 
-	imem_address <= pc_next when cancel_fetch = '0' else pc;
+	-- Branch prediction for the instruction at the current PC:
+	signal prediction_taken  : std_logic;
+	signal prediction_target : std_logic_vector(31 downto 0);
+
+	-- Prediction from the branch target buffer:
+	signal btb_prediction_taken  : std_logic;
+	signal btb_prediction_target : std_logic_vector(31 downto 0);
 
-	instruction_data <= imem_data_in;
-	instruction_ready <= imem_ack and (not stall) and (not cancel_fetch);
+	-- Return address stack signals:
+	signal instruction_accepted : std_logic;
+	signal instruction_is_call, instruction_is_return : std_logic;
+	signal ras_prediction_taken : std_logic;
+	signal ras_top : std_logic_vector(31 downto 0);
+	signal ras_push, ras_pop, ras_commit_push, ras_commit_pop, ras_restore : std_logic;
+	signal ras_push_address, ras_commit_push_address : std_logic_vector(31 downto 0);
+
+	-- Instruction available in the fetch stage, expanded if it is a compressed instruction:
+	signal fetch_data       : std_logic_vector(31 downto 0);
+	signal fetch_ready      : std_logic;
+	signal fetch_compressed : std_logic;
+begin
+
+	instruction_data <= fetch_data;
+	instruction_ready <= fetch_ready and (not stall);
+	instruction_compressed <= fetch_compressed;
 	instruction_address <= pc;
 
+	instruction_predicted_taken <= prediction_taken;
+	instruction_predicted_target <= prediction_target;
+
+	-- Returns are predicted using the return address stack, other branches using the BTB:
+	prediction_taken <= ras_prediction_taken or btb_prediction_taken;
+	prediction_target <= ras_top when ras_prediction_taken = '1' else btb_prediction_target;
+
 	imem_req <= not reset;
 
-	set_pc: process(clk)
+	compressed_disabled: if not C_EXTENSION
+	generate
+		imem_address <= pc when cancel_fetch = '1' and imem_ack = '0' else pc_next;
+
+		fetch_data <= imem_data_in;
+		fetch_ready <= imem_ack and (not cancel_fetch);
+		fetch_compressed <= '0';
+
+		set_pc: process(clk)
+		begin
+			if rising_edge(clk) then
+				if reset = '1' then
+					pc <= RESET_ADDRESS;
+					cancel_fetch <= '0';
+				else
+					if (exception = '1' or branch = '1' or decode_branch = '1') and imem_ack = '0' then
+						cancel_fetch <= '1';
+						pc <= pc_next;
+					elsif cancel_fetch = '1' and imem_ack = '1' then
+						-- The PC is updated in case it is changed in the same cycle:
+						cancel_fetch <= '0';
+						pc <= pc_next;
+					else
+						pc <= pc_next;
+					end if;
+				end if;
+			end if;
+		end process set_pc;
+
+		calc_next_pc: process(reset, stall, branch, exception, imem_ack, branch_target, evec, pc, cancel_fetch,
+			decode_branch, decode_branch_target, prediction_taken, prediction_target)
+		begin
+			if exception = '1' then
+				pc_next <= evec;
+			elsif branch = '1' then
+				pc_next <= branch_target;
+			elsif decode_branch = '1' then
+				pc_next <= decode_branch_target;
+			elsif imem_ack = '1' and stall = '0' and cancel_fetch = '0' then
+				if prediction_taken = '1' then
+					pc_next <= prediction_target;
+				else
+					pc_next <= std_logic_vector(unsigned(pc) + 4);
+				end if;
+			else
+				pc_next <= pc;
+			end if;
+		end process calc_next_pc;
+	end generate compressed_disabled;
+
+	-- With compressed instructions, instructions may start on any halfword boundary. Only whole
+	-- words are fetched from memory, and the memory word containing the PC is kept in a realignment
+	-- buffer when the next instruction starts in it, so that instructions spanning two words can be
+	-- put together and instructions in the buffer can be issued without waiting for memory. When the
+	-- buffer is valid, the memory word following the PC is fetched instead of the word containing
+	-- the PC.
+	compressed_enabled: if C_EXTENSION
+	generate
+		signal word_buffer, word_buffer_next : std_logic_vector(31 downto 0);
+		signal buffer_valid, buffer_valid_next : std_logic;
+		signal buffer_fill : std_logic;
+
+		signal fetch_word, fetch_word_next : std_logic_vector(31 downto 2);
+		signal fetch_instruction : std_logic_vector(31 downto 0);
+		signal expanded_instruction : std_logic_vector(31 downto 0);
+
+		-- Set when a predicted branch is taken from the buffer while the next word is being fetched:
+		signal prediction_redirect : std_logic;
+
+		-- Word being fetched when the fetch was cancelled:
+		signal cancelled_word : std_logic_vector(31 downto 2);
 	begin
-		if rising_edge(clk) then
-			if reset = '1' then
-				pc <= RESET_ADDRESS;
-				cancel_fetch <= '0';
+		fetch_word <= std_logic_vector(unsigned(pc(31 downto 2)) + 1) when buffer_valid = '1' else pc(31 downto 2);
+		fetch_word_next <= std_logic_vector(unsigned(pc_next(31 downto 2)) + 1) when buffer_valid_next = '1'
+			else pc_next(31 downto 2);
+
+		-- The address of a cancelled fetch is kept until it has been acknowledged:
+		imem_address <= cancelled_word & b"00" when cancel_fetch = '1' and imem_ack = '0'
+			else fetch_word_next & b"00";
+
+		fetch_data <= expanded_instruction when fetch_compressed = '1' else fetch_instruction;
+
+		prediction_redirect <= fetch_ready and prediction_taken and not stall;
+
+		realign: process(buffer_valid, word_buffer, pc, imem_data_in, imem_ack, cancel_fetch)
+		begin
+			buffer_fill <= '0';
+
+			if buffer_valid = '1' and pc(1) = '0' then
+				-- Instruction in the buffered word:
+				fetch_instruction <= word_buffer;
+				fetch_compressed <= to_std_logic(word_buffer(1 downto 0) /= b"11");
+				fetch_ready <= '1';
+			elsif buffer_valid = '1' and word_buffer(17 downto 16) /= b"11" then
+				-- Compressed instruction in the upper half of the buffered word:
+				fetch_instruction <= x"0000" & word_buffer(31 downto 16);
+				fetch_compressed <= '1';
+				fetch_ready <= '1';
+			elsif buffer_valid = '1' then
+				-- Instruction spanning the buffered word and the next memory word:
+				fetch_instruction <= imem_data_in(15 downto 0) & word_buffer(31 downto 16);
+				fetch_compressed <= '0';
+				fetch_ready <= imem_ack and not cancel_fetch;
+			elsif pc(1) = '0' then
+				fetch_instruction <= imem_data_in;
+				fetch_compressed <= to_std_logic(imem_data_in(1 downto 0) /= b"11");
+				fetch_ready <= imem_ack and not cancel_fetch;
 			else
-				if (exception = '1' or branch = '1') and imem_ack = '0' then
-					cancel_fetch <= '1';
-					pc <= pc_next;
-				elsif cancel_fetch = '1' and imem_ack = '1' then
+				-- Instruction starting in the upper half of the memory word, which must be
+				-- moved into the buffer first if it is not a compressed instruction:
+				fetch_instruction <= x"0000" & imem_data_in(31 downto 16);
+				fetch_compressed <= to_std_logic(imem_data_in(17 downto 16) /= b"11");
+				fetch_ready <= imem_ack and not cancel_fetch and to_std_logic(imem_data_in(17 downto 16) /= b"11");
+				buffer_fill <= imem_ack and not cancel_fetch and to_std_logic(imem_data_in(17 downto 16) = b"11");
+			end if;
+		end process realign;
+
+		expander: entity work.pp_expander
+			port map(
+				instruction_in => fetch_instruction(15 downto 0),
+				instruction_out => expanded_instruction
+			);
+
+		-- Instructions in the buffer can be issued while the next word is being fetched, so a predicted
+		-- branch taken from the buffer cancels the fetch in the same way as other changes of the PC:
+		set_pc: process(clk)
+		begin
+			if rising_edge(clk) then
+				if reset = '1' then
+					pc <= RESET_ADDRESS;
 					cancel_fetch <= '0';
+					buffer_valid <= '0';
 				else
-					pc <= pc_next;
+					if (exception = '1' or branch = '1' or decode_branch = '1' or prediction_redirect = '1')
+						and imem_ack = '0'
+					then
+						if cancel_fetch = '0' then
+							cancelled_word <= fetch_word;
+						end if;
+						cancel_fetch <= '1';
+						pc <= pc_next;
+						buffer_valid <= '0';
+					elsif cancel_fetch = '1' and imem_ack = '1' then
+						-- The PC is updated in case it is changed in the same cycle:
+						cancel_fetch <= '0';
+						pc <= pc_next;
+					else
+						pc <= pc_next;
+						buffer_valid <= buffer_valid_next;
+						word_buffer <= word_buffer_next;
+					end if;
 				end if;
 			end if;
-		end if;
-	end process set_pc;
+		end process set_pc;
 
-	calc_next_pc: process(reset, stall, branch, exception, imem_ack, branch_target, evec, pc, cancel_fetch)
-	begin
-		if exception = '1' then
-			pc_next <= evec;
-		elsif branch = '1' then
-			pc_next <= branch_target;
-		elsif imem_ack = '1' and stall = '0' and cancel_fetch = '0' then
-			pc_next <= std_logic_vector(unsigned(pc) + 4);
-		else
-			pc_next <= pc;
-		end if;
-	end process calc_next_pc;
+		calc_next_pc: process(stall, branch, exception, branch_target, evec, pc, decode_branch, decode_branch_target,
+			prediction_taken, prediction_target, fetch_ready, fetch_compressed, buffer_valid, buffer_fill,
+			word_buffer, imem_data_in, imem_ack, cancel_fetch)
+		begin
+			buffer_valid_next <= '0';
+			word_buffer_next <= imem_data_in;
+
+			if exception = '1' then
+				pc_next <= evec;
+			elsif branch = '1' then
+				pc_next <= branch_target;
+			elsif decode_branch = '1' then
+				pc_next <= decode_branch_target;
+			elsif fetch_ready = '1' and stall = '0' then
+				if prediction_taken = '1' then
+					pc_next <= prediction_target;
+				elsif fetch_compressed = '1' and pc(1) = '0' then
+					pc_next <= std_logic_vector(unsigned(pc) + 2);
+
+					-- The next instruction starts in the upper half of the same memory word:
+					buffer_valid_next <= '1';
+					if buffer_valid = '1' then
+						word_buffer_next <= word_buffer;
+					end if;
+				else
+					if fetch_compressed = '1' then
+						pc_next <= std_logic_vector(unsigned(pc) + 2);
+					else
+						pc_next <= std_logic_vector(unsigned(pc) + 4);
+					end if;
+
+					-- The next instruction is in the memory word following the buffered word, which
+					-- is kept if it arrives in this cycle so that it does not have to be fetched again:
+					buffer_valid_next <= buffer_valid and imem_ack and not cancel_fetch;
+				end if;
+			elsif buffer_fill = '1' then
+				pc_next <= pc;
+				buffer_valid_next <= '1';
+			else
+				pc_next <= pc;
+				buffer_valid_next <= buffer_valid;
+				word_buffer_next <= word_buffer;
+			end if;
+		end process calc_next_pc;
+	end generate compressed_enabled;
+
+	predictor_enabled: if BRANCH_PREDICTION
+	generate
+		predictor: entity work.pp_branch_predictor
+			generic map(
+				BTB_NUM_ENTRIES => BTB_NUM_ENTRIES,
+				BHT_NUM_ENTRIES => BHT_NUM_ENTRIES,
+				C_EXTENSION => C_EXTENSION
+			) port map(
+				clk => clk,
+				reset => reset,
+				lookup_address => pc,
+				prediction_taken => btb_prediction_taken,
+				prediction_target => btb_prediction_target,
+				update => predictor_update,
+				update_address => predictor_update_address,
+				update_branch => predictor_update_branch,
+				update_taken => predictor_update_taken,
+				update_target => predictor_update_target
+			);
+	end generate predictor_enabled;
+
+	predictor_disabled: if not BRANCH_PREDICTION
+	generate
+		btb_prediction_taken <= '0';
+		btb_prediction_target <= (others => '0');
+	end generate predictor_disabled;
+
+	return_address_stack_enabled: if RAS_DEPTH > 0
+	generate
+		-- Set when the current instruction is passed on to the decode stage:
+		instruction_accepted <= fetch_ready and not stall
+			and not branch and not exception and not decode_branch;
+
+		-- Calls and returns are detected using the link register hints in the specification:
+		detect_call_return: process(fetch_data)
+			variable rd, rs1 : register_address;
+		begin
+			rd := fetch_data(11 downto 7);
+			rs1 := fetch_data(19 downto 15);
+
+			if fetch_data(6 downto 0) = b"1101111" then -- jal
+				instruction_is_call <= to_std_logic(is_link_register(rd));
+				instruction_is_return <= '0';
+			elsif fetch_data(6 downto 0) = b"1100111" then -- jalr
+				instruction_is_call <= to_std_logic(is_link_register(rd));
+				instruction_is_return <= to_std_logic(is_link_register(rs1) and (not is_link_register(rd) or rd /= rs1));
+			else
+				instruction_is_call <= '0';
+				instruction_is_return <= '0';
+			end if;
+		end process detect_call_return;
+
+		ras_prediction_taken <= instruction_is_return;
+
+		ras_push <= instruction_is_call and instruction_accepted;
+		ras_pop <= instruction_is_return and instruction_accepted;
+		ras_push_address <= std_logic_vector(unsigned(pc) + 2) when fetch_compressed = '1'
+			else std_logic_vector(unsigned(pc) + 4);
+
+		ras_commit_push <= predictor_update_call and predictor_update;
+		ras_commit_pop <= predictor_update_return and predictor_update;
+		ras_commit_push_address <= std_logic_vector(unsigned(predictor_update_address) + 2) when predictor_update_compressed = '1'
+			else std_logic_vector(unsigned(predictor_update_address) + 4);
+
+		-- The stack is restored when the pipeline is flushed:
+		ras_restore <= branch or exception;
+
+		return_address_stack: entity work.pp_return_address_stack
+			generic map(
+				DEPTH => RAS_DEPTH
+			) port map(
+				clk => clk,
+				reset => reset,
+				push => ras_push,
+				pop => ras_pop,
+				push_address => ras_push_address,
+				top => ras_top,
+				checkpoint => instruction_ras_checkpoint,
+				commit_push => ras_commit_push,
+				commit_pop => ras_commit_pop,
+				commit_push_address => ras_commit_push_address,
+				restore => ras_restore,
+				restore_checkpoint => ras_restore_checkpoint,
+				restore_state => ras_restore_state
+			);
+	end generate return_address_stack_enabled;
+
+	return_address_stack_disabled: if RAS_DEPTH = 0
+	generate
+		ras_prediction_taken <= '0';
+		ras_top <= (others => '0');
+		instruction_ras_checkpoint <= (pointer => 0, top => (others => '0'));
+	end generate return_address_stack_disabled;
 
 end architecture behaviour;
@@ -0,0 +1,136 @@
+-- The Potato Processor - A simple processor for FPGAs
+-- (c) Kristian Klomsten Skordal 2014 - 2015 <kristian.skordal@wafflemail.net>
+-- Report bugs and issues on <https://github.com/skordal/potato/issues>
+
+library ieee;
+use ieee.std_logic_1164.all;
+
+use work.pp_types.all;
+
+--! @brief Instruction queue between the fetch and decode stages.
+--! @details
+--!	Buffers fetched instructions while the decode stage is stalled, so that
+--!	the fetch stage can keep fetching instructions while the back end of the
+--!	pipeline waits for memory or hazards. When the queue is empty, instructions
+--!	are passed directly from the fetch stage to the decode stage without adding
+--!	any latency. The queue is emptied when the pipeline is flushed.
+--!
+--!	Instructions in the queue have already updated the return address stack in
+--!	the fetch stage, so the state of the stack before each of them is kept. When
+--!	instructions are flushed from the queue, the stack is restored to the state
+--!	before the oldest of them.
+entity pp_fetch_queue is
+	generic(
+		DEPTH : positive := 4 --! Number of entries in the queue.
+	);
+	port(
+		clk   : in std_logic;
+		reset : in std_logic;
+
+		-- Empties the queue:
+		flush : in std_logic;
+
+		-- Instructions from the fetch stage:
+		fetch_data             : in  std_logic_vector(31 downto 0); --! Instruction word.
+		fetch_address          : in  std_logic_vector(31 downto 0); --! Instruction address.
+		fetch_compressed       : in  std_logic;                     --! Set if the instruction is compressed.
+		fetch_predicted_taken  : in  std_logic;                     --! Branch prediction for the instruction.
+		fetch_predicted_target : in  std_logic_vector(31 downto 0); --! Predicted branch target for the instruction.
+		fetch_ras_checkpoint   : in  ras_checkpoint;                --! Return address stack state before the instruction.
+		fetch_ready            : in  std_logic;                     --! Set when an instruction is available.
+		full                   : out std_logic;                     --! Set when no more instructions can be accepted.
+
+		-- Return address stack restore signals:
+		ras_restore       : out std_logic;      --! Set when instructions are flushed from the queue.
+		ras_restore_state : out ras_checkpoint; --! State of the stack before the oldest flushed instruction.
+
+		-- Instructions to the decode stage:
+		decode_data             : out std_logic_vector(31 downto 0);
+		decode_address          : out std_logic_vector(31 downto 0);
+		decode_compressed       : out std_logic;
+		decode_predicted_taken  : out std_logic;
+		decode_predicted_target : out std_logic_vector(31 downto 0);
+		decode_ready            : out std_logic; --! Set when an instruction is available for the decode stage.
+		decode_stall            : in  std_logic  --! Set when the decode stage cannot accept an instruction.
+	);
+end entity pp_fetch_queue;
+
+architecture behaviour of pp_fetch_queue is
+
+	type word_array is array(0 to DEPTH - 1) of std_logic_vector(31 downto 0);
+	type checkpoint_array is array(0 to DEPTH - 1) of ras_checkpoint;
+	subtype queue_index_type is natural range 0 to DEPTH - 1;
+
+	-- Queue entries:
+	signal data_queue, address_queue, target_queue : word_array;
+	signal compressed_queue, taken_queue : std_logic_vector(DEPTH - 1 downto 0);
+	signal checkpoint_queue : checkpoint_array;
+
+	signal head, tail : queue_index_type;
+	signal count : natural range 0 to DEPTH;
+
+	signal push, pop, empty : std_logic;
+begin
+
+	empty <= '1' when count = 0 else '0';
+
+	-- The oldest instruction in the queue is passed on first, if the queue is empty, the
+	-- instruction from the fetch stage is passed on directly:
+	decode_data <= data_queue(head) when empty = '0' else fetch_data;
+	decode_address <= address_queue(head) when empty = '0' else fetch_address;
+	decode_compressed <= compressed_queue(head) when empty = '0' else fetch_compressed;
+	decode_predicted_taken <= taken_queue(head) when empty = '0' else fetch_predicted_taken;
+	decode_predicted_target <= target_queue(head) when empty = '0' else fetch_predicted_target;
+	decode_ready <= not empty or fetch_ready;
+
+	ras_restore <= flush and not empty;
+	ras_restore_state <= checkpoint_queue(head);
+
+	-- An instruction is removed from the queue when it is accepted by the decode stage:
+	pop <= not empty and not decode_stall and not flush;
+
+	-- Instructions are put into the queue unless they can be passed on directly:
+	push <= fetch_ready and not flush and not (empty and not decode_stall);
+	full <= '1' when count = DEPTH and pop = '0' else '0';
+
+	update_queue: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' or flush = '1' then
+				head <= 0;
+				tail <= 0;
+				count <= 0;
+			else
+				if push = '1' then
+					data_queue(tail) <= fetch_data;
+					address_queue(tail) <= fetch_address;
+					compressed_queue(tail) <= fetch_compressed;
+					taken_queue(tail) <= fetch_predicted_taken;
+					target_queue(tail) <= fetch_predicted_target;
+					checkpoint_queue(tail) <= fetch_ras_checkpoint;
+
+					if tail = DEPTH - 1 then
+						tail <= 0;
+					else
+						tail <= tail + 1;
+					end if;
+				end if;
+
+				if pop = '1' then
+					if head = DEPTH - 1 then
+						head <= 0;
+					else
+						head <= head + 1;
+					end if;
+				end if;
+
+				if push = '1' and pop = '0' then
+					count <= count + 1;
+				elsif push = '0' and pop = '1' then
+					count <= count - 1;
+				end if;
+			end if;
+		end if;
+	end process update_queue;
+
+end architecture behaviour;
@@ -7,13 +7,36 @@ use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
 use work.pp_types.all;
+use work.pp_constants.all;
 use work.pp_utilities.all;
 
---! @brief Simple read-only direct-mapped instruction cache.
+--! @brief Simple read-only set-associative instruction cache.
+--! @details
+--!	The cache lines are divided into sets of WAYS lines each, with a direct-mapped
+--!	cache being the special case of one way. The tags of all ways in a set are
+--!	compared in parallel, and lines are replaced using tree pseudo-LRU replacement.
+--!	On a miss, the line is loaded starting with the requested word and wrapping
+--!	around to the start of the line. Words are forwarded to the processor as soon
+--!	as they have been loaded, while the rest of the line is being filled.
+--!	If prefetching is enabled, the line following a missed line, or following a
+--!	prefetched line when it is first used, is loaded into a prefetch buffer while
+--!	the cache is otherwise idle, unless the tags show that the line is already in
+--!	the cache. The prefetched line is moved into the cache when it is fetched
+--!	from. A prefetch is abandoned if the processor misses on another
+--!	line, and yields the bus between words when the data memory interface needs it.
+--!	If bursts are enabled, lines of 4, 8 or 16 words are loaded using Wishbone
+--!	incrementing wrap bursts, so that a word can be transferred in every cycle.
+--!	Cache lines can be invalidated all at once or for a range of addresses, in a
+--!	single cycle, by clearing the valid bits of all sets that the range maps to.
+--!	Lines being loaded or prefetched when an invalidation is requested are not
+--!	kept in the cache.
 entity pp_icache is
 	generic(
 		LINE_SIZE    : natural := 4;   --! Number of words per cache line
-		NUM_LINES    : natural := 128  --! Number of lines in the cache
+		NUM_LINES    : natural := 128; --! Number of lines in the cache
+		WAYS         : natural := 1;   --! Number of lines in each set, 1, 2 or 4
+		PREFETCH     : boolean := false; --! Whether to prefetch the next cache line
+		BURSTS       : boolean := false  --! Whether to load cache lines using incrementing bursts
 	);
 	port(
 		clk   : in std_logic;
@@ -25,6 +48,23 @@ entity pp_icache is
 		mem_read_req     : in  std_logic;
 		mem_read_ack     : out std_logic;
 
+		-- Performance events:
+		hit_out  : out std_logic; --! Set for one cycle when an instruction fetch hits in the cache.
+		miss_out : out std_logic; --! Set for one cycle when an instruction fetch misses in the cache.
+		prefetch_useful_out  : out std_logic; --! Set for one cycle when a prefetched line is used.
+		prefetch_useless_out : out std_logic; --! Set for one cycle when a prefetched line is discarded without being used.
+
+		-- Prefetch control signals:
+		prefetch_yield : in  std_logic; --! Set when another bus master is waiting for the bus.
+		prefetching    : out std_logic; --! Set while a line is being prefetched.
+
+		-- Invalidation signals, the range from the start address up to, but not including,
+		-- the end address is invalidated when invalidate_range is set:
+		invalidate       : in std_logic; --! Invalidates all cache lines.
+		invalidate_range : in std_logic; --! Invalidates the cache lines in a range of addresses.
+		invalidate_start : in std_logic_vector(31 downto 0);
+		invalidate_end   : in std_logic_vector(31 downto 0);
+
 		-- Wishbone interface:
 		wb_inputs  : in wishbone_master_inputs;
 		wb_outputs : out wishbone_master_outputs
@@ -33,26 +73,41 @@ end entity pp_icache;
 
 architecture behaviour of pp_icache is
 
+	-- Number of sets in the cache:
+	constant NUM_SETS : natural := NUM_LINES / WAYS;
+
+	-- Bursts wrap around at the end of the cache line, which requires a line size supported by wrap bursts:
+	constant BURST_BTE  : std_logic_vector(1 downto 0) := wb_get_burst_bte(LINE_SIZE);
+	constant USE_BURSTS : boolean := BURSTS and BURST_BTE /= WB_BTE_LINEAR;
+
 	-- Counter types:
-	subtype line_counter_type is natural range 0 to NUM_LINES;
+	subtype line_counter_type is natural range 0 to NUM_SETS;
 	subtype word_counter_type is natural range 0 to LINE_SIZE; 
+	subtype way_index_type is natural range 0 to WAYS - 1;
 
 	-- Cache line types:
 	subtype cache_line_type is std_logic_vector((LINE_SIZE * 32) - 1 downto 0);
 	type cache_line_word_array is array(0 to LINE_SIZE - 1) of std_logic_vector(31 downto 0); 
-	type cache_line_array is array(0 to NUM_LINES - 1) of cache_line_type;
+	type cache_line_array is array(0 to NUM_SETS - 1) of cache_line_type;
 
 	-- Cache tag type:
-	subtype cache_tag_type is std_logic_vector(31 - log2(LINE_SIZE * 4) - log2(NUM_LINES) downto 0);
-	type cache_tag_array is array(0 to NUM_LINES - 1) of cache_tag_type;
+	subtype cache_tag_type is std_logic_vector(31 - log2(LINE_SIZE * 4) - log2(NUM_SETS) downto 0);
+	type cache_tag_array is array(0 to NUM_SETS - 1) of cache_tag_type;
 
-	-- Cache memories:
-	signal cache_memory : cache_line_array;
-	signal tag_memory   : cache_tag_array;
-	signal valid        : std_logic_vector(NUM_LINES - 1 downto 0) := (others => '0');
+	-- Per-way types:
+	type way_line_array is array(0 to WAYS - 1) of cache_line_type;
+	type way_valid_array is array(0 to WAYS - 1) of std_logic_vector(NUM_SETS - 1 downto 0);
+
+	-- Pseudo-LRU replacement state, a binary tree with one bit for each node pointing
+	-- towards the least recently used half of its subtree:
+	subtype plru_tree_type is std_logic_vector(WAYS - 1 downto 1);
+	type plru_tree_array is array(0 to NUM_SETS - 1) of plru_tree_type;
+
+	-- Cache memories, the line and tag memories of each way are declared in the cache_ways generate:
+	signal valid : way_valid_array := (others => (others => '0'));
+	signal plru  : plru_tree_array := (others => (others => '0'));
 
 	attribute ram_style : string;
-	attribute ram_style of cache_memory: signal is "block";
 
 	-- Cache controller signals:
 	type state_type is (IDLE, CACHE_READ_STALL,
@@ -60,98 +115,350 @@ architecture behaviour of pp_icache is
 	signal state : state_type := IDLE;
 
 	-- Input address components:
-	signal input_address_line : std_logic_vector(log2(NUM_LINES) - 1 downto 0);
+	signal input_address_line : std_logic_vector(log2(NUM_SETS) - 1 downto 0);
 	signal input_address_word : std_logic_vector(log2(LINE_SIZE) - 1 downto 0);
 	signal input_address_tag  : cache_tag_type;
 
-	-- Cacheline matching the current input address:
-	signal current_cache_line, cache_lookup : cache_line_type;
-	signal current_cache_line_words         : cache_line_word_array;
+	-- Set of the previous input address, used when updating the replacement state:
+	signal lookup_line : line_counter_type;
+
+	-- Cachelines matching the current input address:
+	signal way_lookup : way_line_array;
+	signal way_hit    : std_logic_vector(WAYS - 1 downto 0);
+	signal hit_way    : way_index_type;
+	signal current_cache_line       : cache_line_type;
+	signal current_cache_line_words : cache_line_word_array;
 
 	-- Base address to load a cacheline from:
 	signal cl_load_address  : std_logic_vector(31 downto log2(LINE_SIZE * 4));
-	-- Cache line to load:
+	-- Set and way to load the cache line into:
 	signal cl_current_line : line_counter_type;
-	-- Current word being loaded:
+	signal cl_current_way  : way_index_type;
+	-- Current word being loaded and number of words loaded:
 	signal cl_current_word  : word_counter_type;
+	signal cl_load_count    : word_counter_type;
 
 	-- Buffer for holding a cache line while loading:
 	signal load_buffer     : cache_line_type;
 	signal load_buffer_tag : cache_tag_type;
+	signal loaded_words    : std_logic_vector(LINE_SIZE - 1 downto 0);
+	signal load_buffer_words : cache_line_word_array;
+
+	-- Prefetcher signals:
+	type prefetch_state_type is (PF_IDLE, PF_START, PF_WAIT_ACK);
+	signal pf_state : prefetch_state_type := PF_IDLE;
+	signal pf_request      : std_logic; -- Set when a line should be prefetched
+	signal pf_next_address : std_logic_vector(31 downto log2(LINE_SIZE * 4));
+	signal pf_address      : std_logic_vector(31 downto log2(LINE_SIZE * 4));
+	signal pf_current_word : word_counter_type;
+	signal pf_buffer       : cache_line_type;
+	signal pf_buffer_words : cache_line_word_array;
+	signal pf_valid        : std_logic; -- Set when the prefetch buffer contains a complete line
+	signal pf_discard      : std_logic; -- Set when the line being prefetched has been invalidated
+	signal pf_checked      : std_logic; -- Set when the tags have been looked up for the line to prefetch
+	signal pf_way_hit      : std_logic_vector(WAYS - 1 downto 0);
+	signal pf_next_line    : line_counter_type;
+	signal pf_next_tag     : cache_tag_type;
+
+	-- Sets invalidated in the current cycle:
+	signal invalidate_mask : std_logic_vector(NUM_SETS - 1 downto 0);
+	-- Set when the line being loaded has been invalidated:
+	signal cl_discard : std_logic;
 
 	-- Causes a cache line to be stored in the cache memory:
 	signal store_cache_line : std_logic;
 
 	-- Set when the current input address matches a cache line:
 	signal cache_hit : std_logic;
+	signal read_ack  : std_logic;
+	-- Set when the previous input address matches a word that has been loaded into the load buffer:
+	signal fill_hit  : std_logic;
+	-- Set when the previous input address matches the line in the prefetch buffer:
+	signal pf_hit    : std_logic;
+
+	-- Previous acknowledged fetch, used to count each fetch only once when the processor is stalled:
+	signal previous_ack     : std_logic;
+	signal previous_address : std_logic_vector(31 downto 0);
+
+	--! Updates the replacement state of a set so that the accessed way becomes the most recently used.
+	function plru_access(tree : in plru_tree_type; way : in way_index_type) return plru_tree_type is
+		variable retval   : plru_tree_type := tree;
+		variable way_bits : unsigned(log2(WAYS) - 1 downto 0) := to_unsigned(way, log2(WAYS));
+		variable node     : natural := 1;
+	begin
+		for level in log2(WAYS) - 1 downto 0 loop
+			retval(node) := not way_bits(level);
+			if way_bits(level) = '1' then
+				node := 2 * node + 1;
+			else
+				node := 2 * node;
+			end if;
+		end loop;
+		return retval;
+	end function plru_access;
+
+	--! Gets the cycle type identifier for a transfer when loading a cache line.
+	function burst_cti(last : in boolean) return std_logic_vector is
+	begin
+		if not USE_BURSTS then
+			return WB_CTI_CLASSIC;
+		elsif last then
+			return WB_CTI_END;
+		else
+			return WB_CTI_INCREMENT;
+		end if;
+	end function burst_cti;
+
+	--! Finds the least recently used way in a set by following the replacement state tree.
+	function plru_victim(tree : in plru_tree_type) return way_index_type is
+		variable node : natural := 1;
+	begin
+		for level in 0 to log2(WAYS) - 1 loop
+			if tree(node) = '1' then
+				node := 2 * node + 1;
+			else
+				node := 2 * node;
+			end if;
+		end loop;
+		return node - WAYS;
+	end function plru_victim;
 
 begin
 
 	assert is_pow2(LINE_SIZE) report "Cache line size must be a power of 2!" severity FAILURE;
 	assert is_pow2(NUM_LINES) report "Number of cache lines must be a power of 2!" severity FAILURE;
+	assert WAYS = 1 or WAYS = 2 or WAYS = 4 report "Number of cache ways must be 1, 2 or 4!" severity FAILURE;
+
+	mem_data_out <= load_buffer_words(to_integer(unsigned(input_address_word))) when fill_hit = '1'
+		else pf_buffer_words(to_integer(unsigned(input_address_word))) when pf_hit = '1'
+		else current_cache_line_words(to_integer(unsigned(input_address_word)));
+	mem_read_ack <= read_ack;
+	read_ack <= mem_read_req and (fill_hit or pf_hit or (cache_hit and to_std_logic(state = IDLE or state = CACHE_READ_STALL)));
+
+	prefetching <= '1' when pf_state /= PF_IDLE else '0';
+
+	hit_out <= read_ack and not (previous_ack and to_std_logic(previous_address = mem_address_in))
+		when state = IDLE else '0';
+
+	input_address_line <= mem_address_in(log2(LINE_SIZE * 4) + log2(NUM_SETS) - 1 downto log2(LINE_SIZE * 4));
+	input_address_tag  <= mem_address_in(31 downto log2(LINE_SIZE * 4) + log2(NUM_SETS));
+
+	pf_next_line <= to_integer(unsigned(pf_next_address(log2(LINE_SIZE * 4) + log2(NUM_SETS) - 1 downto log2(LINE_SIZE * 4))));
+	pf_next_tag <= pf_next_address(31 downto log2(LINE_SIZE * 4) + log2(NUM_SETS));
 
-	mem_data_out <= current_cache_line_words(to_integer(unsigned(input_address_word)));
-	mem_read_ack <= (cache_hit and mem_read_req) when state = IDLE or state = CACHE_READ_STALL else '0';
+	-- The tags of all ways are compared when the lines are read, so that only the
+	-- line of the matching way has to be selected in the cycle of the hit:
+	cache_hit <= '1' when way_hit /= (way_hit'range => '0') else '0';
+	current_cache_line <= way_lookup(hit_way);
 
-	input_address_line <= mem_address_in(log2(LINE_SIZE * 4) + log2(NUM_LINES) - 1 downto log2(LINE_SIZE * 4));
-	input_address_tag  <= mem_address_in(31 downto log2(LINE_SIZE * 4) + log2(NUM_LINES));
+	find_hit_way: process(way_hit)
+	begin
+		hit_way <= 0;
+		for way in 0 to WAYS - 1 loop
+			if way_hit(way) = '1' then
+				hit_way <= way;
+			end if;
+		end loop;
+	end process find_hit_way;
 
 	decompose_cache_line: for i in 0 to LINE_SIZE - 1 generate
 		current_cache_line_words(i) <= current_cache_line(32 * i + 31 downto 32 * i);
+		load_buffer_words(i) <= load_buffer(32 * i + 31 downto 32 * i);
+		pf_buffer_words(i) <= pf_buffer(32 * i + 31 downto 32 * i);
 	end generate decompose_cache_line;
 
 	find_indices: process(clk)
 	begin
 		if rising_edge(clk) then
 			input_address_word <= mem_address_in(log2(LINE_SIZE * 4) - 1 downto 2);
+			lookup_line <= to_integer(unsigned(input_address_line));
+			previous_ack <= read_ack;
+			previous_address <= mem_address_in;
 		end if;
 	end process find_indices;
 
-	cacheline_lookup: process(clk)
+	-- Finds the sets that the lines in the invalidated range map to. If the range covers all sets,
+	-- the whole cache is invalidated:
+	find_invalidated_sets: process(invalidate, invalidate_range, invalidate_start, invalidate_end)
+		variable last_address : unsigned(31 downto 0);
+		variable first_line, last_line : unsigned(31 - log2(LINE_SIZE * 4) downto 0);
+		variable first_set, line_count : natural;
 	begin
-		if rising_edge(clk) then
-			if store_cache_line = '1' then
-				cache_memory(cl_current_line) <= load_buffer;
-			end if;
+		invalidate_mask <= (others => '0');
+
+		if invalidate = '1' then
+			invalidate_mask <= (others => '1');
+		elsif invalidate_range = '1' and unsigned(invalidate_end) > unsigned(invalidate_start) then
+			last_address := unsigned(invalidate_end) - 1;
+			first_line := unsigned(invalidate_start(31 downto log2(LINE_SIZE * 4)));
+			last_line := last_address(31 downto log2(LINE_SIZE * 4));
 
-			current_cache_line <= cache_memory(to_integer(unsigned(input_address_line)));
+			if last_line - first_line >= NUM_SETS - 1 then
+				invalidate_mask <= (others => '1');
+			else
+				first_set := to_integer(first_line mod NUM_SETS);
+				line_count := to_integer(last_line - first_line);
+				for i in 0 to NUM_SETS - 1 loop
+					if (i - first_set) mod NUM_SETS <= line_count then
+						invalidate_mask(i) <= '1';
+					end if;
+				end loop;
+			end if;
 		end if;
-	end process cacheline_lookup;
+	end process find_invalidated_sets;
 
-	tag_lookup: process(clk)
+	cache_ways: for way in 0 to WAYS - 1 generate
+		signal cache_memory : cache_line_array;
+		signal tag_memory   : cache_tag_array;
+		attribute ram_style of cache_memory: signal is "block";
 	begin
-		if rising_edge(clk) then
-			if store_cache_line = '1' then
-				tag_memory(cl_current_line) <= load_buffer_tag;
+
+		cacheline_lookup: process(clk)
+		begin
+			if rising_edge(clk) then
+				if store_cache_line = '1' and cl_current_way = way then
+					cache_memory(cl_current_line) <= load_buffer;
+				end if;
+
+				way_lookup(way) <= cache_memory(to_integer(unsigned(input_address_line)));
 			end if;
+		end process cacheline_lookup;
 
-			cache_hit <= valid(to_integer(unsigned(input_address_line)))
-				and to_std_logic(tag_memory(to_integer(unsigned(input_address_line))) = input_address_tag);
-		end if;
-	end process tag_lookup;
+		tag_lookup: process(clk)
+		begin
+			if rising_edge(clk) then
+				if store_cache_line = '1' and cl_current_way = way then
+					tag_memory(cl_current_line) <= load_buffer_tag;
+				end if;
+
+				way_hit(way) <= valid(way)(to_integer(unsigned(input_address_line)))
+					and not invalidate_mask(to_integer(unsigned(input_address_line)))
+					and to_std_logic(tag_memory(to_integer(unsigned(input_address_line))) = input_address_tag);
+
+				-- The line to prefetch is looked up in the cycle after it is requested:
+				pf_way_hit(way) <= valid(way)(pf_next_line) and to_std_logic(tag_memory(pf_next_line) = pf_next_tag);
+			end if;
+		end process tag_lookup;
+
+	end generate cache_ways;
 
 	controller: process(clk)
+		variable victim  : way_index_type;
+		variable pf_line : line_counter_type;
+		variable miss    : boolean;
 	begin
 		if rising_edge(clk) then
 			if reset = '1' then
 				state <= IDLE;
 				wb_outputs.cyc <= '0';
 				wb_outputs.stb <= '0';
+				wb_outputs.cti <= WB_CTI_CLASSIC;
+				wb_outputs.bte <= BURST_BTE;
 				store_cache_line <= '0';
-				valid <= (others => '0');
+				miss_out <= '0';
+				fill_hit <= '0';
+				cl_discard <= '0';
+				pf_state <= PF_IDLE;
+				pf_request <= '0';
+				pf_checked <= '0';
+				pf_valid <= '0';
+				pf_discard <= '0';
+				pf_hit <= '0';
+				prefetch_useful_out <= '0';
+				prefetch_useless_out <= '0';
+				valid <= (others => (others => '0'));
+				plru <= (others => (others => '0'));
 			else
+				miss_out <= '0';
+				prefetch_useful_out <= '0';
+				prefetch_useless_out <= '0';
+				pf_checked <= pf_request;
+
+				-- Set when the processor is waiting for a line that is neither in the cache nor being loaded:
+				miss := state = IDLE and mem_read_req = '1' and cache_hit = '0' and fill_hit = '0' and pf_hit = '0';
+
+				-- Fetches from the line being loaded are answered from the load buffer in the next cycle,
+				-- like fetches from the cache memory, as soon as the requested word has been loaded:
+				if state /= IDLE and mem_address_in(31 downto log2(LINE_SIZE * 4)) = cl_load_address
+					and (loaded_words(to_integer(unsigned(mem_address_in(log2(LINE_SIZE * 4) - 1 downto 2)))) = '1'
+						or (state = LOAD_CACHELINE_WAIT_ACK and wb_inputs.ack = '1'
+							and cl_current_word = to_integer(unsigned(mem_address_in(log2(LINE_SIZE * 4) - 1 downto 2)))))
+				then
+					fill_hit <= '1';
+				else
+					fill_hit <= '0';
+				end if;
+
+				if mem_address_in(31 downto log2(LINE_SIZE * 4)) = pf_address
+					and (pf_valid = '1' or (pf_state = PF_WAIT_ACK and wb_inputs.ack = '1' and natural(pf_current_word) = LINE_SIZE - 1))
+				then
+					pf_hit <= '1';
+				else
+					pf_hit <= '0';
+				end if;
+
+				if read_ack = '1' and cache_hit = '1' and fill_hit = '0' and pf_hit = '0' then
+					plru(lookup_line) <= plru_access(plru(lookup_line), hit_way);
+				end if;
+
 				case state is
 					when IDLE =>
-						if mem_read_req = '1' and cache_hit = '0' then
-							wb_outputs.adr <= mem_address_in(31 downto log2(LINE_SIZE * 4)) & (log2(LINE_SIZE * 4) - 1 downto 0 => '0');
+						if mem_read_req = '1' and cache_hit = '0' and fill_hit = '0' and pf_hit = '1' then
+							-- Move the prefetched line into the cache through the load buffer:
+							pf_line := to_integer(unsigned(pf_address(log2(LINE_SIZE * 4) + log2(NUM_SETS) - 1 downto log2(LINE_SIZE * 4))));
+							victim := plru_victim(plru(pf_line));
+							for way in WAYS - 1 downto 0 loop
+								if valid(way)(pf_line) = '0' then
+									victim := way;
+								end if;
+							end loop;
+							cl_current_way <= victim;
+							cl_current_line <= pf_line;
+							cl_load_address <= pf_address;
+							load_buffer <= pf_buffer;
+							load_buffer_tag <= pf_address(31 downto log2(LINE_SIZE * 4) + log2(NUM_SETS));
+							loaded_words <= (others => '1');
+							cl_discard <= '0';
+							store_cache_line <= '1';
+							pf_valid <= '0';
+							prefetch_useful_out <= '1';
+
+							pf_request <= '1';
+							pf_checked <= '0';
+							pf_next_address <= std_logic_vector(unsigned(pf_address) + 1);
+							state <= LOAD_CACHELINE_FINISH;
+						elsif miss and pf_state /= PF_IDLE then
+							-- Wait for the prefetch to finish or to be abandoned.
+							null;
+						elsif miss then
+							-- Replace an invalid line if the set has one, otherwise the least recently used line:
+							victim := plru_victim(plru(to_integer(unsigned(input_address_line))));
+							for way in WAYS - 1 downto 0 loop
+								if valid(way)(to_integer(unsigned(input_address_line))) = '0' then
+									victim := way;
+								end if;
+							end loop;
+							cl_current_way <= victim;
+							miss_out <= '1';
+
+							-- The requested word is loaded first:
 							wb_outputs.cyc <= '1';
 							wb_outputs.we <= '0';
 							wb_outputs.sel <= (others => '1');
 							load_buffer_tag <= input_address_tag;
+							loaded_words <= (others => '0');
 							cl_load_address <= mem_address_in(31 downto log2(LINE_SIZE * 4));
 							cl_current_line <= to_integer(unsigned(input_address_line));
-							cl_current_word <= 0;
+							cl_current_word <= to_integer(unsigned(mem_address_in(log2(LINE_SIZE * 4) - 1 downto 2)));
+							cl_load_count <= 0;
+							cl_discard <= '0';
 							state <= LOAD_CACHELINE_START;
+
+							if PREFETCH then
+								pf_request <= '1';
+								pf_checked <= '0';
+								pf_next_address <= std_logic_vector(unsigned(mem_address_in(31 downto log2(LINE_SIZE * 4))) + 1);
+							end if;
 						end if;
 					when CACHE_READ_STALL =>
 						state <= IDLE;
@@ -159,25 +466,137 @@ begin
 						wb_outputs.stb <= '1';
 						wb_outputs.we <= '0';
 						wb_outputs.adr <= cl_load_address & std_logic_vector(to_unsigned(cl_current_word, log2(LINE_SIZE))) & b"00";
+						wb_outputs.cti <= burst_cti(natural(cl_load_count) = LINE_SIZE - 1);
 						state <= LOAD_CACHELINE_WAIT_ACK;
 					when LOAD_CACHELINE_WAIT_ACK =>
 						if wb_inputs.ack = '1' then
 							wb_outputs.stb <= '0';
 							load_buffer(cl_current_word * 32 + 31 downto cl_current_word * 32) <= wb_inputs.dat;
-							if natural(cl_current_word) = LINE_SIZE - 1 then
+							loaded_words(cl_current_word) <= '1';
+							if natural(cl_load_count) = LINE_SIZE - 1 then
 								wb_outputs.cyc <= '0';
+								wb_outputs.cti <= WB_CTI_CLASSIC;
 								store_cache_line <= '1';
 								state <= LOAD_CACHELINE_FINISH;
 							else
-								cl_current_word <= cl_current_word + 1;
-								state <= LOAD_CACHELINE_START;
+								-- Continue with the next word, wrapping around to the start of the line:
+								if natural(cl_current_word) = LINE_SIZE - 1 then
+									cl_current_word <= 0;
+								else
+									cl_current_word <= cl_current_word + 1;
+								end if;
+								cl_load_count <= cl_load_count + 1;
+
+								-- During a burst, the next address is presented together with the acknowledged data:
+								if USE_BURSTS then
+									wb_outputs.stb <= '1';
+									wb_outputs.adr <= wb_get_burst_next_address(cl_load_address
+										& std_logic_vector(to_unsigned(cl_current_word, log2(LINE_SIZE))) & b"00", BURST_BTE);
+									wb_outputs.cti <= burst_cti(natural(cl_load_count) + 1 = LINE_SIZE - 1);
+								else
+									state <= LOAD_CACHELINE_START;
+								end if;
 							end if;
 						end if;
 					when LOAD_CACHELINE_FINISH =>
 						store_cache_line <= '0';
-						valid(cl_current_line) <= '1';
+						valid(cl_current_way)(cl_current_line) <= not cl_discard;
+						plru(cl_current_line) <= plru_access(plru(cl_current_line), cl_current_way);
 						state <= CACHE_READ_STALL;
 				end case;
+
+				-- The prefetcher uses the bus when the cache is not loading a line, and is abandoned when the
+				-- processor misses on a line other than the one being prefetched:
+				case pf_state is
+					when PF_IDLE =>
+						if PREFETCH and pf_request = '1' and pf_checked = '1' and pf_way_hit /= (pf_way_hit'range => '0') then
+							-- The line is already in the cache:
+							pf_request <= '0';
+						elsif PREFETCH and pf_request = '1' and pf_checked = '1' and state = IDLE
+							and not (mem_read_req = '1' and cache_hit = '0' and fill_hit = '0')
+						then
+							if pf_valid = '1' then
+								prefetch_useless_out <= '1';
+							end if;
+
+							wb_outputs.cyc <= '1';
+							wb_outputs.stb <= '1';
+							wb_outputs.we <= '0';
+							wb_outputs.sel <= (others => '1');
+							wb_outputs.adr <= pf_next_address & (log2(LINE_SIZE * 4) - 1 downto 0 => '0');
+							wb_outputs.cti <= burst_cti(false);
+							pf_address <= pf_next_address;
+							pf_current_word <= 0;
+							pf_discard <= '0';
+							pf_request <= '0';
+							pf_valid <= '0';
+							pf_hit <= '0';
+							pf_state <= PF_WAIT_ACK;
+						end if;
+					when PF_START =>
+						if miss and mem_address_in(31 downto log2(LINE_SIZE * 4)) /= pf_address then
+							wb_outputs.cyc <= '0';
+							prefetch_useless_out <= '1';
+							pf_state <= PF_IDLE;
+						else
+							wb_outputs.cyc <= '1';
+							wb_outputs.stb <= '1';
+							wb_outputs.adr <= pf_address & std_logic_vector(to_unsigned(pf_current_word, log2(LINE_SIZE))) & b"00";
+							wb_outputs.cti <= burst_cti(natural(pf_current_word) = LINE_SIZE - 1);
+							pf_state <= PF_WAIT_ACK;
+						end if;
+					when PF_WAIT_ACK =>
+						if wb_inputs.ack = '1' then
+							wb_outputs.stb <= '0';
+							pf_buffer(pf_current_word * 32 + 31 downto pf_current_word * 32) <= wb_inputs.dat;
+							if natural(pf_current_word) = LINE_SIZE - 1 then
+								wb_outputs.cyc <= '0';
+								wb_outputs.cti <= WB_CTI_CLASSIC;
+								pf_valid <= not pf_discard;
+								pf_state <= PF_IDLE;
+							elsif miss and mem_address_in(31 downto log2(LINE_SIZE * 4)) /= pf_address then
+								wb_outputs.cyc <= '0';
+								wb_outputs.cti <= WB_CTI_CLASSIC;
+								prefetch_useless_out <= '1';
+								pf_state <= PF_IDLE;
+							else
+								pf_current_word <= pf_current_word + 1;
+
+								-- Release the bus between words if another master is waiting for it, this also ends a burst:
+								if prefetch_yield = '1' then
+									wb_outputs.cyc <= '0';
+									wb_outputs.cti <= WB_CTI_CLASSIC;
+									pf_state <= PF_START;
+								elsif USE_BURSTS then
+									wb_outputs.stb <= '1';
+									wb_outputs.adr <= wb_get_burst_next_address(pf_address
+										& std_logic_vector(to_unsigned(pf_current_word, log2(LINE_SIZE))) & b"00", BURST_BTE);
+									wb_outputs.cti <= burst_cti(natural(pf_current_word) + 1 = LINE_SIZE - 1);
+								else
+									pf_state <= PF_START;
+								end if;
+							end if;
+						end if;
+				end case;
+
+				-- Lines being loaded or prefetched may contain invalidated instructions and are discarded, so
+				-- that these instructions are fetched from memory again when they are next executed:
+				if invalidate = '1' or invalidate_range = '1' then
+					fill_hit <= '0';
+					pf_hit <= '0';
+					loaded_words <= (others => '0');
+					cl_discard <= '1';
+					pf_valid <= '0';
+					pf_discard <= '1';
+				end if;
+
+				for set in 0 to NUM_SETS - 1 loop
+					if invalidate_mask(set) = '1' then
+						for way in 0 to WAYS - 1 loop
+							valid(way)(set) <= '0';
+						end loop;
+					end if;
+				end loop;
 			end if;
 		end if;
 	end process controller;
@@ -0,0 +1,187 @@
+-- The Potato Processor - A simple processor for FPGAs
+-- (c) Kristian Klomsten Skordal 2014 - 2015 <kristian.skordal@wafflemail.net>
+-- Report bugs and issues on <https://github.com/skordal/potato/issues>
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.pp_types.all;
+use work.pp_utilities.all;
+
+--! @brief Queue of outstanding data memory accesses, allowing loads to complete out of the pipeline.
+--! @details
+--!	Data memory accesses from the execute stage are placed in the queue and
+--!	sent to the data memory interface one at a time, in order. Loads leave the
+--!	pipeline as soon as they are queued, and their results are written to the
+--!	register file when the writeback stage is not using the write port. A
+--!	scoreboard keeps track of registers waiting for the results of loads, so
+--!	that only the instructions using these registers have to wait. Stores are
+--!	acknowledged when they have been written to memory.
+entity pp_load_queue is
+	generic(
+		DEPTH : positive := 4 --! Number of data memory accesses that can be outstanding.
+	);
+	port(
+		clk   : in std_logic;
+		reset : in std_logic;
+
+		-- Accesses from the execute stage:
+		req_address   : in  std_logic_vector(31 downto 0);
+		req_data      : in  std_logic_vector(31 downto 0);
+		req_data_size : in  std_logic_vector( 1 downto 0);
+		req_read      : in  std_logic;
+		req_write     : in  std_logic;
+		req_rd_addr   : in  register_address;       --! Destination register of a load.
+		req_mem_op    : in  memory_operation_type;  --! Type of a load, used to extend the loaded data.
+		req_mem_size  : in  memory_operation_size;  --! Size of a load, used to extend the loaded data.
+		write_ack     : out std_logic;              --! Set when a store has been written to memory.
+		full          : out std_logic;              --! Set when no more accesses can be accepted.
+		empty         : out std_logic;              --! Set when no accesses are outstanding.
+
+		-- Registers waiting for the results of loads:
+		pending : out std_logic_vector(31 downto 0);
+
+		-- Register file write port:
+		rd_port_free : in  std_logic; --! Set when the writeback stage is not writing to the register file.
+		rd_addr      : out register_address;
+		rd_data      : out std_logic_vector(31 downto 0);
+		rd_write     : out std_logic;
+
+		-- Data memory interface:
+		dmem_address   : out std_logic_vector(31 downto 0);
+		dmem_data_in   : in  std_logic_vector(31 downto 0);
+		dmem_data_out  : out std_logic_vector(31 downto 0);
+		dmem_data_size : out std_logic_vector( 1 downto 0);
+		dmem_read_req  : out std_logic;
+		dmem_read_ack  : in  std_logic;
+		dmem_write_req : out std_logic;
+		dmem_write_ack : in  std_logic
+	);
+end entity pp_load_queue;
+
+architecture behaviour of pp_load_queue is
+
+	type word_array is array(0 to DEPTH - 1) of std_logic_vector(31 downto 0);
+	type size_array is array(0 to DEPTH - 1) of std_logic_vector(1 downto 0);
+	type register_array is array(0 to DEPTH - 1) of register_address;
+	type memop_array is array(0 to DEPTH - 1) of memory_operation_type;
+	type memop_size_array is array(0 to DEPTH - 1) of memory_operation_size;
+	subtype queue_index_type is natural range 0 to DEPTH - 1;
+
+	-- Queued accesses:
+	signal address_queue, data_queue : word_array;
+	signal size_queue : size_array;
+	signal store_queue : std_logic_vector(DEPTH - 1 downto 0);
+	signal rd_queue : register_array;
+	signal memop_queue : memop_array;
+	signal memop_size_queue : memop_size_array;
+
+	signal head, tail : queue_index_type;
+	signal count : natural range 0 to DEPTH;
+
+	signal push, pop : std_logic;
+	signal head_valid, head_store : std_logic;
+
+	-- Results of loads waiting for the register file write port:
+	signal load_done : std_logic;
+	signal load_data : std_logic_vector(31 downto 0);
+	signal result_valid : std_logic;
+	signal result_data : std_logic_vector(31 downto 0);
+	signal result_write : std_logic;
+
+	signal scoreboard : std_logic_vector(31 downto 0);
+
+	--! Increments an index into the queue.
+	function next_index(index : in queue_index_type) return queue_index_type is
+	begin
+		if index = DEPTH - 1 then
+			return 0;
+		else
+			return index + 1;
+		end if;
+	end function next_index;
+
+begin
+
+	full <= '1' when count = DEPTH else '0';
+	empty <= '1' when count = 0 else '0';
+	pending <= scoreboard;
+
+	head_valid <= '1' when count /= 0 else '0';
+	head_store <= store_queue(head);
+
+	-- The access at the head of the queue is requested until it is acknowledged:
+	dmem_address <= address_queue(head);
+	dmem_data_out <= data_queue(head);
+	dmem_data_size <= size_queue(head);
+	dmem_read_req <= head_valid and not head_store and not result_valid and not dmem_read_ack;
+	dmem_write_req <= head_valid and head_store and not dmem_write_ack;
+
+	write_ack <= head_valid and head_store and dmem_write_ack;
+
+	-- Loaded data is written directly to the register file if the write port is free, otherwise
+	-- it is kept until the write port becomes free:
+	load_done <= head_valid and not head_store and dmem_read_ack;
+	load_data <= extend_load_data(dmem_data_in, memop_queue(head), memop_size_queue(head));
+
+	result_write <= (result_valid or load_done) and rd_port_free;
+	rd_addr <= rd_queue(head);
+	rd_data <= result_data when result_valid = '1' else load_data;
+	rd_write <= result_write;
+
+	push <= req_read or req_write;
+	pop <= result_write or (head_valid and head_store and dmem_write_ack);
+
+	update_queue: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				head <= 0;
+				tail <= 0;
+				count <= 0;
+				result_valid <= '0';
+				scoreboard <= (others => '0');
+			else
+				if push = '1' then
+					address_queue(tail) <= req_address;
+					data_queue(tail) <= req_data;
+					size_queue(tail) <= req_data_size;
+					store_queue(tail) <= req_write;
+					rd_queue(tail) <= req_rd_addr;
+					memop_queue(tail) <= req_mem_op;
+					memop_size_queue(tail) <= req_mem_size;
+					tail <= next_index(tail);
+				end if;
+
+				if pop = '1' then
+					head <= next_index(head);
+				end if;
+
+				if push = '1' and pop = '0' then
+					count <= count + 1;
+				elsif push = '0' and pop = '1' then
+					count <= count - 1;
+				end if;
+
+				if load_done = '1' and rd_port_free = '0' then
+					result_valid <= '1';
+					result_data <= load_data;
+				elsif result_write = '1' then
+					result_valid <= '0';
+				end if;
+
+				-- The execute stage does not issue loads to registers that are already pending,
+				-- so a register is never set and cleared in the same cycle:
+				if result_write = '1' then
+					scoreboard(to_integer(unsigned(rd_queue(head)))) <= '0';
+				end if;
+
+				if req_read = '1' and req_rd_addr /= b"00000" then
+					scoreboard(to_integer(unsigned(req_rd_addr))) <= '1';
+				end if;
+			end if;
+		end if;
+	end process update_queue;
+
+end architecture behaviour;
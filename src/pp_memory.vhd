@@ -63,17 +63,25 @@ architecture behaviour of pp_memory is
 	signal mem_size : memory_operation_size;
 
 	signal rd_data : std_logic_vector(31 downto 0);
+
+	signal rd_write, count_instr : std_logic;
+	signal csr_write : csr_write_mode;
 begin
 
 	mem_op_out <= mem_op;
 
+	-- A bubble is passed on to the writeback stage while the instruction is stalled:
+	rd_write_out <= rd_write and not stall;
+	count_instr_out <= count_instr and not stall;
+	csr_write_out <= csr_write when stall = '0' else CSR_WRITE_NONE;
+
 	pipeline_register: process(clk)
 	begin
 		if rising_edge(clk) then
 			if reset = '1' then
-				rd_write_out <= '0';
-				csr_write_out <= CSR_WRITE_NONE;
-				count_instr_out <= '0';
+				rd_write <= '0';
+				csr_write <= CSR_WRITE_NONE;
+				count_instr <= '0';
 				mem_op <= MEMOP_TYPE_NONE;
 			elsif stall = '0' then
 				mem_size <= mem_size_in;
@@ -82,18 +90,18 @@ begin
 
 				if exception_in = '1' then
 					mem_op <= MEMOP_TYPE_NONE;
-					rd_write_out <= '0';
-					csr_write_out <= CSR_WRITE_REPLACE;
+					rd_write <= '0';
+					csr_write <= CSR_WRITE_REPLACE;
 					csr_addr_out <= CSR_MEPC;
 					csr_data_out <= pc;
-					count_instr_out <= '0';
+					count_instr <= '0';
 				else
 					mem_op <= mem_op_in;
-					rd_write_out <= rd_write_in;
-					csr_write_out <= csr_write_in;
+					rd_write <= rd_write_in;
+					csr_write <= csr_write_in;
 					csr_addr_out <= csr_addr_in;
 					csr_data_out <= csr_data_in;
-					count_instr_out <= count_instr_in;
+					count_instr <= count_instr_in;
 				end if;
 			end if;
 		end if;
@@ -130,22 +138,7 @@ begin
 	rd_data_mux: process(rd_data, dmem_data_in, mem_op, mem_size)
 	begin
 		if mem_op = MEMOP_TYPE_LOAD or mem_op = MEMOP_TYPE_LOAD_UNSIGNED then
-			case mem_size is
-				when MEMOP_SIZE_BYTE =>
-					if mem_op = MEMOP_TYPE_LOAD_UNSIGNED then
-						rd_data_out <= std_logic_vector(resize(unsigned(dmem_data_in(7 downto 0)), rd_data_out'length));
-					else
-						rd_data_out <= std_logic_vector(resize(signed(dmem_data_in(7 downto 0)), rd_data_out'length));
-					end if;
-				when MEMOP_SIZE_HALFWORD =>
-					if mem_op = MEMOP_TYPE_LOAD_UNSIGNED then
-						rd_data_out <= std_logic_vector(resize(unsigned(dmem_data_in(15 downto 0)), rd_data_out'length));
-					else
-						rd_data_out <= std_logic_vector(resize(signed(dmem_data_in(15 downto 0)), rd_data_out'length));
-					end if;
-				when MEMOP_SIZE_WORD =>
-					rd_data_out <= dmem_data_in;
-			end case;
+			rd_data_out <= extend_load_data(dmem_data_in, mem_op, mem_size);
 		else
 			rd_data_out <= rd_data;
 		end if;
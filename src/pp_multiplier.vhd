@@ -0,0 +1,112 @@
+-- The Potato Processor - A simple processor for FPGAs
+-- (c) Kristian Klomsten Skordal 2014 - 2015 <kristian.skordal@wafflemail.net>
+-- Report bugs and issues on <https://github.com/skordal/potato/issues>
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.pp_types.all;
+
+--! @brief Pipelined multiplier for the M extension.
+--! @details
+--!	Multiplies two 32-bit operands using a single 33x33-bit signed
+--!	multiplication, which allows all of the MUL* instructions to share
+--!	the same hardware. The operands and the product are registered so that
+--!	the multiplication can be mapped to the DSP blocks of an FPGA. The
+--!	result is available three cycles after the operation is started and
+--!	is kept until the next operation is started.
+entity pp_multiplier is
+	port(
+		clk   : in std_logic;
+		reset : in std_logic;
+
+		start     : in  std_logic;                     --! Starts a new multiplication.
+		x, y      : in  std_logic_vector(31 downto 0); --! Input operands.
+		operation : in  alu_operation;                 --! Multiplication to perform.
+		result    : out std_logic_vector(31 downto 0); --! Result of the multiplication.
+		ready     : out std_logic                      --! Pulsed when the result is available.
+	);
+end entity pp_multiplier;
+
+architecture behaviour of pp_multiplier is
+
+	-- Operand registers:
+	signal operand_x, operand_y : signed(32 downto 0);
+
+	-- Product register:
+	signal product : signed(65 downto 0);
+
+	-- Whether the upper or lower word of the product is returned in each stage:
+	signal high_1, high_2 : std_logic;
+
+	-- Valid bits for each pipeline stage:
+	signal valid_1, valid_2 : std_logic;
+
+begin
+
+	stage_operands: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				valid_1 <= '0';
+			else
+				valid_1 <= start;
+
+				if start = '1' then
+					-- Sign-extend the operands that are to be treated as signed values:
+					case operation is
+						when ALU_MULH =>
+							operand_x <= signed(x(31) & x);
+							operand_y <= signed(y(31) & y);
+						when ALU_MULHSU =>
+							operand_x <= signed(x(31) & x);
+							operand_y <= signed('0' & y);
+						when others =>
+							operand_x <= signed('0' & x);
+							operand_y <= signed('0' & y);
+					end case;
+
+					if operation = ALU_MUL then
+						high_1 <= '0';
+					else
+						high_1 <= '1';
+					end if;
+				end if;
+			end if;
+		end if;
+	end process stage_operands;
+
+	stage_multiply: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				valid_2 <= '0';
+			else
+				valid_2 <= valid_1;
+				product <= operand_x * operand_y;
+				high_2 <= high_1;
+			end if;
+		end if;
+	end process stage_multiply;
+
+	stage_result: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				ready <= '0';
+			else
+				ready <= valid_2;
+
+				if valid_2 = '1' then
+					if high_2 = '1' then
+						result <= std_logic_vector(product(63 downto 32));
+					else
+						result <= std_logic_vector(product(31 downto 0));
+					end if;
+				end if;
+			end if;
+		end if;
+	end process stage_result;
+
+end architecture behaviour;
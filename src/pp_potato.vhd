@@ -6,10 +6,25 @@ library ieee;
 use ieee.std_logic_1164.all;
 
 use work.pp_types.all;
+use work.pp_constants.all;
 use work.pp_utilities.all;
 
 --! @brief The Potato Processor.
 --! This file provides a Wishbone-compatible interface to the Potato processor.
+--! By default, instruction fetches and data accesses share one Wishbone interface
+--! through an arbiter. If HARVARD_BUS is set, instructions are fetched using the
+--! separate instruction interface, so that fetches and data accesses can proceed
+--! in parallel, and the shared interface is only used for data accesses.
+--! If PIPELINED_BUS is set, data accesses use Wishbone B4 pipelined cycles, so
+--! that a stream of loads or stores can complete one access per cycle. The caches
+--! always use classic cycles, so this requires the data cache to be disabled and
+--! HARVARD_BUS to be set, so that the data interface only has pipelined cycles.
+--!
+--! Optional tightly-coupled memories (TCMs) are connected directly to the processor
+--! core, bypassing the caches and the Wishbone interfaces, so that accesses to them
+--! complete without wait states. Instructions can be fetched from the instruction
+--! TCM, and both TCMs can be read and written using loads and stores. Each TCM is
+--! mapped at its base address, which must be aligned to its size, a power of two.
 entity pp_potato is
 	generic(
 		PROCESSOR_ID           : std_logic_vector(31 downto 0) := x"00000000"; --! Processor ID.
@@ -17,7 +32,40 @@ entity pp_potato is
 		MTIME_DIVIDER          : positive                      := 5;           --! Divider for the clock driving the MTIME counter.
 		ICACHE_ENABLE          : boolean                       := true;        --! Whether to enable the instruction cache.
 		ICACHE_LINE_SIZE       : natural                       := 4;           --! Number of words per instruction cache line.
-		ICACHE_NUM_LINES       : natural                       := 128          --! Number of cache lines in the instruction cache.
+		ICACHE_NUM_LINES       : natural                       := 128;         --! Number of cache lines in the instruction cache.
+		ICACHE_WAYS            : natural                       := 1;           --! Number of ways in the instruction cache, 1, 2 or 4.
+		ICACHE_PREFETCH        : boolean                       := false;       --! Whether to prefetch the next instruction cache line.
+		DCACHE_ENABLE          : boolean                       := false;       --! Whether to enable the data cache.
+		DCACHE_LINE_SIZE       : natural                       := 4;           --! Number of words per data cache line.
+		DCACHE_NUM_LINES       : natural                       := 128;         --! Number of cache lines in the data cache.
+		DCACHE_UNCACHED_MASK   : std_logic_vector(31 downto 0) := x"ffff0000"; --! Address bits compared to DCACHE_UNCACHED_BASE.
+		DCACHE_UNCACHED_BASE   : std_logic_vector(31 downto 0) := x"c0000000"; --! Base address of the data space that is not cached or reordered, such as peripherals.
+		BURST_REFILLS          : boolean                       := false;       --! Whether the caches load lines using Wishbone incrementing bursts.
+		HARVARD_BUS            : boolean                       := false;       --! Whether to fetch instructions using a separate Wishbone interface.
+		PIPELINED_BUS          : boolean                       := false;       --! Whether data accesses use pipelined Wishbone cycles.
+		ARBITER_POLICY         : wb_arbiter_policy             := ARBITER_FIXED_PRIORITY; --! Policy used to arbitrate between instruction and data accesses.
+		ARBITER_IMEM_WEIGHT    : positive                      := 1;           --! Consecutive bus cycles granted to instruction accesses by the weighted policy.
+		ARBITER_DMEM_WEIGHT    : positive                      := 1;           --! Consecutive bus cycles granted to data accesses by the weighted policy.
+		ARBITER_MAX_WAIT       : natural                       := 0;           --! Cycles an access can wait before it is granted the bus next, 0 for no limit.
+		ITCM_BASE              : std_logic_vector(31 downto 0) := x"10000000"; --! Base address of the instruction TCM.
+		ITCM_SIZE              : natural                       := 0;           --! Size of the instruction TCM in bytes, 0 disables it.
+		DTCM_BASE              : std_logic_vector(31 downto 0) := x"20000000"; --! Base address of the data TCM.
+		DTCM_SIZE              : natural                       := 0;           --! Size of the data TCM in bytes, 0 disables it.
+		BRANCH_PREDICTION      : boolean                       := false;       --! Whether to enable dynamic branch prediction.
+		BTB_NUM_ENTRIES        : natural                       := 32;          --! Number of entries in the branch target buffer.
+		BHT_NUM_ENTRIES        : natural                       := 128;         --! Number of counters in the branch history table.
+		RAS_DEPTH              : natural                       := 0;           --! Number of entries in the return address stack, 0 disables it.
+		EARLY_JUMPS            : boolean                       := true;        --! Whether to resolve direct jumps in the decode stage.
+		STATIC_BRANCH_PREDICTION : boolean                     := false;       --! Whether to predict backwards branches as taken when dynamic prediction is disabled.
+		LOAD_USE_BYPASS        : boolean                       := false;       --! Whether to forward load data to dependent instructions without stalling.
+		M_EXTENSION            : boolean                       := false;       --! Whether to implement the M extension for multiplication and division.
+		ZBB_EXTENSION          : boolean                       := false;       --! Whether to implement the Zbb and Zbkb bit-manipulation extensions.
+		ZKNH_EXTENSION         : boolean                       := false;       --! Whether to implement the SHA-256 instructions from the Zknh extension.
+		C_EXTENSION            : boolean                       := false;       --! Whether to implement the C extension for compressed instructions.
+		FETCH_QUEUE_DEPTH      : natural                       := 0;           --! Number of entries in the queue between the fetch and decode stages, 0 disables it.
+		STORE_BUFFER_DEPTH     : natural                       := 0;           --! Number of entries in the store buffer, 0 disables it.
+		MISALIGNED_ACCESS      : boolean                       := false;       --! Whether to split misaligned loads and stores into two bus transactions instead of causing exceptions.
+		LOAD_QUEUE_DEPTH       : natural                       := 0            --! Number of outstanding loads allowed while execution continues, 0 makes loads stall the pipeline.
 	);
 	port(
 		clk       : in std_logic;
@@ -29,6 +77,9 @@ entity pp_potato is
 		-- Test interface:
 		test_context_out : out test_context;
 
+		-- Performance monitoring interface:
+		cache_events_out : out cache_performance_events;
+
 		-- Wishbone interface:
 		wb_adr_out : out std_logic_vector(31 downto 0);
 		wb_sel_out : out std_logic_vector( 3 downto 0);
@@ -37,7 +88,20 @@ entity pp_potato is
 		wb_we_out  : out std_logic;
 		wb_dat_out : out std_logic_vector(31 downto 0);
 		wb_dat_in  : in  std_logic_vector(31 downto 0);
-		wb_ack_in  : in  std_logic
+		wb_ack_in  : in  std_logic;
+		wb_cti_out : out std_logic_vector( 2 downto 0);
+		wb_bte_out : out std_logic_vector( 1 downto 0);
+		wb_stall_in : in std_logic := '0'; --! Only used if PIPELINED_BUS is set.
+
+		-- Instruction Wishbone interface, only used if HARVARD_BUS is set:
+		iwb_adr_out : out std_logic_vector(31 downto 0);
+		iwb_sel_out : out std_logic_vector( 3 downto 0);
+		iwb_cyc_out : out std_logic;
+		iwb_stb_out : out std_logic;
+		iwb_dat_in  : in  std_logic_vector(31 downto 0) := (others => '0');
+		iwb_ack_in  : in  std_logic := '0';
+		iwb_cti_out : out std_logic_vector( 2 downto 0);
+		iwb_bte_out : out std_logic_vector( 1 downto 0)
 	);
 end entity pp_potato;
 
@@ -48,6 +112,10 @@ architecture behaviour of pp_potato is
 	signal imem_data    : std_logic_vector(31 downto 0);
 	signal imem_req, imem_ack : std_logic;
 
+	-- Instruction memory signals for fetches outside the instruction TCM:
+	signal ibus_data : std_logic_vector(31 downto 0);
+	signal ibus_req, ibus_ack : std_logic;
+
 	-- Data memory signals:
 	signal dmem_address   : std_logic_vector(31 downto 0);
 	signal dmem_data_in   : std_logic_vector(31 downto 0);
@@ -57,21 +125,83 @@ architecture behaviour of pp_potato is
 	signal dmem_read_ack  : std_logic;
 	signal dmem_write_req : std_logic;
 	signal dmem_write_ack : std_logic;
+	signal dmem_drained   : std_logic;
+
+	-- Data memory signals for accesses outside the TCMs:
+	signal dmem_ext_data_in   : std_logic_vector(31 downto 0);
+	signal dmem_ext_read_req  : std_logic;
+	signal dmem_ext_read_ack  : std_logic;
+	signal dmem_ext_write_req : std_logic;
+	signal dmem_ext_write_ack : std_logic;
+
+	-- TCM data port signals:
+	signal dmem_itcm_select, dmem_dtcm_select : std_logic;
+	signal itcm_dmem_data, dtcm_dmem_data : std_logic_vector(31 downto 0);
+	signal itcm_dmem_read_ack, itcm_dmem_write_ack : std_logic;
+	signal dtcm_dmem_read_ack, dtcm_dmem_write_ack : std_logic;
+
+	-- Data cache control signals:
+	signal dcache_flush, dcache_invalidate : std_logic;
+	signal dcache_busy : std_logic;
+	signal store_buffer_empty : std_logic;
+	signal dmem_if_idle : std_logic;
+
+	-- Instruction cache control signals:
+	signal icache_invalidate, icache_invalidate_range : std_logic;
+	signal icache_invalidate_start, icache_invalidate_end : std_logic_vector(31 downto 0);
+
+	-- Data memory signals between the store buffer and the Wishbone interface:
+	signal dbus_address   : std_logic_vector(31 downto 0);
+	signal dbus_data_in   : std_logic_vector(31 downto 0);
+	signal dbus_data_out  : std_logic_vector(31 downto 0);
+	signal dbus_data_size : std_logic_vector( 1 downto 0);
+	signal dbus_read_req  : std_logic;
+	signal dbus_read_ack  : std_logic;
+	signal dbus_write_req : std_logic;
+	signal dbus_write_ack : std_logic;
 
 	-- Wishbone signals:
 	signal icache_inputs, dmem_if_inputs   : wishbone_master_inputs;
 	signal icache_outputs, dmem_if_outputs : wishbone_master_outputs;
+	signal icache_prefetching, icache_yield : std_logic;
 
     -- Arbiter signals:
 	signal m1_inputs, m2_inputs   : wishbone_master_inputs;
 	signal m1_outputs, m2_outputs : wishbone_master_outputs;
 
+	--! Selects the weight of an arbiter master, the instruction cache is master 1 when it is enabled.
+	function arbiter_weight(master_is_imem : in boolean) return positive is
+	begin
+		if master_is_imem then
+			return ARBITER_IMEM_WEIGHT;
+		else
+			return ARBITER_DMEM_WEIGHT;
+		end if;
+	end function arbiter_weight;
+
 begin
 
+	assert not PIPELINED_BUS or (HARVARD_BUS and not DCACHE_ENABLE)
+		report "Pipelined data accesses require a separate instruction bus and no data cache!" severity FAILURE;
+
 	processor: entity work.pp_core
 		generic map(
 			PROCESSOR_ID => PROCESSOR_ID,
-			RESET_ADDRESS => RESET_ADDRESS
+			RESET_ADDRESS => RESET_ADDRESS,
+			BRANCH_PREDICTION => BRANCH_PREDICTION,
+			BTB_NUM_ENTRIES => BTB_NUM_ENTRIES,
+			BHT_NUM_ENTRIES => BHT_NUM_ENTRIES,
+			RAS_DEPTH => RAS_DEPTH,
+			EARLY_JUMPS => EARLY_JUMPS,
+			STATIC_BRANCH_PREDICTION => STATIC_BRANCH_PREDICTION,
+			LOAD_USE_BYPASS => LOAD_USE_BYPASS,
+			M_EXTENSION => M_EXTENSION,
+			ZBB_EXTENSION => ZBB_EXTENSION,
+			ZKNH_EXTENSION => ZKNH_EXTENSION,
+			C_EXTENSION => C_EXTENSION,
+			FETCH_QUEUE_DEPTH => FETCH_QUEUE_DEPTH,
+			MISALIGNED_ACCESS => MISALIGNED_ACCESS,
+			LOAD_QUEUE_DEPTH => LOAD_QUEUE_DEPTH
 		) port map(
 			clk => clk,
 			reset => reset,
@@ -87,7 +217,15 @@ begin
 			dmem_read_ack => dmem_read_ack,
 			dmem_write_req => dmem_write_req,
 			dmem_write_ack => dmem_write_ack,
+			dmem_drained => dmem_drained,
+			dcache_flush => dcache_flush,
+			dcache_invalidate => dcache_invalidate,
+			icache_invalidate => icache_invalidate,
+			icache_invalidate_range => icache_invalidate_range,
+			icache_invalidate_start => icache_invalidate_start,
+			icache_invalidate_end => icache_invalidate_end,
 			test_context_out => test_context_out,
+			perf_events_out => open,
 			irq => irq
 		);
 
@@ -96,23 +234,30 @@ begin
 		icache: entity work.pp_icache
 			generic map(
 				LINE_SIZE => ICACHE_LINE_SIZE,
-				NUM_LINES => ICACHE_NUM_LINES
+				NUM_LINES => ICACHE_NUM_LINES,
+				WAYS => ICACHE_WAYS,
+				PREFETCH => ICACHE_PREFETCH,
+				BURSTS => BURST_REFILLS
 			) port map(
 				clk => clk,
 				reset => reset,
 				mem_address_in => imem_address,
-				mem_data_out => imem_data,
-				mem_read_req => imem_req,
-				mem_read_ack => imem_ack,
+				mem_data_out => ibus_data,
+				mem_read_req => ibus_req,
+				mem_read_ack => ibus_ack,
+				hit_out => cache_events_out.icache_hit,
+				miss_out => cache_events_out.icache_miss,
+				prefetch_useful_out => cache_events_out.icache_prefetch_useful,
+				prefetch_useless_out => cache_events_out.icache_prefetch_useless,
+				prefetch_yield => icache_yield,
+				prefetching => icache_prefetching,
+				invalidate => icache_invalidate,
+				invalidate_range => icache_invalidate_range,
+				invalidate_start => icache_invalidate_start,
+				invalidate_end => icache_invalidate_end,
 				wb_inputs => icache_inputs,
 				wb_outputs => icache_outputs
 			);
-
-		icache_inputs <= m1_inputs;
-		m1_outputs <= icache_outputs;
-
-		dmem_if_inputs <= m2_inputs;
-		m2_outputs <= dmem_if_outputs;
 	end generate icache_enabled;
 
 	icache_disabled: if not ICACHE_ENABLE
@@ -123,55 +268,346 @@ begin
 				reset => reset,
 				mem_address => imem_address,
 				mem_data_in => (others => '0'),
-				mem_data_out => imem_data,
+				mem_data_out => ibus_data,
 				mem_data_size => (others => '0'),
-				mem_read_req => imem_req,
-				mem_read_ack => imem_ack,
+				mem_read_req => ibus_req,
+				mem_read_ack => ibus_ack,
 				mem_write_req => '0',
 				mem_write_ack => open,
+				idle => open,
 				wb_inputs => icache_inputs,
 				wb_outputs => icache_outputs
 			);
 
-		dmem_if_inputs <= m1_inputs;
-		m1_outputs <= dmem_if_outputs;
-
-		icache_inputs <= m2_inputs;
-		m2_outputs <= icache_outputs;
+		cache_events_out.icache_hit <= '0';
+		cache_events_out.icache_miss <= '0';
+		cache_events_out.icache_prefetch_useful <= '0';
+		cache_events_out.icache_prefetch_useless <= '0';
+		icache_prefetching <= '0';
 	end generate icache_disabled;
 
-	dmem_if: entity work.pp_wb_adapter
-		port map(
-			clk => clk,
-			reset => reset,
-			mem_address => dmem_address,
-			mem_data_in => dmem_data_out,
-			mem_data_out => dmem_data_in,
-			mem_data_size => dmem_data_size,
-			mem_read_req => dmem_read_req,
-			mem_read_ack => dmem_read_ack,
-			mem_write_req => dmem_write_req,
-			mem_write_ack => dmem_write_ack,
-			wb_inputs => dmem_if_inputs,
-			wb_outputs => dmem_if_outputs
-		);
+	itcm_enabled: if ITCM_SIZE > 0
+	generate
+		signal imem_itcm_select : std_logic;
+		signal itcm_imem_data : std_logic_vector(31 downto 0);
+		signal itcm_imem_req, itcm_imem_ack : std_logic;
+	begin
+		imem_itcm_select <= to_std_logic(imem_address(31 downto log2(ITCM_SIZE)) = ITCM_BASE(31 downto log2(ITCM_SIZE)));
+		dmem_itcm_select <= to_std_logic(dmem_address(31 downto log2(ITCM_SIZE)) = ITCM_BASE(31 downto log2(ITCM_SIZE)));
 
-	arbiter: entity work.pp_wb_arbiter
-		port map(
-			clk => clk,
-			reset => reset,
-			m1_inputs => m1_inputs,
-			m1_outputs => m1_outputs,
-			m2_inputs => m2_inputs,
-			m2_outputs => m2_outputs,
-			wb_adr_out => wb_adr_out,
-			wb_sel_out => wb_sel_out,
-			wb_cyc_out => wb_cyc_out,
-			wb_stb_out => wb_stb_out,
-			wb_we_out => wb_we_out,
-			wb_dat_out => wb_dat_out,
-			wb_dat_in => wb_dat_in,
-			wb_ack_in => wb_ack_in
-		);
+		itcm: entity work.pp_tcm
+			generic map(
+				MEMORY_SIZE => ITCM_SIZE,
+				MISALIGNED_ACCESS => MISALIGNED_ACCESS
+			) port map(
+				clk => clk,
+				reset => reset,
+				imem_address => imem_address,
+				imem_data_out => itcm_imem_data,
+				imem_req => itcm_imem_req,
+				imem_ack => itcm_imem_ack,
+				dmem_address => dmem_address,
+				dmem_data_in => dmem_data_out,
+				dmem_data_out => itcm_dmem_data,
+				dmem_data_size => dmem_data_size,
+				dmem_read_req => dmem_read_req and dmem_itcm_select,
+				dmem_read_ack => itcm_dmem_read_ack,
+				dmem_write_req => dmem_write_req and dmem_itcm_select,
+				dmem_write_ack => itcm_dmem_write_ack
+			);
+
+		-- The instruction cache acknowledges requests based on the address from the previous cycle,
+		-- the same as the TCM, so the source of an acknowledge is selected using that address. Fetches
+		-- from the TCM are never passed on to the cache, which would load them from the bus on a miss:
+		icache_routing: if ICACHE_ENABLE
+		generate
+			signal imem_itcm_selected : std_logic;
+		begin
+			select_source: process(clk)
+			begin
+				if rising_edge(clk) then
+					if reset = '1' then
+						imem_itcm_selected <= '0';
+					else
+						imem_itcm_selected <= imem_itcm_select;
+					end if;
+				end if;
+			end process select_source;
+
+			ibus_req <= imem_req and not imem_itcm_select;
+			itcm_imem_req <= imem_req and imem_itcm_select;
+
+			imem_ack <= itcm_imem_ack when imem_itcm_selected = '1' else ibus_ack;
+			imem_data <= itcm_imem_data when imem_itcm_selected = '1' else ibus_data;
+		end generate icache_routing;
+
+		-- Without the instruction cache, a fetch started on the bus is completed before the
+		-- TCM is used, so that a late acknowledge is not taken for a fetch from the TCM:
+		imem_if_routing: if not ICACHE_ENABLE
+		generate
+			signal ibus_pending : std_logic;
+		begin
+			track_fetch: process(clk)
+			begin
+				if rising_edge(clk) then
+					if reset = '1' then
+						ibus_pending <= '0';
+					elsif ibus_req = '1' and (ibus_pending = '0' or ibus_ack = '1') then
+						ibus_pending <= '1';
+					elsif ibus_ack = '1' then
+						ibus_pending <= '0';
+					end if;
+				end if;
+			end process track_fetch;
+
+			ibus_req <= imem_req and not imem_itcm_select;
+			itcm_imem_req <= imem_req and imem_itcm_select and (not ibus_pending or ibus_ack);
+
+			imem_ack <= itcm_imem_ack or ibus_ack;
+			imem_data <= itcm_imem_data when itcm_imem_ack = '1' else ibus_data;
+		end generate imem_if_routing;
+	end generate itcm_enabled;
+
+	itcm_disabled: if ITCM_SIZE = 0
+	generate
+		ibus_req <= imem_req;
+		imem_ack <= ibus_ack;
+		imem_data <= ibus_data;
+
+		dmem_itcm_select <= '0';
+		itcm_dmem_data <= (others => '0');
+		itcm_dmem_read_ack <= '0';
+		itcm_dmem_write_ack <= '0';
+	end generate itcm_disabled;
+
+	dtcm_enabled: if DTCM_SIZE > 0
+	generate
+		dmem_dtcm_select <= to_std_logic(dmem_address(31 downto log2(DTCM_SIZE)) = DTCM_BASE(31 downto log2(DTCM_SIZE)));
+
+		dtcm: entity work.pp_tcm
+			generic map(
+				MEMORY_SIZE => DTCM_SIZE,
+				MISALIGNED_ACCESS => MISALIGNED_ACCESS
+			) port map(
+				clk => clk,
+				reset => reset,
+				imem_address => (others => '0'),
+				imem_data_out => open,
+				imem_req => '0',
+				imem_ack => open,
+				dmem_address => dmem_address,
+				dmem_data_in => dmem_data_out,
+				dmem_data_out => dtcm_dmem_data,
+				dmem_data_size => dmem_data_size,
+				dmem_read_req => dmem_read_req and dmem_dtcm_select,
+				dmem_read_ack => dtcm_dmem_read_ack,
+				dmem_write_req => dmem_write_req and dmem_dtcm_select,
+				dmem_write_ack => dtcm_dmem_write_ack
+			);
+	end generate dtcm_enabled;
+
+	dtcm_disabled: if DTCM_SIZE = 0
+	generate
+		dmem_dtcm_select <= '0';
+		dtcm_dmem_data <= (others => '0');
+		dtcm_dmem_read_ack <= '0';
+		dtcm_dmem_write_ack <= '0';
+	end generate dtcm_disabled;
+
+	-- Accesses to the TCMs complete in the cycle after they are requested, and the processor does not
+	-- make a new request before the previous one has been acknowledged, so the acknowledges never overlap:
+	dmem_ext_read_req <= dmem_read_req and not (dmem_itcm_select or dmem_dtcm_select);
+	dmem_ext_write_req <= dmem_write_req and not (dmem_itcm_select or dmem_dtcm_select);
+	dmem_read_ack <= dmem_ext_read_ack or itcm_dmem_read_ack or dtcm_dmem_read_ack;
+	dmem_write_ack <= dmem_ext_write_ack or itcm_dmem_write_ack or dtcm_dmem_write_ack;
+	dmem_data_in <= itcm_dmem_data when itcm_dmem_read_ack = '1'
+		else dtcm_dmem_data when dtcm_dmem_read_ack = '1'
+		else dmem_ext_data_in;
+
+	store_buffer_enabled: if STORE_BUFFER_DEPTH > 0
+	generate
+		store_buffer: entity work.pp_store_buffer
+			generic map(
+				DEPTH => STORE_BUFFER_DEPTH,
+				UNCACHED_MASK => DCACHE_UNCACHED_MASK,
+				UNCACHED_BASE => DCACHE_UNCACHED_BASE
+			) port map(
+				clk => clk,
+				reset => reset,
+				mem_address => dmem_address,
+				mem_data_in => dmem_data_out,
+				mem_data_out => dmem_ext_data_in,
+				mem_data_size => dmem_data_size,
+				mem_read_req => dmem_ext_read_req,
+				mem_read_ack => dmem_ext_read_ack,
+				mem_write_req => dmem_ext_write_req,
+				mem_write_ack => dmem_ext_write_ack,
+				empty => store_buffer_empty,
+				bus_address => dbus_address,
+				bus_data_out => dbus_data_out,
+				bus_data_in => dbus_data_in,
+				bus_data_size => dbus_data_size,
+				bus_read_req => dbus_read_req,
+				bus_read_ack => dbus_read_ack,
+				bus_write_req => dbus_write_req,
+				bus_write_ack => dbus_write_ack
+			);
+	end generate store_buffer_enabled;
+
+	store_buffer_disabled: if STORE_BUFFER_DEPTH = 0
+	generate
+		dbus_address <= dmem_address;
+		dbus_data_out <= dmem_data_out;
+		dbus_data_size <= dmem_data_size;
+		dbus_read_req <= dmem_ext_read_req;
+		dbus_write_req <= dmem_ext_write_req;
+		dmem_ext_data_in <= dbus_data_in;
+		dmem_ext_read_ack <= dbus_read_ack;
+		dmem_ext_write_ack <= dbus_write_ack;
+		store_buffer_empty <= '1';
+	end generate store_buffer_disabled;
+
+	-- Stores have been written to memory when the store buffer is empty, the data cache has completed
+	-- any requested flush and the Wishbone adapter has no pipelined writes waiting for acknowledgement:
+	dmem_drained <= store_buffer_empty and not dcache_busy and dmem_if_idle;
+
+	dcache_enabled: if DCACHE_ENABLE
+	generate
+		dcache: entity work.pp_dcache
+			generic map(
+				LINE_SIZE => DCACHE_LINE_SIZE,
+				NUM_LINES => DCACHE_NUM_LINES,
+				UNCACHED_MASK => DCACHE_UNCACHED_MASK,
+				UNCACHED_BASE => DCACHE_UNCACHED_BASE,
+				BURSTS => BURST_REFILLS
+			) port map(
+				clk => clk,
+				reset => reset,
+				mem_address => dbus_address,
+				mem_data_in => dbus_data_out,
+				mem_data_out => dbus_data_in,
+				mem_data_size => dbus_data_size,
+				mem_read_req => dbus_read_req,
+				mem_read_ack => dbus_read_ack,
+				mem_write_req => dbus_write_req,
+				mem_write_ack => dbus_write_ack,
+				flush => dcache_flush,
+				invalidate => dcache_invalidate,
+				busy => dcache_busy,
+				wb_inputs => dmem_if_inputs,
+				wb_outputs => dmem_if_outputs
+			);
+
+		-- The data cache only acknowledges accesses when they have been completed:
+		dmem_if_idle <= '1';
+	end generate dcache_enabled;
+
+	dcache_disabled: if not DCACHE_ENABLE
+	generate
+		dmem_if: entity work.pp_wb_adapter
+			generic map(
+				MISALIGNED_ACCESS => MISALIGNED_ACCESS,
+				PIPELINED => PIPELINED_BUS
+			) port map(
+				clk => clk,
+				reset => reset,
+				mem_address => dbus_address,
+				mem_data_in => dbus_data_out,
+				mem_data_out => dbus_data_in,
+				mem_data_size => dbus_data_size,
+				mem_read_req => dbus_read_req,
+				mem_read_ack => dbus_read_ack,
+				mem_write_req => dbus_write_req,
+				mem_write_ack => dbus_write_ack,
+				idle => dmem_if_idle,
+				wb_inputs => dmem_if_inputs,
+				wb_outputs => dmem_if_outputs
+			);
+
+		dcache_busy <= '0';
+	end generate dcache_disabled;
+
+	shared_bus: if not HARVARD_BUS
+	generate
+		-- The instruction cache has priority over the data memory interface, except when it is
+		-- only prefetching. Without the instruction cache, data accesses have priority:
+		icache_arbitration: if ICACHE_ENABLE
+		generate
+			icache_inputs <= m1_inputs;
+			m1_outputs <= icache_outputs;
+
+			dmem_if_inputs <= m2_inputs;
+			m2_outputs <= dmem_if_outputs;
+		end generate icache_arbitration;
+
+		imem_arbitration: if not ICACHE_ENABLE
+		generate
+			dmem_if_inputs <= m1_inputs;
+			m1_outputs <= dmem_if_outputs;
+
+			icache_inputs <= m2_inputs;
+			m2_outputs <= icache_outputs;
+		end generate imem_arbitration;
+
+		icache_yield <= dmem_if_outputs.cyc;
+
+		arbiter: entity work.pp_wb_arbiter
+			generic map(
+				POLICY => ARBITER_POLICY,
+				M1_WEIGHT => arbiter_weight(ICACHE_ENABLE),
+				M2_WEIGHT => arbiter_weight(not ICACHE_ENABLE),
+				MAX_WAIT => ARBITER_MAX_WAIT
+			) port map(
+				clk => clk,
+				reset => reset,
+				m1_inputs => m1_inputs,
+				m1_outputs => m1_outputs,
+				m1_yield => icache_prefetching,
+				m2_inputs => m2_inputs,
+				m2_outputs => m2_outputs,
+				wb_adr_out => wb_adr_out,
+				wb_sel_out => wb_sel_out,
+				wb_cyc_out => wb_cyc_out,
+				wb_stb_out => wb_stb_out,
+				wb_we_out => wb_we_out,
+				wb_dat_out => wb_dat_out,
+				wb_dat_in => wb_dat_in,
+				wb_ack_in => wb_ack_in,
+				wb_cti_out => wb_cti_out,
+				wb_bte_out => wb_bte_out,
+				wb_stall_in => wb_stall_in
+			);
+
+		iwb_adr_out <= (others => '0');
+		iwb_sel_out <= (others => '0');
+		iwb_cyc_out <= '0';
+		iwb_stb_out <= '0';
+		iwb_cti_out <= WB_CTI_CLASSIC;
+		iwb_bte_out <= WB_BTE_LINEAR;
+	end generate shared_bus;
+
+	harvard_bus_enabled: if HARVARD_BUS
+	generate
+		iwb_adr_out <= icache_outputs.adr;
+		iwb_sel_out <= icache_outputs.sel;
+		iwb_cyc_out <= icache_outputs.cyc;
+		iwb_stb_out <= icache_outputs.stb;
+		iwb_cti_out <= icache_outputs.cti;
+		iwb_bte_out <= icache_outputs.bte;
+		icache_inputs <= (ack => iwb_ack_in, dat => iwb_dat_in, stall => '0');
+
+		-- Prefetching never delays data accesses when they use a separate interface:
+		icache_yield <= '0';
+
+		wb_adr_out <= dmem_if_outputs.adr;
+		wb_sel_out <= dmem_if_outputs.sel;
+		wb_cyc_out <= dmem_if_outputs.cyc;
+		wb_stb_out <= dmem_if_outputs.stb;
+		wb_we_out <= dmem_if_outputs.we;
+		wb_dat_out <= dmem_if_outputs.dat;
+		wb_cti_out <= dmem_if_outputs.cti;
+		wb_bte_out <= dmem_if_outputs.bte;
+		dmem_if_inputs <= (ack => wb_ack_in, dat => wb_dat_in, stall => wb_stall_in);
+	end generate harvard_bus_enabled;
 
 end architecture behaviour;
@@ -0,0 +1,140 @@
+-- The Potato Processor - A simple processor for FPGAs
+-- (c) Kristian Klomsten Skordal 2014 - 2015 <kristian.skordal@wafflemail.net>
+-- Report bugs and issues on <https://github.com/skordal/potato/issues>
+
+library ieee;
+use ieee.std_logic_1164.all;
+
+use work.pp_types.all;
+
+--! @brief Return address stack used to predict the targets of function returns.
+--! @details
+--!	The stack is updated speculatively by the fetch stage when calls and
+--!	returns are fetched. A second copy of the stack is updated when calls
+--!	and returns are resolved in the execute stage; this copy is used to
+--!	restore the speculative stack when the pipeline is flushed because of
+--!	a mispredicted branch or an exception. The stack is circular, so that
+--!	overflows overwrite the oldest entries.
+--!
+--!	The stack pointer and the entry at the top of the stack are available as a
+--!	checkpoint before each update. Restoring a checkpoint undoes speculative
+--!	updates made after it, unless they overwrote entries below the top.
+entity pp_return_address_stack is
+	generic(
+		DEPTH : positive := 4 --! Number of entries in the stack.
+	);
+	port(
+		clk   : in std_logic;
+		reset : in std_logic;
+
+		-- Speculative updates from the fetch stage:
+		push         : in  std_logic;                     --! Pushes a return address onto the stack.
+		pop          : in  std_logic;                     --! Pops a return address off the stack.
+		push_address : in  std_logic_vector(31 downto 0); --! Return address to push onto the stack.
+		top          : out std_logic_vector(31 downto 0); --! Return address at the top of the stack.
+		checkpoint   : out ras_checkpoint;                --! Current state of the stack.
+
+		-- Updates from resolved instructions:
+		commit_push         : in std_logic;                     --! A call was resolved.
+		commit_pop          : in std_logic;                     --! A return was resolved.
+		commit_push_address : in std_logic_vector(31 downto 0); --! Return address of the resolved call.
+
+		-- Restores the stack to the state after the last resolved instruction:
+		restore : in std_logic;
+
+		-- Restores the stack to a checkpoint, used when instructions are flushed before they are resolved:
+		restore_checkpoint : in std_logic;
+		restore_state      : in ras_checkpoint
+	);
+end entity pp_return_address_stack;
+
+architecture behaviour of pp_return_address_stack is
+
+	type address_array is array(0 to DEPTH - 1) of std_logic_vector(31 downto 0);
+	subtype stack_pointer_type is natural range 0 to DEPTH - 1;
+
+	-- Speculative stack:
+	signal stack, stack_next     : address_array;
+	signal pointer, pointer_next : stack_pointer_type;
+
+	-- Stack updated by resolved instructions:
+	signal committed_stack, committed_stack_next     : address_array;
+	signal committed_pointer, committed_pointer_next : stack_pointer_type;
+
+	--! Applies a push, a pop or both (a return followed by a call) to a stack.
+	procedure update_stack(entries : inout address_array; index : inout stack_pointer_type;
+		push, pop : in std_logic; address : in std_logic_vector(31 downto 0)) is
+	begin
+		if push = '1' and pop = '1' then
+			entries(index) := address;
+		elsif push = '1' then
+			if index = DEPTH - 1 then
+				index := 0;
+			else
+				index := index + 1;
+			end if;
+			entries(index) := address;
+		elsif pop = '1' then
+			if index = 0 then
+				index := DEPTH - 1;
+			else
+				index := index - 1;
+			end if;
+		end if;
+	end procedure update_stack;
+
+begin
+
+	top <= stack(pointer);
+	checkpoint <= (pointer => pointer, top => stack(pointer));
+
+	calc_committed_next: process(committed_stack, committed_pointer, commit_push, commit_pop, commit_push_address)
+		variable next_stack   : address_array;
+		variable next_pointer : stack_pointer_type;
+	begin
+		next_stack := committed_stack;
+		next_pointer := committed_pointer;
+		update_stack(next_stack, next_pointer, commit_push, commit_pop, commit_push_address);
+
+		committed_stack_next <= next_stack;
+		committed_pointer_next <= next_pointer;
+	end process calc_committed_next;
+
+	calc_speculative_next: process(stack, pointer, push, pop, push_address, restore,
+		committed_stack_next, committed_pointer_next, restore_checkpoint, restore_state)
+		variable next_stack   : address_array;
+		variable next_pointer : stack_pointer_type;
+	begin
+		if restore = '1' then
+			next_stack := committed_stack_next;
+			next_pointer := committed_pointer_next;
+		elsif restore_checkpoint = '1' then
+			next_stack := stack;
+			next_pointer := restore_state.pointer;
+			next_stack(next_pointer) := restore_state.top;
+		else
+			next_stack := stack;
+			next_pointer := pointer;
+			update_stack(next_stack, next_pointer, push, pop, push_address);
+		end if;
+
+		stack_next <= next_stack;
+		pointer_next <= next_pointer;
+	end process calc_speculative_next;
+
+	update: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				pointer <= 0;
+				committed_pointer <= 0;
+			else
+				stack <= stack_next;
+				pointer <= pointer_next;
+				committed_stack <= committed_stack_next;
+				committed_pointer <= committed_pointer_next;
+			end if;
+		end if;
+	end process update;
+
+end architecture behaviour;
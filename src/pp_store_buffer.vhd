@@ -0,0 +1,227 @@
+-- The Potato Processor - A simple processor for FPGAs
+-- (c) Kristian Klomsten Skordal 2014 - 2015 <kristian.skordal@wafflemail.net>
+-- Report bugs and issues on <https://github.com/skordal/potato/issues>
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.pp_types.all;
+use work.pp_utilities.all;
+
+--! @brief Store buffer for the data memory interface.
+--! @details
+--!	Stores from the processor are acknowledged as soon as they are placed in
+--!	the buffer, and are written to memory in order while the processor keeps
+--!	running. A store that writes all of the bytes written by the most recently
+--!	buffered store replaces it, unless that store is already being written to
+--!	memory. Loads are passed on to memory ahead of buffered stores to other
+--!	words. Loads from words with buffered stores get their data from the most
+--!	recent of these stores when it contains all of the loaded bytes; otherwise
+--!	the load waits until the stores to the word have been written to memory.
+--!	Accesses crossing a word boundary are treated as accessing both words and
+--!	are never forwarded or replaced.
+--!	Accesses to addresses where (address and UNCACHED_MASK) = UNCACHED_BASE,
+--!	such as peripherals, are kept in program order: stores to these addresses
+--!	never replace buffered stores, and loads from them wait until the buffer
+--!	is empty and are never forwarded.
+--!	The buffer signals when it is empty, so that the processor can wait for
+--!	all buffered stores to be written to memory before continuing.
+entity pp_store_buffer is
+	generic(
+		DEPTH         : positive := 4; --! Number of stores that can be buffered.
+		UNCACHED_MASK : std_logic_vector(31 downto 0) := x"ffff0000"; --! Address bits compared to UNCACHED_BASE.
+		UNCACHED_BASE : std_logic_vector(31 downto 0) := x"c0000000"  --! Base address of the address space accessed in order.
+	);
+	port(
+		clk   : in std_logic;
+		reset : in std_logic;
+
+		-- Processor data memory signals:
+		mem_address   : in  std_logic_vector(31 downto 0);
+		mem_data_in   : in  std_logic_vector(31 downto 0); -- Data in from the processor
+		mem_data_out  : out std_logic_vector(31 downto 0); -- Data out to the processor
+		mem_data_size : in  std_logic_vector( 1 downto 0);
+		mem_read_req  : in  std_logic;
+		mem_read_ack  : out std_logic;
+		mem_write_req : in  std_logic;
+		mem_write_ack : out std_logic;
+
+		empty : out std_logic; --! Set when no stores are buffered.
+
+		-- Signals to the memory interface:
+		bus_address   : out std_logic_vector(31 downto 0);
+		bus_data_out  : out std_logic_vector(31 downto 0); -- Data out to the memory interface
+		bus_data_in   : in  std_logic_vector(31 downto 0); -- Data in from the memory interface
+		bus_data_size : out std_logic_vector( 1 downto 0);
+		bus_read_req  : out std_logic;
+		bus_read_ack  : in  std_logic;
+		bus_write_req : out std_logic;
+		bus_write_ack : in  std_logic
+	);
+end entity pp_store_buffer;
+
+architecture behaviour of pp_store_buffer is
+
+	type word_array is array(0 to DEPTH - 1) of std_logic_vector(31 downto 0);
+	type size_array is array(0 to DEPTH - 1) of std_logic_vector(1 downto 0);
+	subtype buffer_index_type is natural range 0 to DEPTH - 1;
+
+	-- Buffered stores:
+	signal address_buffer, data_buffer : word_array;
+	signal size_buffer : size_array;
+
+	signal head, tail, youngest : buffer_index_type;
+	signal count : natural range 0 to DEPTH;
+
+	-- Store handling signals:
+	signal store_accepted, store_replace : std_logic;
+	signal store_ack : std_logic;
+
+	-- Load handling signals:
+	signal load_match, load_forward : std_logic;
+	signal forward_data : std_logic_vector(31 downto 0);
+	signal load_forwarded : std_logic;
+	signal load_forwarded_data : std_logic_vector(31 downto 0);
+	signal load_to_memory : std_logic;
+
+	-- Set when the current access is to the uncached address space:
+	signal uncached : std_logic;
+
+	--! Increments an index into the buffer.
+	function next_index(index : in buffer_index_type) return buffer_index_type is
+	begin
+		if index = DEPTH - 1 then
+			return 0;
+		else
+			return index + 1;
+		end if;
+	end function next_index;
+
+begin
+
+	youngest <= DEPTH - 1 when tail = 0 else tail - 1;
+
+	uncached <= to_std_logic((mem_address and UNCACHED_MASK) = UNCACHED_BASE);
+
+	empty <= '1' when count = 0 else '0';
+
+	mem_write_ack <= store_ack;
+	mem_read_ack <= load_forwarded or bus_read_ack;
+	mem_data_out <= load_forwarded_data when load_forwarded = '1' else bus_data_in;
+
+	-- A store replaces the youngest buffered store if it writes all of the same bytes and the
+	-- youngest store is not the one currently being written to memory:
+	store_replace <= '1' when count > 1 and uncached = '0' and address_buffer(youngest)(31 downto 2) = mem_address(31 downto 2)
+			and not wb_access_crosses_word(size_buffer(youngest), address_buffer(youngest))
+			and not wb_access_crosses_word(mem_data_size, mem_address)
+			and (wb_get_data_sel(size_buffer(youngest), address_buffer(youngest))
+				and not wb_get_data_sel(mem_data_size, mem_address)) = b"0000"
+		else '0';
+	store_accepted <= mem_write_req and (store_replace or to_std_logic(count /= DEPTH));
+
+	-- Loads go directly to memory unless a store to the same word is buffered. Loads from the uncached
+	-- address space wait until all buffered stores have been written:
+	load_to_memory <= mem_read_req and not load_match and not (uncached and to_std_logic(count /= 0));
+
+	bus_address <= mem_address when load_to_memory = '1' else address_buffer(head);
+	bus_data_size <= mem_data_size when load_to_memory = '1' else size_buffer(head);
+	bus_data_out <= data_buffer(head);
+	bus_read_req <= load_to_memory;
+	-- The store at the head of the buffer is removed when it is acknowledged, so it is not requested
+	-- again while the acknowledgement is received:
+	bus_write_req <= to_std_logic(count /= 0) and not load_to_memory and not bus_write_ack;
+
+	find_load_data: process(head, count, address_buffer, data_buffer, size_buffer, mem_address, mem_data_size, uncached)
+		variable index : buffer_index_type;
+		variable load_word, store_word_address : unsigned(29 downto 0);
+		variable load_crosses, store_crosses : boolean;
+		variable match : std_logic;
+		variable store_sel, load_sel : std_logic_vector(3 downto 0);
+		variable store_word : std_logic_vector(31 downto 0);
+	begin
+		match := '0';
+		store_sel := (others => '0');
+		store_word := (others => '0');
+		load_sel := wb_get_data_sel(mem_data_size, mem_address);
+		load_word := unsigned(mem_address(31 downto 2));
+		load_crosses := wb_access_crosses_word(mem_data_size, mem_address);
+
+		-- Find the most recent store to the same word as the load:
+		index := head;
+		for i in 0 to DEPTH - 1 loop
+			store_word_address := unsigned(address_buffer(index)(31 downto 2));
+			store_crosses := wb_access_crosses_word(size_buffer(index), address_buffer(index));
+
+			if i < count and (store_word_address = load_word
+				or (store_crosses and store_word_address + 1 = load_word)
+				or (load_crosses and load_word + 1 = store_word_address))
+			then
+				match := '1';
+				if store_crosses or store_word_address /= load_word then
+					store_sel := b"0000";
+				else
+					store_sel := wb_get_data_sel(size_buffer(index), address_buffer(index));
+				end if;
+				store_word := std_logic_vector(shift_left(unsigned(data_buffer(index)),
+					wb_get_data_shift(size_buffer(index), address_buffer(index))));
+			end if;
+			index := next_index(index);
+		end loop;
+
+		load_match <= match;
+		load_forward <= match and not uncached and to_std_logic((store_sel and load_sel) = load_sel and not load_crosses);
+		forward_data <= std_logic_vector(shift_right(unsigned(store_word),
+			wb_get_data_shift(mem_data_size, mem_address)));
+	end process find_load_data;
+
+	forward_load: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				load_forwarded <= '0';
+			else
+				load_forwarded <= mem_read_req and load_forward;
+				load_forwarded_data <= forward_data;
+			end if;
+		end if;
+	end process forward_load;
+
+	update_buffer: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				head <= 0;
+				tail <= 0;
+				count <= 0;
+				store_ack <= '0';
+			else
+				store_ack <= store_accepted;
+
+				if store_accepted = '1' then
+					if store_replace = '1' then
+						address_buffer(youngest) <= mem_address;
+						data_buffer(youngest) <= mem_data_in;
+						size_buffer(youngest) <= mem_data_size;
+					else
+						address_buffer(tail) <= mem_address;
+						data_buffer(tail) <= mem_data_in;
+						size_buffer(tail) <= mem_data_size;
+						tail <= next_index(tail);
+					end if;
+				end if;
+
+				if bus_write_ack = '1' then
+					head <= next_index(head);
+				end if;
+
+				if store_accepted = '1' and store_replace = '0' and bus_write_ack = '0' then
+					count <= count + 1;
+				elsif (store_accepted = '0' or store_replace = '1') and bus_write_ack = '1' then
+					count <= count - 1;
+				end if;
+			end if;
+		end if;
+	end process update_buffer;
+
+end architecture behaviour;
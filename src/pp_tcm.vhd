@@ -0,0 +1,148 @@
+-- The Potato Processor - A simple processor for FPGAs
+-- (c) Kristian Klomsten Skordal 2014 - 2015 <kristian.skordal@wafflemail.net>
+-- Report bugs and issues on <https://github.com/skordal/potato/issues>
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.pp_utilities.all;
+
+--! @brief Tightly-coupled memory.
+--! @details
+--!	Memory connected directly to the instruction and data memory interfaces of the
+--!	processor core, without going through the caches or the Wishbone bus. Requests
+--!	are acknowledged in the cycle after they are made, the same as cache hits, so
+--!	that accesses complete without wait states. The instruction port is read-only;
+--!	instructions are loaded into the memory using the data port.
+--!
+--!	When misaligned accesses are enabled, accesses crossing a word boundary take
+--!	an additional cycle, one for each word.
+entity pp_tcm is
+	generic(
+		MEMORY_SIZE       : natural := 4096; --! Memory size in bytes, must be a power of two.
+		MISALIGNED_ACCESS : boolean := false --! Whether to handle accesses crossing word boundaries.
+	);
+	port(
+		clk   : in std_logic;
+		reset : in std_logic;
+
+		-- Instruction port:
+		imem_address  : in  std_logic_vector(31 downto 0);
+		imem_data_out : out std_logic_vector(31 downto 0);
+		imem_req      : in  std_logic;
+		imem_ack      : out std_logic;
+
+		-- Data port:
+		dmem_address   : in  std_logic_vector(31 downto 0);
+		dmem_data_in   : in  std_logic_vector(31 downto 0); -- Data in from the processor
+		dmem_data_out  : out std_logic_vector(31 downto 0); -- Data out to the processor
+		dmem_data_size : in  std_logic_vector( 1 downto 0);
+		dmem_read_req  : in  std_logic;
+		dmem_read_ack  : out std_logic;
+		dmem_write_req : in  std_logic;
+		dmem_write_ack : out std_logic
+	);
+end entity pp_tcm;
+
+architecture behaviour of pp_tcm is
+
+	type memory_array is array(0 to (MEMORY_SIZE / 4) - 1) of std_logic_vector(31 downto 0);
+	signal memory : memory_array := (others => (others => '0'));
+
+	attribute ram_style : string;
+	attribute ram_style of memory : signal is "block";
+
+	-- Word addresses:
+	signal imem_word, dmem_word, dmem_next_word : natural range 0 to (MEMORY_SIZE / 4) - 1;
+
+	-- Signals used when splitting accesses crossing word boundaries:
+	signal split_active : std_logic; -- Set while the second word of an access is accessed
+	signal first_word   : std_logic_vector(31 downto 0);
+
+	--! Writes the selected bytes of a word in the memory.
+	procedure write_word(signal mem : inout memory_array; index : in natural;
+		data : in std_logic_vector(31 downto 0); sel : in std_logic_vector(3 downto 0)) is
+	begin
+		for i in 0 to 3 loop
+			if sel(i) = '1' then
+				mem(index)(i * 8 + 7 downto i * 8) <= data(i * 8 + 7 downto i * 8);
+			end if;
+		end loop;
+	end procedure write_word;
+
+begin
+
+	imem_word <= to_integer(unsigned(imem_address(log2(MEMORY_SIZE) - 1 downto 2)));
+	dmem_word <= to_integer(unsigned(dmem_address(log2(MEMORY_SIZE) - 1 downto 2)));
+	dmem_next_word <= (dmem_word + 1) mod (MEMORY_SIZE / 4);
+
+	instruction_port: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				imem_ack <= '0';
+			else
+				imem_data_out <= memory(imem_word);
+				imem_ack <= imem_req;
+			end if;
+		end if;
+	end process instruction_port;
+
+	data_port: process(clk)
+		variable split : boolean;
+		variable sel : std_logic_vector(7 downto 0);
+		variable read_data : std_logic_vector(63 downto 0);
+	begin
+		if rising_edge(clk) then
+			if reset = '1' then
+				dmem_read_ack <= '0';
+				dmem_write_ack <= '0';
+				split_active <= '0';
+			else
+				split := MISALIGNED_ACCESS and wb_access_crosses_word(dmem_data_size, dmem_address);
+				sel := wb_get_split_sel(dmem_data_size, dmem_address);
+
+				dmem_read_ack <= '0';
+				dmem_write_ack <= '0';
+
+				if split_active = '1' then
+					-- The request is held while the second word is accessed:
+					if dmem_write_req = '1' then
+						write_word(memory, dmem_next_word, std_logic_vector(shift_right(unsigned(dmem_data_in),
+							32 - 8 * to_integer(unsigned(dmem_address(1 downto 0))))), sel(7 downto 4));
+						dmem_write_ack <= '1';
+					else
+						read_data := memory(dmem_next_word) & first_word;
+						read_data := std_logic_vector(shift_right(unsigned(read_data),
+							8 * to_integer(unsigned(dmem_address(1 downto 0)))));
+						dmem_data_out <= read_data(31 downto 0);
+						dmem_read_ack <= '1';
+					end if;
+					split_active <= '0';
+				elsif dmem_write_req = '1' then
+					if split then
+						write_word(memory, dmem_word, std_logic_vector(shift_left(unsigned(dmem_data_in),
+							8 * to_integer(unsigned(dmem_address(1 downto 0))))), sel(3 downto 0));
+						split_active <= '1';
+					else
+						write_word(memory, dmem_word, std_logic_vector(shift_left(unsigned(dmem_data_in),
+							wb_get_data_shift(dmem_data_size, dmem_address))),
+							wb_get_data_sel(dmem_data_size, dmem_address));
+						dmem_write_ack <= '1';
+					end if;
+				elsif dmem_read_req = '1' then
+					if split then
+						first_word <= memory(dmem_word);
+						split_active <= '1';
+					else
+						dmem_data_out <= std_logic_vector(shift_right(unsigned(memory(dmem_word)),
+							wb_get_data_shift(dmem_data_size, dmem_address)));
+						dmem_read_ack <= '1';
+					end if;
+				end if;
+			end if;
+		end if;
+	end process data_port;
+
+end architecture behaviour;
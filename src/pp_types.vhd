@@ -16,6 +16,16 @@ package pp_types is
 			ALU_SLT, ALU_SLTU,
 			ALU_ADD, ALU_SUB,
 			ALU_SRL, ALU_SLL, ALU_SRA,
+			ALU_MUL, ALU_MULH, ALU_MULHSU, ALU_MULHU,
+			ALU_DIV, ALU_DIVU, ALU_REM, ALU_REMU,
+			ALU_ANDN, ALU_ORN, ALU_XNOR,
+			ALU_CLZ, ALU_CTZ, ALU_CPOP,
+			ALU_MIN, ALU_MINU, ALU_MAX, ALU_MAXU,
+			ALU_SEXTB, ALU_SEXTH,
+			ALU_ROL, ALU_ROR,
+			ALU_REV8, ALU_ORCB, ALU_BREV8,
+			ALU_PACK, ALU_PACKH, ALU_ZIP, ALU_UNZIP,
+			ALU_SHA256SUM0, ALU_SHA256SUM1, ALU_SHA256SIG0, ALU_SHA256SIG1,
 			ALU_NOP, ALU_INVALID
 		);
 
@@ -50,12 +60,40 @@ package pp_types is
 			stb : std_logic;
 			we  : std_logic;
 			dat : std_logic_vector(31 downto 0);
+			cti : std_logic_vector( 2 downto 0);
+			bte : std_logic_vector( 1 downto 0);
 		end record; 
 
 	--! Wishbone master input signals:
 	type wishbone_master_inputs is record
 			dat : std_logic_vector(31 downto 0);
 			ack : std_logic;
+			stall : std_logic; -- Only used in pipelined mode
+		end record;
+
+	--! Arrays of Wishbone master signals, used for interconnects with several masters or slaves:
+	type wishbone_master_outputs_array is array(natural range <>) of wishbone_master_outputs;
+	type wishbone_master_inputs_array is array(natural range <>) of wishbone_master_inputs;
+
+	--! Address range of a Wishbone slave, containing the addresses for which (address and mask) = base:
+	type wb_address_range is record
+			base : std_logic_vector(31 downto 0);
+			mask : std_logic_vector(31 downto 0);
+		end record;
+
+	--! Address map of an interconnect, with one address range for each slave:
+	type wb_address_map is array(natural range <>) of wb_address_range;
+
+	--! Policies used by the Wishbone arbiter to select a master when both request the bus.
+	type wb_arbiter_policy is (
+			ARBITER_FIXED_PRIORITY, ARBITER_ROUND_ROBIN, ARBITER_WEIGHTED
+		);
+
+	--! State of the return address stack before an instruction updated it, kept for instructions in the
+	--! fetch queue so that the stack can be restored when they are flushed:
+	type ras_checkpoint is record
+			pointer : natural;                       --! Stack pointer.
+			top     : std_logic_vector(31 downto 0); --! Entry at the top of the stack.
 		end record;
 
 	--! State of the currently running test:
@@ -67,6 +105,25 @@ package pp_types is
 			number : std_logic_vector(29 downto 0);
 		end record;
 
+	--! Performance events from the processor core, each signal is asserted for one cycle per event:
+	type performance_events is record
+			instruction_retired    : std_logic; --! An instruction was retired.
+			branch_resolved        : std_logic; --! A branch or jump instruction was resolved in the execute stage.
+			branch_taken           : std_logic; --! A resolved branch or jump was taken.
+			branch_predicted_taken : std_logic; --! A resolved branch or jump was taken and correctly predicted.
+			branch_mispredicted    : std_logic; --! The pipeline was flushed because of a mispredicted branch or jump.
+			frontend_stall         : std_logic; --! The decode stage could accept an instruction, but none was available.
+			backend_stall          : std_logic; --! The decode stage could not accept an instruction because the pipeline was stalled.
+		end record;
+
+	--! Performance events from the caches, each signal is asserted for one cycle per event:
+	type cache_performance_events is record
+			icache_hit  : std_logic; --! An instruction fetch hit in the instruction cache.
+			icache_miss : std_logic; --! An instruction fetch missed in the instruction cache and a line was loaded.
+			icache_prefetch_useful  : std_logic; --! A prefetched instruction cache line was used.
+			icache_prefetch_useless : std_logic; --! A prefetched instruction cache line was discarded without being used.
+		end record;
+
 	--! Converts a test context to an std_logic_vector:
 	function test_context_to_std_logic(input : in test_context) return std_logic_vector;
 
@@ -4,6 +4,7 @@
 
 library ieee;
 use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
 
 use work.pp_types.all;
 use work.pp_constants.all;
@@ -19,11 +20,42 @@ package pp_utilities is
 	--! Calculates log2 with integers.
 	function log2(input : in natural) return natural;
 
+	--! Checks if a register is used as a link register by the calling convention (ra or t0).
+	function is_link_register(input : in register_address) return boolean;
+
+	--! Sign- or zero-extends data loaded from memory according to the type and size of the load.
+	function extend_load_data(data : in std_logic_vector(31 downto 0); mem_op : in memory_operation_type;
+		mem_size : in memory_operation_size) return std_logic_vector;
+
 	-- Gets the value of the sel signals to the wishbone interconnect for the specified
 	-- operand size and address.
 	function wb_get_data_sel(size : in std_logic_vector(1 downto 0); address : in std_logic_vector)
 		return std_logic_vector;
 
+	-- Gets the number of bits data must be shifted to place it on the correct byte lanes of
+	-- the wishbone interconnect for the specified operand size and address.
+	function wb_get_data_shift(size : in std_logic_vector(1 downto 0); address : in std_logic_vector)
+		return natural;
+
+	-- Checks if an access of the specified operand size and address crosses a word boundary,
+	-- which requires it to be split into two accesses on the wishbone interconnect.
+	function wb_access_crosses_word(size : in std_logic_vector(1 downto 0); address : in std_logic_vector)
+		return boolean;
+
+	-- Gets the byte lanes used by an access crossing a word boundary, the lower four bits
+	-- are used in the first word and the upper four bits in the second word.
+	function wb_get_split_sel(size : in std_logic_vector(1 downto 0); address : in std_logic_vector)
+		return std_logic_vector;
+
+	-- Gets the burst type extension for a wrapping burst of the specified number of words,
+	-- or a linear burst if there is no wrapping burst of that length.
+	function wb_get_burst_bte(words : in natural) return std_logic_vector;
+
+	-- Gets the address of the next transfer of an incrementing burst, wrapping around
+	-- at the boundary given by the burst type extension.
+	function wb_get_burst_next_address(address : in std_logic_vector; bte : in std_logic_vector(1 downto 0))
+		return std_logic_vector;
+
 end package pp_utilities;
 
 package body pp_utilities is
@@ -63,6 +95,32 @@ package body pp_utilities is
 		return retval;
 	end function log2;
 
+	function is_link_register(input : in register_address) return boolean is
+	begin
+		return input = b"00001" or input = b"00101";
+	end function is_link_register;
+
+	function extend_load_data(data : in std_logic_vector(31 downto 0); mem_op : in memory_operation_type;
+		mem_size : in memory_operation_size) return std_logic_vector is
+	begin
+		case mem_size is
+			when MEMOP_SIZE_BYTE =>
+				if mem_op = MEMOP_TYPE_LOAD_UNSIGNED then
+					return std_logic_vector(resize(unsigned(data(7 downto 0)), 32));
+				else
+					return std_logic_vector(resize(signed(data(7 downto 0)), 32));
+				end if;
+			when MEMOP_SIZE_HALFWORD =>
+				if mem_op = MEMOP_TYPE_LOAD_UNSIGNED then
+					return std_logic_vector(resize(unsigned(data(15 downto 0)), 32));
+				else
+					return std_logic_vector(resize(signed(data(15 downto 0)), 32));
+				end if;
+			when MEMOP_SIZE_WORD =>
+				return data;
+		end case;
+	end function extend_load_data;
+
 	function wb_get_data_sel(size : in std_logic_vector(1 downto 0); address : in std_logic_vector)
 		return std_logic_vector is
 	begin
@@ -81,14 +139,111 @@ package body pp_utilities is
 						return b"0001";
 				end case;
 			when b"10" =>
-				if address(1) = '0' then
-					return b"0011";
-				else
-					return b"1100";
-				end if;
+				case address(1 downto 0) is
+					when b"00" =>
+						return b"0011";
+					when b"01" =>
+						return b"0110";
+					when others =>
+						return b"1100";
+				end case;
 			when others =>
 				return b"1111";
 		end case;
 	end function wb_get_data_sel;
 
+	function wb_get_data_shift(size : in std_logic_vector(1 downto 0); address : in std_logic_vector)
+		return natural is
+	begin
+		case size is
+			when b"01" =>
+				case address(1 downto 0) is
+					when b"00" =>
+						return 0;
+					when b"01" =>
+						return 8;
+					when b"10" =>
+						return 16;
+					when b"11" =>
+						return 24;
+					when others =>
+						return 0;
+				end case;
+			when b"10" =>
+				case address(1 downto 0) is
+					when b"00" =>
+						return 0;
+					when b"01" =>
+						return 8;
+					when others =>
+						return 16;
+				end case;
+			when others =>
+				return 0;
+		end case;
+	end function wb_get_data_shift;
+
+	function wb_access_crosses_word(size : in std_logic_vector(1 downto 0); address : in std_logic_vector)
+		return boolean is
+	begin
+		case size is
+			when b"01" =>
+				return false;
+			when b"10" =>
+				return address(1 downto 0) = b"11";
+			when others =>
+				return address(1 downto 0) /= b"00";
+		end case;
+	end function wb_access_crosses_word;
+
+	function wb_get_split_sel(size : in std_logic_vector(1 downto 0); address : in std_logic_vector)
+		return std_logic_vector is
+		variable mask : unsigned(7 downto 0);
+	begin
+		if size = b"10" then
+			mask := x"03";
+		else
+			mask := x"0f";
+		end if;
+		return std_logic_vector(shift_left(mask, to_integer(unsigned(address(1 downto 0)))));
+	end function wb_get_split_sel;
+
+	function wb_get_burst_bte(words : in natural) return std_logic_vector is
+	begin
+		case words is
+			when 4 =>
+				return WB_BTE_WRAP4;
+			when 8 =>
+				return WB_BTE_WRAP8;
+			when 16 =>
+				return WB_BTE_WRAP16;
+			when others =>
+				return WB_BTE_LINEAR;
+		end case;
+	end function wb_get_burst_bte;
+
+	function wb_get_burst_next_address(address : in std_logic_vector; bte : in std_logic_vector(1 downto 0))
+		return std_logic_vector is
+		variable retval : std_logic_vector(address'length - 1 downto 0) := address;
+		variable high   : natural;
+	begin
+		case bte is
+			when WB_BTE_WRAP4 =>
+				high := 3;
+			when WB_BTE_WRAP8 =>
+				high := 4;
+			when WB_BTE_WRAP16 =>
+				high := 5;
+			when others =>
+				high := retval'left;
+		end case;
+
+		if high > retval'left then
+			high := retval'left;
+		end if;
+
+		retval(high downto 2) := std_logic_vector(unsigned(retval(high downto 2)) + 1);
+		return retval;
+	end function wb_get_burst_next_address;
+
 end package body pp_utilities;
@@ -7,10 +7,31 @@ use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
 use work.pp_types.all;
+use work.pp_constants.all;
 use work.pp_utilities.all;
 
 --! @brief Wishbone adapter, for connecting the processor to a Wishbone bus when not using caches.
+--! @details
+--!	When misaligned accesses are enabled, accesses that cross a word boundary
+--!	are split into two Wishbone transactions, one for each word. The bus cycle
+--!	is held between the two transactions so that the access is not interrupted
+--!	by other bus masters.
+--!
+--!	In pipelined mode, Wishbone B4 pipelined cycles are used. A request from the
+--!	processor is put on the bus in the same cycle as it is made, and a new request
+--!	can be made in every cycle the slave does not stall. The bus cycle is kept as
+--!	long as requests are outstanding. Stores are acknowledged to the processor in
+--!	the cycle after the slave accepts them, and loads when the slave acknowledges
+--!	them, so that a stream of accesses to a slave acknowledging in the cycle after
+--!	each request completes one access per cycle. Slaves must not acknowledge
+--!	requests in the same cycle as they are made. As stores are acknowledged
+--!	before they have been completed, the idle output can be used to find when
+--!	all accesses have been completed.
 entity pp_wb_adapter is
+	generic(
+		MISALIGNED_ACCESS : boolean := false; --! Whether to split accesses crossing word boundaries.
+		PIPELINED         : boolean := false  --! Whether to use pipelined Wishbone cycles.
+	);
 	port(
 		clk   : in std_logic;
 		reset : in std_logic;
@@ -25,6 +46,8 @@ entity pp_wb_adapter is
 		signal mem_write_req : in  std_logic;
 		signal mem_write_ack : out std_logic;
 
+		idle : out std_logic; --! Set when no accesses are in progress on the bus.
+
 		-- Wishbone interface:
 		wb_inputs  : in wishbone_master_inputs;
 		wb_outputs : out wishbone_master_outputs
@@ -33,94 +56,274 @@ end entity pp_wb_adapter;
 
 architecture behaviour of pp_wb_adapter is
 
-	type states is (IDLE, READ_WAIT_ACK, WRITE_WAIT_ACK);
+	type states is (IDLE, READ_WAIT_ACK, WRITE_WAIT_ACK, READ_NEXT_WORD, WRITE_NEXT_WORD);
 	signal state : states;
 
 	signal mem_r_ack : std_logic;
 
-	function get_data_shift(size : in std_logic_vector(1 downto 0); address : in std_logic_vector)
-		return natural is
-	begin
-		case size is
-			when b"01" =>
-				case address(1 downto 0) is
-					when b"00" =>
-						return 0;
-					when b"01" =>
-						return 8;
-					when b"10" =>
-						return 16;
-					when b"11" =>
-						return 24;
-					when others =>
-						return 0;
-				end case;
-			when b"10" =>
-				if address(1) = '0' then
-					return 0;
+	-- Signals used when splitting accesses crossing word boundaries:
+	signal split_pending : std_logic; -- Set while the first of two transactions is running
+	signal split_active  : std_logic; -- Set while the second of two transactions is running
+	signal split_address : std_logic_vector(31 downto 0);
+	signal split_sel     : std_logic_vector( 3 downto 0);
+	signal split_data    : std_logic_vector(31 downto 0);
+	signal first_word    : std_logic_vector(31 downto 0);
+
+begin
+
+	-- Bursts are not used:
+	wb_outputs.cti <= WB_CTI_CLASSIC;
+	wb_outputs.bte <= WB_BTE_LINEAR;
+
+	classic_mode: if not PIPELINED
+	generate
+		mem_write_ack <= '1' when state = WRITE_WAIT_ACK and wb_inputs.ack = '1' and split_pending = '0' else '0';
+		mem_read_ack <= mem_r_ack;
+		idle <= to_std_logic(state = IDLE);
+
+		wishbone: process(clk)
+			variable split : boolean;
+			variable sel : std_logic_vector(7 downto 0);
+			variable read_data : std_logic_vector(63 downto 0);
+		begin
+			if rising_edge(clk) then
+				if reset = '1' then
+					state <= IDLE;
+					wb_outputs.cyc <= '0';
+					wb_outputs.stb <= '0';
+					mem_r_ack <= '0';
+					split_pending <= '0';
+					split_active <= '0';
 				else
-					return 16;
+					case state is
+						when IDLE =>
+							mem_r_ack <= '0';
+
+							split := MISALIGNED_ACCESS and wb_access_crosses_word(mem_data_size, mem_address);
+							sel := wb_get_split_sel(mem_data_size, mem_address);
+							split_address <= std_logic_vector(unsigned(mem_address(31 downto 2)) + 1) & b"00";
+							split_sel <= sel(7 downto 4);
+							split_data <= std_logic_vector(shift_right(unsigned(mem_data_in),
+								32 - 8 * to_integer(unsigned(mem_address(1 downto 0)))));
+							split_pending <= to_std_logic(split);
+							split_active <= '0';
+
+							-- Prioritize requests from the data memory:
+							if mem_write_req = '1' then
+								wb_outputs.adr <= mem_address;
+								if split then
+									wb_outputs.dat <= std_logic_vector(shift_left(unsigned(mem_data_in),
+										8 * to_integer(unsigned(mem_address(1 downto 0)))));
+									wb_outputs.sel <= sel(3 downto 0);
+								else
+									wb_outputs.dat <= std_logic_vector(shift_left(unsigned(mem_data_in),
+										wb_get_data_shift(mem_data_size, mem_address)));
+									wb_outputs.sel <= wb_get_data_sel(mem_data_size, mem_address);
+								end if;
+								wb_outputs.cyc <= '1';
+								wb_outputs.stb <= '1';
+								wb_outputs.we <= '1';
+								state <= WRITE_WAIT_ACK;
+							elsif mem_read_req = '1' then
+								wb_outputs.adr <= mem_address;
+								if split then
+									wb_outputs.sel <= sel(3 downto 0);
+								else
+									wb_outputs.sel <= wb_get_data_sel(mem_data_size, mem_address);
+								end if;
+								wb_outputs.cyc <= '1';
+								wb_outputs.stb <= '1';
+								wb_outputs.we <= '0';
+								state <= READ_WAIT_ACK;
+							end if;
+						when READ_WAIT_ACK =>
+							if wb_inputs.ack = '1' then
+								if split_pending = '1' then
+									first_word <= wb_inputs.dat;
+									wb_outputs.adr <= split_address;
+									wb_outputs.sel <= split_sel;
+									wb_outputs.stb <= '0';
+									split_pending <= '0';
+									split_active <= '1';
+									state <= READ_NEXT_WORD;
+								else
+									if split_active = '1' then
+										read_data := wb_inputs.dat & first_word;
+										read_data := std_logic_vector(shift_right(unsigned(read_data),
+											8 * to_integer(unsigned(mem_address(1 downto 0)))));
+										mem_data_out <= read_data(31 downto 0);
+									else
+										mem_data_out <= std_logic_vector(shift_right(unsigned(wb_inputs.dat),
+											wb_get_data_shift(mem_data_size, mem_address)));
+									end if;
+									wb_outputs.cyc <= '0';
+									wb_outputs.stb <= '0';
+									mem_r_ack <= '1';
+									state <= IDLE;
+								end if;
+							end if;
+						when WRITE_WAIT_ACK =>
+							if wb_inputs.ack = '1' then
+								if split_pending = '1' then
+									wb_outputs.adr <= split_address;
+									wb_outputs.sel <= split_sel;
+									wb_outputs.dat <= split_data;
+									wb_outputs.stb <= '0';
+									split_pending <= '0';
+									split_active <= '1';
+									state <= WRITE_NEXT_WORD;
+								else
+									wb_outputs.cyc <= '0';
+									wb_outputs.stb <= '0';
+									wb_outputs.we <= '0';
+									state <= IDLE;
+								end if;
+							end if;
+						when READ_NEXT_WORD =>
+							-- The bus cycle is kept while the second word is requested:
+							wb_outputs.stb <= '1';
+							state <= READ_WAIT_ACK;
+						when WRITE_NEXT_WORD =>
+							wb_outputs.stb <= '1';
+							state <= WRITE_WAIT_ACK;
+					end case;
 				end if;
-			when others =>
-				return 0;
-		end case;
-	end function get_data_shift;
+			end if;
+		end process wishbone;
+	end generate classic_mode;
 
-begin
+	pipelined_mode: if PIPELINED
+	generate
+		-- Maximum number of requests waiting for acknowledgement:
+		constant MAX_OUTSTANDING : natural := 4;
 
-	mem_write_ack <= '1' when state = WRITE_WAIT_ACK and wb_inputs.ack = '1' else '0';
-	mem_read_ack <= mem_r_ack;
+		signal outstanding : natural range 0 to MAX_OUTSTANDING;
 
-	wishbone: process(clk)
+		signal new_request : std_logic; -- Set when a request from the processor is put on the bus
+		signal accepted    : std_logic; -- Set when the slave accepts the request on the bus
+		signal split       : boolean;   -- Set when the request from the processor crosses a word boundary
+		signal split_issue : std_logic; -- Set while the second word of a split access is requested
+		signal split_we    : std_logic;
+
+		-- Loads waiting for data:
+		signal read_pending : std_logic;
+		signal read_done    : std_logic;
+		signal read_split   : std_logic;
+		signal read_size    : std_logic_vector(1 downto 0);
+		signal read_address : std_logic_vector(1 downto 0);
+		signal first_ack    : std_logic;
+
+		signal mem_w_ack : std_logic;
 	begin
-		if rising_edge(clk) then
-			if reset = '1' then
-				state <= IDLE;
-				wb_outputs.cyc <= '0';
-				wb_outputs.stb <= '0';
-				mem_r_ack <= '0';
+		split <= MISALIGNED_ACCESS and wb_access_crosses_word(mem_data_size, mem_address);
+
+		-- Nothing is requested after a load until its data has been received, so the last acknowledge
+		-- belongs to the load. Requests are held by the processor until they are acknowledged, so new
+		-- requests are not accepted while a load or the second word of a split access is pending:
+		read_done <= wb_inputs.ack and read_pending and to_std_logic(outstanding = 1) and not split_issue;
+		first_ack <= wb_inputs.ack and read_pending and read_split
+			and to_std_logic((outstanding = 2 and split_issue = '0') or (outstanding = 1 and split_issue = '1'));
+		-- A split access needs room for both of its requests:
+		new_request <= (mem_read_req or mem_write_req) and not split_issue and (not read_pending or read_done)
+			and to_std_logic(outstanding < MAX_OUTSTANDING - 1 or (not split and outstanding /= MAX_OUTSTANDING));
+		accepted <= (new_request or split_issue) and not wb_inputs.stall;
+
+		mem_read_ack <= read_done;
+		mem_write_ack <= mem_w_ack;
+		idle <= to_std_logic(outstanding = 0) and not split_issue;
+
+		wb_outputs.cyc <= new_request or split_issue or to_std_logic(outstanding /= 0);
+		wb_outputs.stb <= new_request or split_issue;
+
+		request: process(split_issue, split_address, split_sel, split_data, split_we, split,
+			mem_address, mem_data_in, mem_data_size, mem_write_req)
+			variable sel : std_logic_vector(7 downto 0);
+		begin
+			if split_issue = '1' then
+				wb_outputs.adr <= split_address;
+				wb_outputs.sel <= split_sel;
+				wb_outputs.dat <= split_data;
+				wb_outputs.we <= split_we;
 			else
-				case state is
-					when IDLE =>
-						mem_r_ack <= '0';
+				sel := wb_get_split_sel(mem_data_size, mem_address);
+				wb_outputs.adr <= mem_address;
+				if split then
+					wb_outputs.sel <= sel(3 downto 0);
+					wb_outputs.dat <= std_logic_vector(shift_left(unsigned(mem_data_in),
+						8 * to_integer(unsigned(mem_address(1 downto 0)))));
+				else
+					wb_outputs.sel <= wb_get_data_sel(mem_data_size, mem_address);
+					wb_outputs.dat <= std_logic_vector(shift_left(unsigned(mem_data_in),
+						wb_get_data_shift(mem_data_size, mem_address)));
+				end if;
+				wb_outputs.we <= mem_write_req;
+			end if;
+		end process request;
 
-						-- Prioritize requests from the data memory:
-						if mem_write_req = '1' then
-							wb_outputs.adr <= mem_address;
-							wb_outputs.dat <= std_logic_vector(shift_left(unsigned(mem_data_in),
-								get_data_shift(mem_data_size, mem_address)));
-							wb_outputs.sel <= wb_get_data_sel(mem_data_size, mem_address);
-							wb_outputs.cyc <= '1';
-							wb_outputs.stb <= '1';
-							wb_outputs.we <= '1';
-							state <= WRITE_WAIT_ACK;
-						elsif mem_read_req = '1' then
-							wb_outputs.adr <= mem_address;
-							wb_outputs.sel <= wb_get_data_sel(mem_data_size, mem_address);
-							wb_outputs.cyc <= '1';
-							wb_outputs.stb <= '1';
-							wb_outputs.we <= '0';
-							state <= READ_WAIT_ACK;
-						end if;
-					when READ_WAIT_ACK =>
-						if wb_inputs.ack = '1' then
-							mem_data_out <= std_logic_vector(shift_right(unsigned(wb_inputs.dat),
-								get_data_shift(mem_data_size, mem_address)));
-							wb_outputs.cyc <= '0';
-							wb_outputs.stb <= '0';
-							mem_r_ack <= '1';
-							state <= IDLE;
+		read_data: process(wb_inputs.dat, first_word, read_split, read_size, read_address)
+			variable data : std_logic_vector(63 downto 0);
+		begin
+			if read_split = '1' then
+				data := std_logic_vector(shift_right(unsigned(wb_inputs.dat & first_word),
+					8 * to_integer(unsigned(read_address))));
+				mem_data_out <= data(31 downto 0);
+			else
+				mem_data_out <= std_logic_vector(shift_right(unsigned(wb_inputs.dat),
+					wb_get_data_shift(read_size, read_address)));
+			end if;
+		end process read_data;
+
+		pipeline: process(clk)
+			variable sel : std_logic_vector(7 downto 0);
+		begin
+			if rising_edge(clk) then
+				if reset = '1' then
+					outstanding <= 0;
+					split_issue <= '0';
+					read_pending <= '0';
+					mem_w_ack <= '0';
+				else
+					if accepted = '1' and wb_inputs.ack = '0' then
+						outstanding <= outstanding + 1;
+					elsif accepted = '0' and wb_inputs.ack = '1' then
+						outstanding <= outstanding - 1;
+					end if;
+
+					if first_ack = '1' then
+						first_word <= wb_inputs.dat;
+					end if;
+
+					if read_done = '1' then
+						read_pending <= '0';
+					end if;
+
+					mem_w_ack <= '0';
+					if split_issue = '1' then
+						if accepted = '1' then
+							split_issue <= '0';
+							mem_w_ack <= split_we;
 						end if;
-					when WRITE_WAIT_ACK =>
-						if wb_inputs.ack = '1' then
-							wb_outputs.cyc <= '0';
-							wb_outputs.stb <= '0';
-							wb_outputs.we <= '0';
-							state <= IDLE;
+					elsif accepted = '1' then
+						sel := wb_get_split_sel(mem_data_size, mem_address);
+						split_address <= std_logic_vector(unsigned(mem_address(31 downto 2)) + 1) & b"00";
+						split_sel <= sel(7 downto 4);
+						split_data <= std_logic_vector(shift_right(unsigned(mem_data_in),
+							32 - 8 * to_integer(unsigned(mem_address(1 downto 0)))));
+						split_we <= mem_write_req;
+						split_issue <= to_std_logic(split);
+
+						if mem_write_req = '1' then
+							mem_w_ack <= to_std_logic(not split);
+						else
+							read_pending <= '1';
+							read_split <= to_std_logic(split);
+							read_size <= mem_data_size;
+							read_address <= mem_address(1 downto 0);
 						end if;
-				end case;
+					end if;
+				end if;
 			end if;
-		end if;
-	end process wishbone;
+		end process pipeline;
+	end generate pipelined_mode;
 
 end architecture behaviour;
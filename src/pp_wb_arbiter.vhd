@@ -6,10 +6,34 @@ library ieee;
 use ieee.std_logic_1164.all;
 
 use work.pp_types.all;
+use work.pp_constants.all;
 
---! @brief Simple priority-based wishbone arbiter.
+--! @brief Wishbone arbiter with selectable arbitration policies.
 --! This module is used as an arbiter between the instruction and data caches.
+--! A master keeps the bus until it ends its bus cycle, and the bus can be
+--! granted to the other master in the cycle after that. When both masters
+--! request the bus, the master to grant it to is selected by the policy:
+--!	- ARBITER_FIXED_PRIORITY: master 1 has priority.
+--!	- ARBITER_ROUND_ROBIN: the master that did not have the bus last is granted it.
+--!	- ARBITER_WEIGHTED: a master keeps getting the bus for up to its weight in
+--!	  consecutive bus cycles before the other master is granted it. When the
+--!	  master with the bus ends a bus cycle while the other master is waiting,
+--!	  the bus is kept for it for one more cycle if it has not used up its
+--!	  weight, so that it can start its next bus cycle.
+--! If MAX_WAIT is not zero, a master that has waited for MAX_WAIT cycles or more
+--! is granted the bus next regardless of the policy, so that no master waits for
+--! more than MAX_WAIT cycles plus the length of one bus cycle of the other master.
+--! Master 1 always gives way to master 2 when it signals that it yields, which is
+--! used when the instruction cache is only prefetching.
+--! The master that does not have the bus sees the stall signal set, so that
+--! masters using pipelined cycles do not take their requests as accepted.
 entity pp_wb_arbiter is
+	generic(
+		POLICY    : wb_arbiter_policy := ARBITER_FIXED_PRIORITY; --! Arbitration policy.
+		M1_WEIGHT : positive := 1; --! Consecutive bus cycles granted to master 1 by the weighted policy.
+		M2_WEIGHT : positive := 1; --! Consecutive bus cycles granted to master 2 by the weighted policy.
+		MAX_WAIT  : natural  := 0  --! Number of cycles a master can wait before it is granted the bus next, 0 for no limit.
+	);
 	port(
 		clk   : in std_logic;
 		reset : in std_logic;
@@ -17,6 +41,7 @@ entity pp_wb_arbiter is
 		-- Wishbone input 1:
 		m1_inputs  : out wishbone_master_inputs;
 		m1_outputs : in  wishbone_master_outputs;
+		m1_yield   : in  std_logic := '0'; --! Set when master 1 should give way to master 2.
 
 		-- Wishbone input 2:
 		m2_inputs  : out wishbone_master_inputs;
@@ -30,19 +55,37 @@ entity pp_wb_arbiter is
 		wb_we_out  : out std_logic;
 		wb_dat_out : out std_logic_vector(31 downto 0);
 		wb_dat_in  : in  std_logic_vector(31 downto 0);
-		wb_ack_in  : in  std_logic
+		wb_ack_in  : in  std_logic;
+		wb_cti_out : out std_logic_vector( 2 downto 0);
+		wb_bte_out : out std_logic_vector( 1 downto 0);
+		wb_stall_in : in std_logic := '0'
 	);
 end entity pp_wb_arbiter;
 
 architecture behaviour of pp_wb_arbiter is
 
 	type state_type is (IDLE, M1_BUSY, M2_BUSY);
-	signal state : state_type := IDLE;
+	signal state, next_state : state_type := IDLE;
+
+	-- Master that was granted the bus last and the number of consecutive bus cycles it has been granted:
+	signal last_granted : state_type := M2_BUSY;
+	signal grant_count  : natural range 1 to M1_WEIGHT + M2_WEIGHT := 1;
+
+	-- Number of cycles each master has been waiting for the bus:
+	signal m1_wait, m2_wait : natural range 0 to MAX_WAIT := 0;
+
+	-- Bus cycle signal of the master with the bus:
+	signal owner_cyc : std_logic;
+
+	-- Set while the bus is kept for a master that has ended its bus cycle:
+	signal reserved, keep_reserved : boolean := false;
 
 begin
 
-	m1_inputs <= (ack => wb_ack_in, dat => wb_dat_in) when state = M1_BUSY else (ack => '0', dat => (others => '0'));
-	m2_inputs <= (ack => wb_ack_in, dat => wb_dat_in) when state = M2_BUSY else (ack => '0', dat => (others => '0'));
+	m1_inputs <= (ack => wb_ack_in, dat => wb_dat_in, stall => wb_stall_in) when state = M1_BUSY
+		else (ack => '0', dat => (others => '0'), stall => '1');
+	m2_inputs <= (ack => wb_ack_in, dat => wb_dat_in, stall => wb_stall_in) when state = M2_BUSY
+		else (ack => '0', dat => (others => '0'), stall => '1');
 
 	output_mux: process(state, m1_outputs, m2_outputs)
 	begin
@@ -54,6 +97,8 @@ begin
 				wb_cyc_out <= '0';
 				wb_stb_out <= '0';
 				wb_we_out <= '0';
+				wb_cti_out <= WB_CTI_CLASSIC;
+				wb_bte_out <= WB_BTE_LINEAR;
 			when M1_BUSY =>
 				wb_adr_out <= m1_outputs.adr;
 				wb_sel_out <= m1_outputs.sel;
@@ -61,6 +106,8 @@ begin
 				wb_cyc_out <= m1_outputs.cyc;
 				wb_stb_out <= m1_outputs.stb;
 				wb_we_out <= m1_outputs.we;
+				wb_cti_out <= m1_outputs.cti;
+				wb_bte_out <= m1_outputs.bte;
 			when M2_BUSY =>
 				wb_adr_out <= m2_outputs.adr;
 				wb_sel_out <= m2_outputs.sel;
@@ -68,31 +115,102 @@ begin
 				wb_cyc_out <= m2_outputs.cyc;
 				wb_stb_out <= m2_outputs.stb;
 				wb_we_out <= m2_outputs.we;
+				wb_cti_out <= m2_outputs.cti;
+				wb_bte_out <= m2_outputs.bte;
 		end case;
 	end process output_mux;
 
+	owner_cyc <= m1_outputs.cyc when state = M1_BUSY else m2_outputs.cyc when state = M2_BUSY else '0';
+
+	-- With the weighted policy, the bus is kept for a master that ends its bus cycle while the other master
+	-- is waiting, unless it has used up its weight, gives way, or the other master has waited too long:
+	keep_reserved <= POLICY = ARBITER_WEIGHTED and not reserved and owner_cyc = '0'
+		and ((state = M1_BUSY and m2_outputs.cyc = '1' and grant_count < M1_WEIGHT and m1_yield = '0'
+				and (MAX_WAIT = 0 or m2_wait /= MAX_WAIT))
+			or (state = M2_BUSY and m1_outputs.cyc = '1' and grant_count < M2_WEIGHT
+				and (MAX_WAIT = 0 or m1_wait /= MAX_WAIT)));
+
+	-- The bus is passed on directly when the current master ends its bus cycle, without going through IDLE:
+	arbitrate: process(state, m1_outputs.cyc, m2_outputs.cyc, m1_yield, last_granted, grant_count, m1_wait, m2_wait,
+		owner_cyc, keep_reserved)
+	begin
+		if (state /= IDLE and owner_cyc = '1') or keep_reserved then
+			next_state <= state;
+		elsif m1_outputs.cyc = '1' and m2_outputs.cyc = '1' then
+			if m1_yield = '1' then
+				next_state <= M2_BUSY;
+			elsif MAX_WAIT /= 0 and (m1_wait = MAX_WAIT or m2_wait = MAX_WAIT) then
+				if m2_wait > m1_wait then
+					next_state <= M2_BUSY;
+				else
+					next_state <= M1_BUSY;
+				end if;
+			else
+				case POLICY is
+					when ARBITER_FIXED_PRIORITY =>
+						next_state <= M1_BUSY;
+					when ARBITER_ROUND_ROBIN =>
+						if last_granted = M1_BUSY then
+							next_state <= M2_BUSY;
+						else
+							next_state <= M1_BUSY;
+						end if;
+					when ARBITER_WEIGHTED =>
+						if (last_granted = M1_BUSY and grant_count < M1_WEIGHT)
+							or (last_granted = M2_BUSY and grant_count >= M2_WEIGHT)
+						then
+							next_state <= M1_BUSY;
+						else
+							next_state <= M2_BUSY;
+						end if;
+				end case;
+			end if;
+		elsif m1_outputs.cyc = '1' then
+			next_state <= M1_BUSY;
+		elsif m2_outputs.cyc = '1' then
+			next_state <= M2_BUSY;
+		else
+			next_state <= IDLE;
+		end if;
+	end process arbitrate;
+
 	controller: process(clk)
 	begin
 		if rising_edge(clk) then
 			if reset = '1' then
 				state <= IDLE;
+				last_granted <= M2_BUSY;
+				grant_count <= 1;
+				m1_wait <= 0;
+				m2_wait <= 0;
+				reserved <= false;
 			else
-				case state is
-					when IDLE =>
-						if m1_outputs.cyc = '1' then
-							state <= M1_BUSY;
-						elsif m2_outputs.cyc = '1' then
-							state <= M2_BUSY;
-						end if;
-					when M1_BUSY =>
-						if m1_outputs.cyc = '0' then
-							state <= IDLE;
-						end if;
-					when M2_BUSY =>
-						if m2_outputs.cyc = '0' then
-							state <= IDLE;
-						end if;
-				end case;
+				state <= next_state;
+				reserved <= keep_reserved;
+
+				if next_state /= IDLE and next_state /= state then
+					last_granted <= next_state;
+					if next_state /= last_granted then
+						grant_count <= 1;
+					elsif grant_count /= grant_count'high then
+						grant_count <= grant_count + 1;
+					end if;
+				elsif reserved and owner_cyc = '1' and grant_count /= grant_count'high then
+					-- The master the bus was kept for has started its next bus cycle:
+					grant_count <= grant_count + 1;
+				end if;
+
+				if m1_outputs.cyc = '0' or next_state = M1_BUSY then
+					m1_wait <= 0;
+				elsif m1_wait /= MAX_WAIT then
+					m1_wait <= m1_wait + 1;
+				end if;
+
+				if m2_outputs.cyc = '0' or next_state = M2_BUSY then
+					m2_wait <= 0;
+				elsif m2_wait /= MAX_WAIT then
+					m2_wait <= m2_wait + 1;
+				end if;
 			end if;
 		end if;
 	end process controller;
@@ -18,7 +18,23 @@ entity tb_processor is
 		RESET_ADDRESS   : std_logic_vector := x"00000100"; --! Processor reset address
 		IMEM_START_ADDR : std_logic_vector := x"00000100"; --! Instruction memory start address
 		IMEM_FILENAME   : string := "imem_testfile.hex";   --! File containing the contents of instruction memory.
-		DMEM_FILENAME   : string := "dmem_testfile.hex"    --! File containing the contents of data memory.
+		DMEM_FILENAME   : string := "dmem_testfile.hex";   --! File containing the contents of data memory.
+		IMEM_LATENCY    : natural := 0;                    --! Number of extra cycles before instruction fetches are acknowledged.
+		DMEM_LATENCY    : natural := 0;                    --! Number of extra cycles before data memory accesses are acknowledged.
+		BRANCH_PREDICTION : boolean := false;              --! Whether to enable dynamic branch prediction.
+		BTB_NUM_ENTRIES   : natural := 32;                 --! Number of entries in the branch target buffer.
+		BHT_NUM_ENTRIES   : natural := 128;                --! Number of counters in the branch history table.
+		RAS_DEPTH         : natural := 0;                  --! Number of entries in the return address stack.
+		EARLY_JUMPS       : boolean := true;               --! Whether to resolve direct jumps in the decode stage.
+		STATIC_BRANCH_PREDICTION : boolean := false;       --! Whether to predict backwards branches as taken in the decode stage.
+		LOAD_USE_BYPASS   : boolean := false;              --! Whether to forward load data without stalling.
+		M_EXTENSION       : boolean := true;               --! Whether to implement the M extension.
+		ZBB_EXTENSION     : boolean := true;               --! Whether to implement the Zbb and Zbkb extensions.
+		ZKNH_EXTENSION    : boolean := true;               --! Whether to implement the SHA-256 instructions from Zknh.
+		C_EXTENSION       : boolean := true;               --! Whether to implement the C extension.
+		FETCH_QUEUE_DEPTH : natural := 0;                  --! Number of entries in the fetch queue.
+		MISALIGNED_ACCESS : boolean := false;              --! Whether misaligned loads and stores are handled without exceptions.
+		LOAD_QUEUE_DEPTH  : natural := 0                   --! Number of outstanding loads allowed while execution continues.
 	);
 end entity tb_processor;
 
@@ -36,6 +52,9 @@ architecture testbench of tb_processor is
 	signal imem_data_in : std_logic_vector(31 downto 0) := (others => '0');
 	signal imem_req     : std_logic;
 	signal imem_ack     : std_logic := '0';
+	signal imem_fetch_address : std_logic_vector(31 downto 0);
+	signal imem_busy : boolean := false;
+	signal imem_wait : natural := 0;
 
 	-- Data memory interface:
 	signal dmem_address   : std_logic_vector(31 downto 0);
@@ -44,10 +63,18 @@ architecture testbench of tb_processor is
 	signal dmem_data_size : std_logic_vector( 1 downto 0);
 	signal dmem_read_req, dmem_write_req : std_logic;
 	signal dmem_read_ack, dmem_write_ack : std_logic := '1';
+	signal dmem_read_wait, dmem_write_wait : natural := 0;
 
 	-- Test context:
 	signal test_context_out  : test_context;
 
+	-- Performance monitoring:
+	signal perf_events_out : performance_events;
+	signal cycle_count, retired_count : natural := 0;
+	signal branch_count, branch_taken_count, branch_mispredicted_count : natural := 0;
+	signal branch_predicted_taken_count : natural := 0;
+	signal frontend_stall_count, backend_stall_count : natural := 0;
+
 	-- External interrupt input:
 	signal irq : std_logic_vector(7 downto 0) := (others => '0');
 
@@ -71,7 +98,21 @@ begin
 
 	uut: entity work.pp_core
 		generic map(
-			RESET_ADDRESS => RESET_ADDRESS
+			RESET_ADDRESS => RESET_ADDRESS,
+			BRANCH_PREDICTION => BRANCH_PREDICTION,
+			BTB_NUM_ENTRIES => BTB_NUM_ENTRIES,
+			BHT_NUM_ENTRIES => BHT_NUM_ENTRIES,
+			RAS_DEPTH => RAS_DEPTH,
+			EARLY_JUMPS => EARLY_JUMPS,
+			STATIC_BRANCH_PREDICTION => STATIC_BRANCH_PREDICTION,
+			LOAD_USE_BYPASS => LOAD_USE_BYPASS,
+			M_EXTENSION => M_EXTENSION,
+			ZBB_EXTENSION => ZBB_EXTENSION,
+			ZKNH_EXTENSION => ZKNH_EXTENSION,
+			C_EXTENSION => C_EXTENSION,
+			FETCH_QUEUE_DEPTH => FETCH_QUEUE_DEPTH,
+			MISALIGNED_ACCESS => MISALIGNED_ACCESS,
+			LOAD_QUEUE_DEPTH => LOAD_QUEUE_DEPTH
 		) port map(
 			clk => clk,
 			reset => reset,
@@ -87,7 +128,15 @@ begin
 			dmem_read_ack => dmem_read_ack,
 			dmem_write_req => dmem_write_req,
 			dmem_write_ack => dmem_write_ack,
+			dmem_drained => '1',
+			dcache_flush => open,
+			dcache_invalidate => open,
+			icache_invalidate => open,
+			icache_invalidate_range => open,
+			icache_invalidate_start => open,
+			icache_invalidate_end => open,
 			test_context_out => test_context_out,
+			perf_events_out => perf_events_out,
 			irq => irq
 		);
 
@@ -163,6 +212,8 @@ begin
 		if rising_edge(clk) then
 			if dmem_write_ack = '1' then
 				dmem_write_ack <= '0';
+			elsif dmem_write_req = '1' and dmem_write_wait < DMEM_LATENCY then
+				dmem_write_wait <= dmem_write_wait + 1;
 			elsif dmem_write_req = '1' then
 				case dmem_data_size is
 					when b"00" => -- 32 bits
@@ -178,6 +229,7 @@ begin
 					when others =>
 				end case;
 				dmem_write_ack <= '1';
+				dmem_write_wait <= 0;
 			end if;
 		end if;
 	end process dmem_init_and_write;
@@ -185,22 +237,44 @@ begin
 	initialized <= imem_initialized and dmem_initialized;
 
 	--! Instruction memory read process.
+	--! With a latency, the address is latched when a fetch starts, as the Wishbone adapter does,
+	--! and the fetch is acknowledged IMEM_LATENCY cycles later than without a latency.
 	imem_read: process(clk)
+		variable address : std_logic_vector(31 downto 0);
 	begin
 		if rising_edge(clk) then
 			if reset = '1' then
 				imem_ack <= '0';
+				imem_busy <= false;
 			else
-				if to_integer(unsigned(imem_address)) > IMEM_END then
-					imem_data_in <= (others => 'X');
-				else
-					imem_data_in <= imem_memory(to_integer(unsigned(imem_address)) + 3)
-						& imem_memory(to_integer(unsigned(imem_address)) + 2)
-						& imem_memory(to_integer(unsigned(imem_address)) + 1)
-						& imem_memory(to_integer(unsigned(imem_address)) + 0);
+				imem_ack <= '0';
+				address := imem_address;
+
+				if IMEM_LATENCY > 0 then
+					if not imem_busy then
+						imem_fetch_address <= imem_address;
+						imem_busy <= imem_req = '1';
+						imem_wait <= 1;
+					elsif imem_wait < IMEM_LATENCY then
+						imem_wait <= imem_wait + 1;
+					else
+						address := imem_fetch_address;
+						imem_busy <= false;
+					end if;
+				end if;
+
+				if IMEM_LATENCY = 0 or (imem_busy and imem_wait = IMEM_LATENCY) then
+					if to_integer(unsigned(address)) > IMEM_END then
+						imem_data_in <= (others => 'X');
+					else
+						imem_data_in <= imem_memory(to_integer(unsigned(address)) + 3)
+							& imem_memory(to_integer(unsigned(address)) + 2)
+							& imem_memory(to_integer(unsigned(address)) + 1)
+							& imem_memory(to_integer(unsigned(address)) + 0);
+					end if;
+
+					imem_ack <= '1';
 				end if;
-	
-				imem_ack <= '1';
 			end if;
 		end if;
 	end process imem_read;
@@ -211,6 +285,8 @@ begin
 		if rising_edge(clk) then
 			if dmem_read_ack = '1' then
 				dmem_read_ack <= '0';
+			elsif dmem_read_req = '1' and dmem_read_wait < DMEM_LATENCY then
+				dmem_read_wait <= dmem_read_wait + 1;
 			elsif dmem_read_req = '1' then
 				case dmem_data_size is
 					when b"00" => -- 32 bits
@@ -226,10 +302,49 @@ begin
 					when others =>
 				end case;
 				dmem_read_ack <= '1';
+				dmem_read_wait <= 0;
 			end if;
 		end if;
 	end process dmem_read;
 
+	--! Counts performance events while the test is running.
+	performance_counters: process(clk)
+	begin
+		if rising_edge(clk) then
+			if reset = '0' and not simulation_finished then
+				cycle_count <= cycle_count + 1;
+
+				if perf_events_out.instruction_retired = '1' then
+					retired_count <= retired_count + 1;
+				end if;
+
+				if perf_events_out.branch_resolved = '1' then
+					branch_count <= branch_count + 1;
+				end if;
+
+				if perf_events_out.branch_taken = '1' then
+					branch_taken_count <= branch_taken_count + 1;
+				end if;
+
+				if perf_events_out.branch_predicted_taken = '1' then
+					branch_predicted_taken_count <= branch_predicted_taken_count + 1;
+				end if;
+
+				if perf_events_out.branch_mispredicted = '1' then
+					branch_mispredicted_count <= branch_mispredicted_count + 1;
+				end if;
+
+				if perf_events_out.frontend_stall = '1' then
+					frontend_stall_count <= frontend_stall_count + 1;
+				end if;
+
+				if perf_events_out.backend_stall = '1' then
+					backend_stall_count <= backend_stall_count + 1;
+				end if;
+			end if;
+		end if;
+	end process performance_counters;
+
 	stimulus: process
 	begin
 		wait until initialized = true;
@@ -247,6 +362,21 @@ begin
 			report "Failure in test " & integer'image(to_integer(unsigned(test_context_out.number))) & "!" severity NOTE;
 		end if;
 
+		-- Every taken branch flushes two instructions without branch prediction:
+		report "Statistics: " & integer'image(cycle_count) & " cycles, "
+			& integer'image(retired_count) & " instructions retired, "
+			& integer'image((retired_count * 100) / cycle_count) & " instructions per 100 cycles" severity NOTE;
+		report "Statistics: " & integer'image(branch_count) & " branches, "
+			& integer'image(branch_taken_count) & " taken, "
+			& integer'image(branch_mispredicted_count) & " mispredicted" severity NOTE;
+		if branch_count > 0 then
+			report "Statistics: branch prediction hit rate "
+				& integer'image(((branch_count - branch_mispredicted_count) * 100) / branch_count) & "%, "
+				& integer'image(branch_predicted_taken_count) & " taken branches predicted correctly" severity NOTE;
+		end if;
+		report "Statistics: " & integer'image(frontend_stall_count) & " front-end stall cycles, "
+			& integer'image(backend_stall_count) & " back-end stall cycles" severity NOTE;
+
 		simulation_finished <= true;
 		wait;
 	end process stimulus;
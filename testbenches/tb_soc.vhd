@@ -20,7 +20,18 @@ entity tb_soc is
 		RESET_ADDRESS   : std_logic_vector := x"00000100"; --! Processor reset address
 		IMEM_START_ADDR : std_logic_vector := x"00000100"; --! Instruction memory start address
 		IMEM_FILENAME   : string := "imem_testfile.hex"; --! File containing the contents of instruction memory.
-		DMEM_FILENAME   : string := "dmem_testfile.hex"  --! File containing the contents of data memory.
+		DMEM_FILENAME   : string := "dmem_testfile.hex"; --! File containing the contents of data memory.
+		ICACHE_WAYS     : natural := 1;                   --! Number of ways in the instruction cache.
+		ICACHE_PREFETCH : boolean := false;               --! Whether to prefetch instruction cache lines.
+		BURST_REFILLS   : boolean := false;               --! Whether the caches load lines using bursts.
+		HARVARD_BUS     : boolean := false;               --! Whether to fetch instructions using a separate bus.
+		PIPELINED_BUS   : boolean := false;               --! Whether data accesses use pipelined cycles.
+		STORE_BUFFER_DEPTH : natural := 0;                --! Number of entries in the store buffer.
+		LOAD_QUEUE_DEPTH   : natural := 0;                --! Number of outstanding loads.
+		DCACHE_ENABLE   : boolean := false;               --! Whether to enable the data cache.
+		MISALIGNED_ACCESS : boolean := false;             --! Whether misaligned loads and stores are handled without exceptions.
+		ITCM_SIZE       : natural := 1024;                --! Size of the instruction TCM at 0x10000000 in bytes.
+		DTCM_SIZE       : natural := 1024                 --! Size of the data TCM at 0x20000000 in bytes.
 	);
 end entity tb_soc;
 
@@ -39,6 +50,9 @@ architecture testbench of tb_soc is
 	-- Test context:
 	signal test_context_out  : test_context;
 
+	-- Performance events:
+	signal cache_events_out : cache_performance_events;
+
 	-- Instruction memory signals:
 	signal imem_adr_in : std_logic_vector(log2(IMEM_SIZE) - 1 downto 0);
 	signal imem_dat_in : std_logic_vector(31 downto 0);
@@ -48,6 +62,15 @@ architecture testbench of tb_soc is
 	signal imem_sel_in : std_logic_vector(3 downto 0);
 	signal imem_we_in : std_logic;
 	signal imem_ack_out : std_logic;
+	signal imem_stall_out : std_logic;
+	signal imem_cti_in : std_logic_vector(2 downto 0);
+	signal imem_bte_in : std_logic_vector(1 downto 0);
+
+	-- Instruction memory instruction port signals:
+	signal imem_dat2_out : std_logic_vector(31 downto 0);
+	signal imem_cyc2_in  : std_logic;
+	signal imem_stb2_in  : std_logic;
+	signal imem_ack2_out : std_logic;
 	
 	-- Data memory signals:
 	signal dmem_adr_in  : std_logic_vector(log2(DMEM_SIZE) - 1 downto 0);
@@ -58,6 +81,15 @@ architecture testbench of tb_soc is
 	signal dmem_sel_in  : std_logic_vector(3 downto 0);
 	signal dmem_we_in   : std_logic;
 	signal dmem_ack_out : std_logic;
+	signal dmem_stall_out : std_logic;
+	signal dmem_cti_in  : std_logic_vector(2 downto 0);
+	signal dmem_bte_in  : std_logic_vector(1 downto 0);
+
+	-- Data memory instruction port signals:
+	signal dmem_dat2_out : std_logic_vector(31 downto 0);
+	signal dmem_cyc2_in  : std_logic;
+	signal dmem_stb2_in  : std_logic;
+	signal dmem_ack2_out : std_logic;
 
 	-- Processor signals:
 	signal p_adr_out : std_logic_vector(31 downto 0);
@@ -68,14 +100,30 @@ architecture testbench of tb_soc is
 	signal p_sel_out : std_logic_vector(3 downto 0);
 	signal p_we_out  : std_logic;
 	signal p_ack_in  : std_logic;
-
-	-- Arbitrated wishbone signals:
-	signal wb_adr : std_logic_vector(31 downto 0);
-	signal wb_dat : std_logic_vector(31 downto 0);
-	signal wb_sel : std_logic_vector( 3 downto 0);
-	signal wb_cyc : std_logic;
-	signal wb_stb : std_logic;
-	signal wb_we  : std_logic;
+	signal p_stall_in : std_logic;
+	signal p_cti_out : std_logic_vector(2 downto 0);
+	signal p_bte_out : std_logic_vector(1 downto 0);
+
+	-- Processor instruction bus signals, used if HARVARD_BUS is set:
+	signal p_iadr_out : std_logic_vector(31 downto 0);
+	signal p_idat_in  : std_logic_vector(31 downto 0);
+	signal p_icyc_out : std_logic;
+	signal p_istb_out : std_logic;
+	signal p_iack_in  : std_logic;
+	signal p_icti_out : std_logic_vector(2 downto 0);
+	signal p_ibte_out : std_logic_vector(1 downto 0);
+
+	-- Interconnect signals, the processor is master 0 and the initialization "module" master 1:
+	signal master_inputs  : wishbone_master_inputs_array(0 to 1);
+	signal master_outputs : wishbone_master_outputs_array(0 to 1);
+	signal slave_inputs   : wishbone_master_inputs_array(0 to 1);
+	signal slave_outputs  : wishbone_master_outputs_array(0 to 1);
+
+	-- The data memory is mapped to all addresses not used by the instruction memory:
+	constant ADDRESS_MAP : wb_address_map(0 to 1) := (
+			0 => (base => x"00000000", mask => not std_logic_vector(to_unsigned(IMEM_SIZE - 1, 32))),
+			1 => (base => x"00000000", mask => x"00000000")
+		);
 
 	-- Initialization "module" signals:
 	signal init_adr_out : std_logic_vector(31 downto 0) := (others => '0');
@@ -87,6 +135,16 @@ architecture testbench of tb_soc is
 	-- Processor reset signals:
 	signal processor_reset : std_logic := '1';
 
+	-- Statistics:
+	signal cycle_count, bus_cycle_count, bus_transaction_count : natural := 0;
+	signal icache_hit_count, icache_miss_count : natural := 0;
+	signal prefetch_useful_count, prefetch_useless_count : natural := 0;
+	signal burst_transfer_count : natural := 0;
+	signal burst_continues : boolean := false;
+	signal ibus_cycle_count, ibus_transaction_count, ibus_burst_transfer_count : natural := 0;
+	signal parallel_cycle_count : natural := 0;
+	signal ibus_burst_continues : boolean := false;
+
 	-- Simulation control:
 	signal initialized  : boolean := false;
 	signal simulation_finished : boolean := false;
@@ -95,12 +153,30 @@ begin
 
 	processor: entity work.pp_potato
 		generic map(
-			RESET_ADDRESS => RESET_ADDRESS
+			RESET_ADDRESS => RESET_ADDRESS,
+			M_EXTENSION => true,
+			ZBB_EXTENSION => true,
+			ZKNH_EXTENSION => true,
+			C_EXTENSION => true,
+			ICACHE_WAYS => ICACHE_WAYS,
+			ICACHE_PREFETCH => ICACHE_PREFETCH,
+			BURST_REFILLS => BURST_REFILLS,
+			HARVARD_BUS => HARVARD_BUS,
+			PIPELINED_BUS => PIPELINED_BUS,
+			DCACHE_ENABLE => DCACHE_ENABLE,
+			ITCM_BASE => x"10000000",
+			ITCM_SIZE => ITCM_SIZE,
+			DTCM_BASE => x"20000000",
+			DTCM_SIZE => DTCM_SIZE,
+			STORE_BUFFER_DEPTH => STORE_BUFFER_DEPTH,
+			MISALIGNED_ACCESS => MISALIGNED_ACCESS,
+			LOAD_QUEUE_DEPTH => LOAD_QUEUE_DEPTH
 		) port map(
 			clk => clk,
 			reset => processor_reset,
 			irq => irq,
 			test_context_out => test_context_out,
+			cache_events_out => cache_events_out,
 			wb_adr_out => p_adr_out,
 			wb_sel_out => p_sel_out,
 			wb_cyc_out => p_cyc_out,
@@ -108,12 +184,24 @@ begin
 			wb_we_out => p_we_out,
 			wb_dat_out => p_dat_out,
 			wb_dat_in => p_dat_in,
-			wb_ack_in => p_ack_in
+			wb_ack_in => p_ack_in,
+			wb_cti_out => p_cti_out,
+			wb_bte_out => p_bte_out,
+			wb_stall_in => p_stall_in,
+			iwb_adr_out => p_iadr_out,
+			iwb_sel_out => open,
+			iwb_cyc_out => p_icyc_out,
+			iwb_stb_out => p_istb_out,
+			iwb_dat_in => p_idat_in,
+			iwb_ack_in => p_iack_in,
+			iwb_cti_out => p_icti_out,
+			iwb_bte_out => p_ibte_out
 		);
 
 	imem: entity work.pp_soc_memory
 		generic map(
-			MEMORY_SIZE => IMEM_SIZE
+			MEMORY_SIZE => IMEM_SIZE,
+			PIPELINED => PIPELINED_BUS
 		) port map(
 			clk => clk,
 			reset => reset,
@@ -124,12 +212,24 @@ begin
 			wb_stb_in => imem_stb_in,
 			wb_sel_in => imem_sel_in,
 			wb_we_in => imem_we_in,
-			wb_ack_out => imem_ack_out
+			wb_ack_out => imem_ack_out,
+			wb_cti_in => imem_cti_in,
+			wb_bte_in => imem_bte_in,
+			wb_stall_out => imem_stall_out,
+			wb2_adr_in => p_iadr_out(log2(IMEM_SIZE) - 1 downto 0),
+			wb2_dat_out => imem_dat2_out,
+			wb2_cyc_in => imem_cyc2_in,
+			wb2_stb_in => imem_stb2_in,
+			wb2_ack_out => imem_ack2_out,
+			wb2_cti_in => p_icti_out,
+			wb2_bte_in => p_ibte_out,
+			wb2_stall_out => open
 		);
 
 	dmem: entity work.pp_soc_memory
 		generic map(
-			MEMORY_SIZE => DMEM_SIZE
+			MEMORY_SIZE => DMEM_SIZE,
+			PIPELINED => PIPELINED_BUS
 		) port map(
 			clk => clk,
 			reset => reset,
@@ -140,57 +240,101 @@ begin
 			wb_stb_in => dmem_stb_in,
 			wb_sel_in => dmem_sel_in,
 			wb_we_in => dmem_we_in,
-			wb_ack_out => dmem_ack_out
+			wb_ack_out => dmem_ack_out,
+			wb_cti_in => dmem_cti_in,
+			wb_bte_in => dmem_bte_in,
+			wb_stall_out => dmem_stall_out,
+			wb2_adr_in => p_iadr_out(log2(DMEM_SIZE) - 1 downto 0),
+			wb2_dat_out => dmem_dat2_out,
+			wb2_cyc_in => dmem_cyc2_in,
+			wb2_stb_in => dmem_stb2_in,
+			wb2_ack_out => dmem_ack2_out,
+			wb2_cti_in => p_icti_out,
+			wb2_bte_in => p_ibte_out,
+			wb2_stall_out => open
 		);
 
-	imem_adr_in <= wb_adr(imem_adr_in'range);
-	imem_dat_in <= wb_dat;
-	imem_we_in <= wb_we;
-	imem_sel_in <= wb_sel;
-	dmem_adr_in <= wb_adr(dmem_adr_in'range);
-	dmem_dat_in <= wb_dat;
-	dmem_we_in <= wb_we;
-	dmem_sel_in <= wb_sel;
-
-	address_decoder: process(wb_adr, imem_dat_out, imem_ack_out, dmem_dat_out, dmem_ack_out,
-		wb_cyc, wb_stb)
-	begin
-		if to_integer(unsigned(wb_adr)) < IMEM_SIZE then
-			p_dat_in <= imem_dat_out;
-			p_ack_in <= imem_ack_out;
-			imem_cyc_in <= wb_cyc;
-			imem_stb_in <= wb_stb;
-			dmem_cyc_in <= '0';
-			dmem_stb_in <= '0';
-		else
-			p_dat_in <= dmem_dat_out;
-			p_ack_in <= dmem_ack_out;
-			dmem_cyc_in <= wb_cyc;
-			dmem_stb_in <= wb_stb;
-			imem_cyc_in <= '0';
-			imem_stb_in <= '0';
-		end if;
-	end process address_decoder;
+	interconnect: entity work.pp_soc_crossbar
+		generic map(
+			NUM_MASTERS => 2,
+			NUM_SLAVES => 2,
+			ADDRESS_MAP => ADDRESS_MAP
+		) port map(
+			clk => clk,
+			reset => reset,
+			m_inputs => master_inputs,
+			m_outputs => master_outputs,
+			s_inputs => slave_inputs,
+			s_outputs => slave_outputs,
+			err_inputs => (ack => '0', dat => (others => '0'), stall => '0'), -- All addresses are mapped
+			err_outputs => open
+		);
+
+	master_outputs(0) <= (
+			adr => p_adr_out,
+			sel => p_sel_out,
+			cyc => p_cyc_out,
+			stb => p_stb_out,
+			we => p_we_out,
+			dat => p_dat_out,
+			cti => p_cti_out,
+			bte => p_bte_out
+		);
+	p_dat_in <= master_inputs(0).dat;
+	p_ack_in <= master_inputs(0).ack;
+	p_stall_in <= master_inputs(0).stall;
+
+	master_outputs(1) <= (
+			adr => init_adr_out,
+			sel => x"f",
+			cyc => init_cyc_out,
+			stb => init_stb_out,
+			we => init_we_out,
+			dat => init_dat_out,
+			cti => WB_CTI_CLASSIC,
+			bte => WB_BTE_LINEAR
+		);
 
-	arbiter: process(initialized, init_adr_out, init_dat_out, init_cyc_out, init_stb_out, init_we_out,
-		p_adr_out, p_dat_out, p_cyc_out, p_stb_out, p_we_out, p_sel_out)
+	imem_adr_in <= slave_outputs(0).adr(imem_adr_in'range);
+	imem_dat_in <= slave_outputs(0).dat;
+	imem_cyc_in <= slave_outputs(0).cyc;
+	imem_stb_in <= slave_outputs(0).stb;
+	imem_we_in <= slave_outputs(0).we;
+	imem_sel_in <= slave_outputs(0).sel;
+	imem_cti_in <= slave_outputs(0).cti;
+	imem_bte_in <= slave_outputs(0).bte;
+	slave_inputs(0) <= (dat => imem_dat_out, ack => imem_ack_out, stall => imem_stall_out);
+
+	dmem_adr_in <= slave_outputs(1).adr(dmem_adr_in'range);
+	dmem_dat_in <= slave_outputs(1).dat;
+	dmem_cyc_in <= slave_outputs(1).cyc;
+	dmem_stb_in <= slave_outputs(1).stb;
+	dmem_we_in <= slave_outputs(1).we;
+	dmem_sel_in <= slave_outputs(1).sel;
+	dmem_cti_in <= slave_outputs(1).cti;
+	dmem_bte_in <= slave_outputs(1).bte;
+	slave_inputs(1) <= (dat => dmem_dat_out, ack => dmem_ack_out, stall => dmem_stall_out);
+
+	-- Instructions are fetched through the second ports of the memories when using a separate instruction bus:
+	instruction_decoder: process(p_iadr_out, p_icyc_out, p_istb_out, imem_dat2_out, imem_ack2_out,
+		dmem_dat2_out, dmem_ack2_out)
 	begin
-		if not initialized then
-			wb_adr <= init_adr_out;
-			wb_dat <= init_dat_out;
-			wb_cyc <= init_cyc_out;
-			wb_stb <= init_stb_out;
-			wb_we <= init_we_out;
-			wb_sel <= x"f";
+		if to_integer(unsigned(p_iadr_out)) < IMEM_SIZE then
+			p_idat_in <= imem_dat2_out;
+			p_iack_in <= imem_ack2_out;
+			imem_cyc2_in <= p_icyc_out;
+			imem_stb2_in <= p_istb_out;
+			dmem_cyc2_in <= '0';
+			dmem_stb2_in <= '0';
 		else
-			wb_adr <= p_adr_out;
-			wb_dat <= p_dat_out;
-			wb_cyc <= p_cyc_out;
-			wb_stb <= p_stb_out;
-			wb_we <= p_we_out;
-			wb_sel <= p_sel_out;
+			p_idat_in <= dmem_dat2_out;
+			p_iack_in <= dmem_ack2_out;
+			dmem_cyc2_in <= p_icyc_out;
+			dmem_stb2_in <= p_istb_out;
+			imem_cyc2_in <= '0';
+			imem_stb2_in <= '0';
 		end if;
-	end process arbiter;
+	end process instruction_decoder;
 
 	initializer: process
 		file imem_file : text open READ_MODE is IMEM_FILENAME;
@@ -273,6 +417,70 @@ begin
 		end if;
 	end process clock;
 
+	statistics: process(clk)
+	begin
+		if rising_edge(clk) then
+			if processor_reset = '0' then
+				cycle_count <= cycle_count + 1;
+
+				if p_cyc_out = '1' then
+					bus_cycle_count <= bus_cycle_count + 1;
+				end if;
+
+				if p_cyc_out = '1' and p_ack_in = '1' then
+					bus_transaction_count <= bus_transaction_count + 1;
+				end if;
+
+				if p_cyc_out = '1' and p_stb_out = '1' and p_ack_in = '1' and p_cti_out /= WB_CTI_CLASSIC then
+					burst_transfer_count <= burst_transfer_count + 1;
+				end if;
+
+				-- Each transfer in a burst must be acknowledged in the cycle after the previous transfer:
+				if burst_continues and p_cyc_out = '1' and p_stb_out = '1' then
+					assert p_ack_in = '1' report "Burst transfer not acknowledged in consecutive cycle" severity FAILURE;
+				end if;
+				burst_continues <= p_cyc_out = '1' and p_stb_out = '1' and p_ack_in = '1' and p_cti_out = WB_CTI_INCREMENT;
+
+				if p_icyc_out = '1' then
+					ibus_cycle_count <= ibus_cycle_count + 1;
+				end if;
+
+				if p_icyc_out = '1' and p_cyc_out = '1' then
+					parallel_cycle_count <= parallel_cycle_count + 1;
+				end if;
+
+				if p_icyc_out = '1' and p_istb_out = '1' and p_iack_in = '1' then
+					ibus_transaction_count <= ibus_transaction_count + 1;
+				end if;
+
+				if p_icyc_out = '1' and p_istb_out = '1' and p_iack_in = '1' and p_icti_out /= WB_CTI_CLASSIC then
+					ibus_burst_transfer_count <= ibus_burst_transfer_count + 1;
+				end if;
+
+				if ibus_burst_continues and p_icyc_out = '1' and p_istb_out = '1' then
+					assert p_iack_in = '1' report "Burst transfer not acknowledged in consecutive cycle" severity FAILURE;
+				end if;
+				ibus_burst_continues <= p_icyc_out = '1' and p_istb_out = '1' and p_iack_in = '1' and p_icti_out = WB_CTI_INCREMENT;
+
+				if cache_events_out.icache_hit = '1' then
+					icache_hit_count <= icache_hit_count + 1;
+				end if;
+
+				if cache_events_out.icache_miss = '1' then
+					icache_miss_count <= icache_miss_count + 1;
+				end if;
+
+				if cache_events_out.icache_prefetch_useful = '1' then
+					prefetch_useful_count <= prefetch_useful_count + 1;
+				end if;
+
+				if cache_events_out.icache_prefetch_useless = '1' then
+					prefetch_useless_count <= prefetch_useless_count + 1;
+				end if;
+			end if;
+		end if;
+	end process statistics;
+
 	stimulus: process
 	begin
 		wait for clk_period * 2;
@@ -288,6 +496,19 @@ begin
 			report "Failure in test " & integer'image(to_integer(unsigned(test_context_out.number))) & "!" severity NOTE;
 		end if;
 
+		report "Statistics: " & integer'image(cycle_count) & " cycles, "
+			& integer'image(bus_cycle_count) & " cycles with an active bus cycle, "
+			& integer'image(bus_transaction_count) & " bus transactions, "
+			& integer'image(burst_transfer_count) & " in bursts" severity NOTE;
+		report "Statistics: instruction bus " & integer'image(ibus_cycle_count) & " cycles with an active bus cycle, "
+			& integer'image(ibus_transaction_count) & " bus transactions, "
+			& integer'image(ibus_burst_transfer_count) & " in bursts, "
+			& integer'image(parallel_cycle_count) & " cycles with both buses active" severity NOTE;
+		report "Statistics: instruction cache " & integer'image(icache_hit_count) & " hits, "
+			& integer'image(icache_miss_count) & " misses" severity NOTE;
+		report "Statistics: instruction prefetcher " & integer'image(prefetch_useful_count) & " useful, "
+			& integer'image(prefetch_useless_count) & " useless prefetches" severity NOTE;
+
 		simulation_finished <= true;
 		wait;
 	end process stimulus;
@@ -28,13 +28,21 @@ architecture testbench of tb_soc_memory is
 	signal wb_we_in   : std_logic := '0';
 	signal wb_ack_out : std_logic;
 
+	-- Signals for the pipelined, dual-port memory:
+	type address_array is array(1 to 2) of std_logic_vector(11 downto 0);
+	type data_array is array(1 to 2) of std_logic_vector(31 downto 0);
+	signal dp_adr_in  : address_array := (others => (others => '0'));
+	signal dp_dat_in  : data_array := (others => (others => '0'));
+	signal dp_dat_out : data_array;
+	signal dp_stb_in, dp_we_in, dp_ack_out, dp_stall_out : std_logic_vector(1 to 2) := (others => '0');
+
 begin
 
 	uut: entity work.pp_soc_memory
 		port map(
 			clk => clk,
 			reset => reset,
-			wb_adr_in => wb_adr_in,
+			wb_adr_in => wb_adr_in(11 downto 0),
 			wb_dat_in => wb_dat_in,
 			wb_dat_out => wb_dat_out,
 			wb_cyc_in => wb_cyc_in,
@@ -44,6 +52,35 @@ begin
 			wb_ack_out => wb_ack_out
 		);
 
+	uut_dual_port: entity work.pp_soc_memory
+		generic map(
+			MEMORY_SIZE => 4096,
+			PIPELINED => true,
+			PIPELINED2 => true,
+			DUAL_PORT => true
+		) port map(
+			clk => clk,
+			reset => reset,
+			wb_adr_in => dp_adr_in(1),
+			wb_dat_in => dp_dat_in(1),
+			wb_dat_out => dp_dat_out(1),
+			wb_cyc_in => dp_stb_in(1),
+			wb_stb_in => dp_stb_in(1),
+			wb_sel_in => (others => '1'),
+			wb_we_in => dp_we_in(1),
+			wb_ack_out => dp_ack_out(1),
+			wb_stall_out => dp_stall_out(1),
+			wb2_adr_in => dp_adr_in(2),
+			wb2_dat_in => dp_dat_in(2),
+			wb2_dat_out => dp_dat_out(2),
+			wb2_cyc_in => dp_stb_in(2),
+			wb2_stb_in => dp_stb_in(2),
+			wb2_sel_in => (others => '1'),
+			wb2_we_in => dp_we_in(2),
+			wb2_ack_out => dp_ack_out(2),
+			wb2_stall_out => dp_stall_out(2)
+		);
+
 	clock: process
 	begin
 		clk <= '1';
@@ -96,4 +133,58 @@ begin
 		wait;
 	end process stimulus;
 
+	-- Writes a word through each interface of the dual-port memory in every cycle, then reads the words
+	-- written through one interface back through the other, checking that one access completes per cycle:
+	dual_port_stimulus: process
+		constant NUM_WORDS : natural := 8;
+	begin
+		wait until reset = '0';
+		wait until rising_edge(clk);
+
+		for i in 0 to NUM_WORDS loop
+			for p in 1 to 2 loop
+				dp_adr_in(p) <= std_logic_vector(to_unsigned((p - 1) * 2048 + i * 4, 12));
+				dp_dat_in(p) <= std_logic_vector(to_unsigned(p * 16#100# + i, 32));
+				dp_we_in(p) <= '1';
+				if i < NUM_WORDS then
+					dp_stb_in(p) <= '1';
+				else
+					dp_stb_in(p) <= '0';
+				end if;
+			end loop;
+			wait until rising_edge(clk);
+
+			for p in 1 to 2 loop
+				assert dp_stall_out(p) = '0' report "Memory stalled" severity FAILURE;
+				if i > 0 then
+					assert dp_ack_out(p) = '1' report "Write was not acknowledged in the next cycle" severity FAILURE;
+				end if;
+			end loop;
+		end loop;
+
+		for i in 0 to NUM_WORDS loop
+			for p in 1 to 2 loop
+				dp_adr_in(p) <= std_logic_vector(to_unsigned((2 - p) * 2048 + i * 4, 12));
+				dp_we_in(p) <= '0';
+				if i < NUM_WORDS then
+					dp_stb_in(p) <= '1';
+				else
+					dp_stb_in(p) <= '0';
+				end if;
+			end loop;
+			wait until rising_edge(clk);
+
+			if i > 0 then
+				for p in 1 to 2 loop
+					assert dp_ack_out(p) = '1' report "Read was not acknowledged in the next cycle" severity FAILURE;
+					assert dp_dat_out(p) = std_logic_vector(to_unsigned((3 - p) * 16#100# + i - 1, 32))
+						report "Incorrect data read from the dual-port memory" severity FAILURE;
+				end loop;
+			end if;
+		end loop;
+
+		report "Dual-port memory test completed" severity NOTE;
+		wait;
+	end process dual_port_stimulus;
+
 end architecture testbench;
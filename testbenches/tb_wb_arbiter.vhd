@@ -0,0 +1,261 @@
+-- The Potato Processor - A simple processor for FPGAs
+-- (c) Kristian Klomsten Skordal 2014 - 2015 <kristian.skordal@wafflemail.net>
+-- Report bugs and issues on <https://github.com/skordal/potato/issues>
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.pp_types.all;
+use work.pp_constants.all;
+
+--! @brief Stress testbench for the Wishbone arbiter.
+--! @details
+--!	Runs one arbiter for each arbitration policy with two masters continuously
+--!	requesting the bus: master 1 behaves like the instruction cache during a
+--!	series of misses, loading 4-word lines with short gaps, and master 2 like
+--!	the data memory interface, performing single accesses. The worst-case and
+--!	average number of cycles each master waits for the bus are reported for
+--!	each policy.
+--!
+--!	An additional weighted arbiter without a maximum wait is run with both
+--!	masters requesting the bus again right after each bus cycle. The testbench
+--!	fails if the bus cycles granted to the masters by this arbiter are not in
+--!	the ratio of their weights.
+entity tb_wb_arbiter is
+	generic(
+		NUM_CYCLES : natural := 20000; --! Number of cycles to run the masters for.
+		M1_WEIGHT  : positive := 2;    --! Weight of master 1 for the weighted policy.
+		M2_WEIGHT  : positive := 1;    --! Weight of master 2 for the weighted policy.
+		MAX_WAIT   : natural := 8      --! Maximum wait for the weighted policy.
+	);
+end entity tb_wb_arbiter;
+
+architecture testbench of tb_wb_arbiter is
+
+	-- Clock signal:
+	signal clk : std_logic;
+	constant clk_period : time := 10 ns;
+
+	-- Reset signal:
+	signal reset : std_logic := '1';
+
+	-- Simulation control:
+	signal cycle_count : natural := 0;
+	signal simulation_finished : boolean := false;
+
+	type policy_array is array(0 to 3) of wb_arbiter_policy;
+	type saturation_array is array(0 to 3) of boolean;
+	constant POLICIES : policy_array := (ARBITER_FIXED_PRIORITY, ARBITER_ROUND_ROBIN, ARBITER_WEIGHTED, ARBITER_WEIGHTED);
+
+	-- Arbiters where the masters request the bus again without gaps:
+	constant SATURATED : saturation_array := (false, false, false, true);
+
+	-- Behaviour of the masters, the number of transfers in each bus cycle and the maximum number
+	-- of cycles between bus cycles:
+	type natural_array is array(1 to 2) of natural;
+	constant BURST_LENGTH : natural_array := (4, 1);
+	constant MAX_GAP      : natural_array := (1, 3);
+
+	type master_inputs_array is array(1 to 2) of wishbone_master_inputs;
+	type master_outputs_array is array(1 to 2) of wishbone_master_outputs;
+
+	--! Formats an average number of cycles with two decimals.
+	function format_average(total, count : in natural) return string is
+		variable hundredths : natural;
+	begin
+		if count = 0 then
+			return "0.00";
+		end if;
+
+		hundredths := (total * 100) / count;
+		if hundredths mod 100 < 10 then
+			return integer'image(hundredths / 100) & ".0" & integer'image(hundredths mod 100);
+		else
+			return integer'image(hundredths / 100) & "." & integer'image(hundredths mod 100);
+		end if;
+	end function format_average;
+
+	--! Gets the name used for an arbiter in the statistics.
+	function instance_name(index : in natural) return string is
+	begin
+		if SATURATED(index) then
+			return wb_arbiter_policy'image(POLICIES(index)) & " (saturated)";
+		else
+			return wb_arbiter_policy'image(POLICIES(index));
+		end if;
+	end function instance_name;
+
+begin
+
+	clock: process
+	begin
+		clk <= '1';
+		wait for clk_period / 2;
+		clk <= '0';
+		wait for clk_period / 2;
+
+		if simulation_finished then
+			wait;
+		end if;
+	end process clock;
+
+	count_cycles: process(clk)
+	begin
+		if rising_edge(clk) and reset = '0' then
+			cycle_count <= cycle_count + 1;
+		end if;
+	end process count_cycles;
+
+	policy_instances: for p in POLICIES'range generate
+		signal master_inputs  : master_inputs_array;
+		signal master_outputs : master_outputs_array;
+
+		signal wb_adr : std_logic_vector(31 downto 0);
+		signal wb_cyc, wb_stb, wb_ack : std_logic;
+
+		-- Statistics:
+		signal worst_latency, total_latency, grant_count : natural_array := (others => 0);
+	begin
+
+		uut: entity work.pp_wb_arbiter
+			generic map(
+				POLICY => POLICIES(p),
+				M1_WEIGHT => M1_WEIGHT,
+				M2_WEIGHT => M2_WEIGHT,
+				MAX_WAIT => MAX_WAIT * boolean'pos(POLICIES(p) = ARBITER_WEIGHTED and not SATURATED(p))
+			) port map(
+				clk => clk,
+				reset => reset,
+				m1_inputs => master_inputs(1),
+				m1_outputs => master_outputs(1),
+				m2_inputs => master_inputs(2),
+				m2_outputs => master_outputs(2),
+				wb_adr_out => wb_adr,
+				wb_sel_out => open,
+				wb_cyc_out => wb_cyc,
+				wb_stb_out => wb_stb,
+				wb_we_out => open,
+				wb_dat_out => open,
+				wb_dat_in => (others => '0'),
+				wb_ack_in => wb_ack,
+				wb_cti_out => open,
+				wb_bte_out => open
+			);
+
+		-- Slave acknowledging each transfer after one wait state, like the SoC memory:
+		slave: process(clk)
+		begin
+			if rising_edge(clk) then
+				if reset = '1' then
+					wb_ack <= '0';
+				else
+					wb_ack <= wb_cyc and wb_stb and not wb_ack;
+				end if;
+			end if;
+		end process slave;
+
+		masters: for m in 1 to 2 generate
+			master: process(clk)
+				variable lfsr : unsigned(15 downto 0) := to_unsigned(16#ace1# + m * 16#1234#, 16);
+				variable gap, transfers, waited : natural := 0;
+				variable granted : boolean := false;
+			begin
+				if rising_edge(clk) then
+					if reset = '1' then
+						master_outputs(m) <= (
+								adr => (others => '0'),
+								sel => (others => '1'),
+								cyc => '0',
+								stb => '0',
+								we => '0',
+								dat => (others => '0'),
+								cti => WB_CTI_CLASSIC,
+								bte => WB_BTE_LINEAR
+							);
+						gap := 0;
+					elsif master_outputs(m).cyc = '0' then
+						if gap = 0 then
+							-- Masters are identified by the most significant address bit:
+							master_outputs(m).adr <= std_logic_vector(shift_left(to_unsigned(m - 1, 32), 31));
+							master_outputs(m).cyc <= '1';
+							master_outputs(m).stb <= '1';
+							transfers := 0;
+							waited := 0;
+							granted := false;
+						else
+							gap := gap - 1;
+						end if;
+					else
+						if not granted then
+							if wb_cyc = '1' and to_integer(unsigned(wb_adr(31 downto 31))) = m - 1 then
+								granted := true;
+								total_latency(m) <= total_latency(m) + waited;
+								grant_count(m) <= grant_count(m) + 1;
+								if waited > worst_latency(m) then
+									worst_latency(m) <= waited;
+								end if;
+
+								if MAX_WAIT /= 0 and POLICIES(p) = ARBITER_WEIGHTED and not SATURATED(p) then
+									assert waited <= MAX_WAIT + 2 * BURST_LENGTH(3 - m) + 2
+										report "Master waited longer than the maximum wait allows" severity FAILURE;
+								end if;
+							else
+								waited := waited + 1;
+							end if;
+						end if;
+
+						if master_inputs(m).ack = '1' then
+							transfers := transfers + 1;
+							if transfers = BURST_LENGTH(m) then
+								master_outputs(m).cyc <= '0';
+								master_outputs(m).stb <= '0';
+
+								lfsr := lfsr(14 downto 0) & (lfsr(15) xor lfsr(13) xor lfsr(12) xor lfsr(10));
+								if SATURATED(p) then
+									gap := 0;
+								else
+									gap := to_integer(lfsr) mod (MAX_GAP(m) + 1);
+								end if;
+							end if;
+						end if;
+					end if;
+				end if;
+			end process master;
+		end generate masters;
+
+		report_statistics: process
+		begin
+			wait until cycle_count = NUM_CYCLES;
+
+			for m in 1 to 2 loop
+				report "Statistics: " & instance_name(p) & ", master " & integer'image(m)
+					& ": worst-case grant latency " & integer'image(worst_latency(m)) & " cycles, average "
+					& format_average(total_latency(m), grant_count(m)) & " cycles over "
+					& integer'image(grant_count(m)) & " bus cycles" severity NOTE;
+			end loop;
+
+			-- Both masters always wait for the bus, so each gets its weight in every round, except in the
+			-- last round, which may be incomplete:
+			if SATURATED(p) then
+				assert abs(grant_count(1) * M2_WEIGHT - grant_count(2) * M1_WEIGHT) <= M1_WEIGHT * M2_WEIGHT
+					report "Bus cycles granted by the weighted policy are not in the ratio of the weights: "
+						& integer'image(grant_count(1)) & " to master 1, " & integer'image(grant_count(2))
+						& " to master 2" severity FAILURE;
+			end if;
+			wait;
+		end process report_statistics;
+
+	end generate policy_instances;
+
+	stimulus: process
+	begin
+		wait for clk_period * 2;
+		reset <= '0';
+
+		wait until cycle_count = NUM_CYCLES + 1;
+		simulation_finished <= true;
+		wait;
+	end process stimulus;
+
+end architecture testbench;